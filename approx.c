@@ -0,0 +1,126 @@
+#include "approx.h"
+#include "getWord.h"
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+
+// ************************************************
+// ************************************************
+// ** approx.c counts pairs approximately in fixed
+// ** memory with a Count-Min Sketch, following
+// ** the most frequent pairs in a TopK.
+// **
+// ** See approx.h for more information on each
+// ** individual function and on the error bounds.
+
+#define SKETCH_MIN_BYTES (APPROX_DEPTH * APPROX_MIN_WIDTH * (long long) sizeof(unsigned int))
+
+// bytes taken by a TopK of the given capacity (sized as initTopK() does)
+static long long candidateMemory(long long capacity) {
+  long long slotCount = 16;
+  while (slotCount < 2 * capacity) slotCount <<= 1;
+  return sizeof(HashNode) * capacity + (sizeof(unsigned long long) + sizeof(int)) * slotCount;
+}
+
+// smallest memory a counter can use:
+long long approxMinimumMemory(int topCount) {
+  return candidateMemory(topCount > 0 ? topCount : 1) + SKETCH_MIN_BYTES;
+}
+
+// create an approximate counter of at most memoryBytes:
+ApproxCounter* createApprox(long long memoryBytes, int topCount) {
+  long long perCandidate = sizeof(HashNode) + 4 * (sizeof(unsigned long long) + sizeof(int));
+  long long capacity = (long long) APPROX_CANDIDATES * (topCount > 0 ? topCount : 1);
+  long long candidateBytes;
+
+  if (memoryBytes < approxMinimumMemory(topCount)) return NULL;
+  if (capacity > memoryBytes / APPROX_CANDIDATE_SHARE / perCandidate) {
+    capacity = memoryBytes / APPROX_CANDIDATE_SHARE / perCandidate;
+  }
+  if (capacity < topCount) capacity = topCount;
+  if (capacity > INT_MAX / 4) capacity = INT_MAX / 4;
+  if (candidateMemory(capacity) > memoryBytes - SKETCH_MIN_BYTES) capacity = topCount; // tiny budget
+
+  ApproxCounter* approx = malloc(sizeof(ApproxCounter));
+  approx->dict = createDictionary(INITIAL_DICT_SIZE);
+  initTopK(&approx->candidates, capacity, approx->dict);
+  candidateBytes = candidateMemory(approx->candidates.capacity);
+
+  // the sketch gets the rest (at least APPROX_MIN_WIDTH counters a row)
+  approx->width = (memoryBytes - candidateBytes) / (APPROX_DEPTH * (long long) sizeof(unsigned int));
+  if (approx->width > UINT_MAX) approx->width = UINT_MAX;
+  approx->sketch = calloc(APPROX_DEPTH * approx->width, sizeof(unsigned int));
+  approx->pairCount = 0;
+  approx->memoryBytes = candidateBytes + APPROX_DEPTH * approx->width * sizeof(unsigned int);
+  return approx;
+}
+
+// count one occurance of a pair:
+int approxInsert(ApproxCounter* approx, unsigned long long key) {
+  unsigned long long hash = hashKey(key);
+  unsigned int index = hash; // row d hashes to index + d * step
+  unsigned int step = (hash >> 32) | 1;
+  unsigned int* counters[APPROX_DEPTH];
+  unsigned int smallest = UINT_MAX;
+
+  for (int d = 0; d < APPROX_DEPTH; d++) {
+    unsigned int rowHash = index + d * step;
+    // scale the 32-bit hash to [0, width) without a division
+    counters[d] = &approx->sketch[d * approx->width + (((unsigned long long) rowHash * approx->width) >> 32)];
+    if (*counters[d] < smallest) smallest = *counters[d];
+  }
+
+  // conservative update: only the counters that decide the estimate grow
+  if (smallest < INT_MAX) {
+    for (int d = 0; d < APPROX_DEPTH; d++) {
+      if (*counters[d] == smallest) (*counters[d])++;
+    }
+    smallest++;
+  }
+  approx->pairCount++;
+  updateTopK(&approx->candidates, key, smallest);
+  return smallest;
+}
+
+// count the pairs of a file approximately:
+int approxCountFile(ApproxCounter* approx, const char* path) {
+  WordReader reader;
+  const char* word;
+  int wordLength;
+  unsigned int previousWord, currentWord;
+
+  if (openWordReader(&reader, path) != 0) return -1;
+  if ((wordLength = getNextWordSlice(&reader, &word)) != 0) {
+    previousWord = internWord(approx->dict, word, wordLength);
+    while ((wordLength = getNextWordSlice(&reader, &word)) != 0) {
+      currentWord = internWord(approx->dict, word, wordLength);
+      approxInsert(approx, PAIR_KEY(previousWord, currentWord));
+      previousWord = currentWord;
+    }
+  }
+  closeWordReader(&reader);
+  return 0;
+}
+
+// print the candidates with the highest estimates:
+void printApprox(ApproxCounter* approx, int count) {
+  printTopK(&approx->candidates, count);
+}
+
+// print how far the estimates may be off:
+void printApproxBounds(FILE* out, ApproxCounter* approx) {
+  double epsilon = exp(1.0) / approx->width; // error per pair counted
+  fprintf(out, "# approximate: %lld pairs counted in %.1f MB (%d x %llu sketch, %d candidates)\n",
+          approx->pairCount, approx->memoryBytes / 1048576.0, APPROX_DEPTH, approx->width,
+          approx->candidates.capacity);
+  fprintf(out, "# counts are upper bounds, at most %.0f above the true count with probability %.1f%%\n",
+          ceil(epsilon * approx->pairCount), 100.0 * (1.0 - exp(-APPROX_DEPTH)));
+}
+
+// free an approximate counter:
+void destroyApprox(ApproxCounter* approx) {
+  freeTopK(&approx->candidates);
+  destroyDictionary(approx->dict);
+  free(approx->sketch);
+  free(approx);
+}
@@ -0,0 +1,104 @@
+#ifndef APPROX_H
+#define APPROX_H
+
+#include <stdio.h>
+#include "topK.h"
+
+#ifndef APPROX_DEPTH
+#define APPROX_DEPTH 4 // rows of the sketch: counts are within bounds with
+                       // probability 1 - e^-APPROX_DEPTH (98%)
+#endif
+
+#ifndef APPROX_DEFAULT_MEMORY
+#define APPROX_DEFAULT_MEMORY (256LL << 20) // --mem when not given
+#endif
+
+#ifndef APPROX_DEFAULT_TOP
+#define APPROX_DEFAULT_TOP 1000 // pairs printed when no -count is given
+#endif
+
+#ifndef APPROX_CANDIDATES
+#define APPROX_CANDIDATES 8 // candidates followed per pair printed
+#endif
+
+#ifndef APPROX_MIN_WIDTH
+#define APPROX_MIN_WIDTH 1024 // fewest counters in a row of the sketch
+#endif
+
+#define APPROX_CANDIDATE_SHARE 16 // candidates never take more than 1/16 of the memory
+
+typedef struct _approxCounter {
+  unsigned int* sketch; // APPROX_DEPTH rows of width counters
+  unsigned long long width; // counters per row
+  long long pairCount; // N, the # of pairs counted
+  TopK candidates; // the pairs with the highest estimates so far
+  Dictionary* dict; // words the pair keys refer to
+  long long memoryBytes; // bytes used by the sketch and the candidates
+} ApproxCounter;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  create: createApprox(long long, int)
+// **  smallest memory a counter can use: approxMinimumMemory(int)
+// **  count a pair: approxInsert(ApproxCounter*, unsigned long long)
+// **  count the pairs of a file: approxCountFile(ApproxCounter*, const char*)
+// **  print the top pairs: printApprox(ApproxCounter*, int)
+// **  print the error bounds: printApproxBounds(FILE*, ApproxCounter*)
+// **  free memory: destroyApprox(ApproxCounter*)
+// **
+// ** Approximate mode finds the most frequent pairs in a fixed amount
+// ** of memory, however many distinct pairs the input holds. Every
+// ** pair is counted in a Count-Min Sketch: APPROX_DEPTH rows of width
+// ** counters, one counter per row picked by hashing the pair key.
+// ** Only the smallest of a pair's counters is incremented (conservative
+// ** update), and that smallest counter is the pair's estimate. An
+// ** estimate is never below the true count, and with probability
+// ** 1 - e^-APPROX_DEPTH it is at most e / width * N above it.
+// **
+// ** The pairs with the highest estimates are followed in a TopK (see
+// ** topK.h) holding many more candidates than are printed. As in the
+// ** Space-Saving algorithm, a new pair takes the place of the candidate
+// ** with the lowest count once its estimate passes it, so a pair that
+// ** is frequent enough always ends up among the candidates.
+// **
+// ** Words are still interned into a Dictionary, which grows with the
+// ** vocabulary, not with the number of distinct pairs.
+
+// createApprox() creates an ApproxCounter that uses about the given
+// number of bytes. APPROX_CANDIDATES candidates are followed for each
+// pair that will be printed (the second argument), as long as they fit
+// in 1/APPROX_CANDIDATE_SHARE of the memory; the rest is the sketch.
+// It never uses more than the given bytes, and returns NULL if they are
+// fewer than approxMinimumMemory() of the second argument.
+ApproxCounter* createApprox(long long, int);
+
+// approxMinimumMemory() returns the fewest bytes an ApproxCounter that
+// prints the given number of pairs can be created with: one candidate
+// per pair printed, and a sketch of APPROX_MIN_WIDTH counters per row.
+long long approxMinimumMemory(int);
+
+// approxInsert() counts one occurance of a pair key built with
+// PAIR_KEY() from ids of the counter's Dictionary, and returns the
+// pair's new estimate.
+int approxInsert(ApproxCounter*, unsigned long long);
+
+// approxCountFile() reads the named file with a WordReader (the words
+// are exactly the ones getNextWord() returns) and counts its pairs.
+// The function returns 0 on success and -1 (with errno set) if the file
+// cannot be opened.
+int approxCountFile(ApproxCounter*, const char*);
+
+// printApprox() prints the given number of candidates with the highest
+// estimates (-1 prints every candidate) to stdout in the same
+// "count word1 word2" format and order as printSortedHashTable().
+void printApprox(ApproxCounter*, int);
+
+// printApproxBounds() writes the memory used, N, and the error bound of
+// the printed estimates to the given stream.
+void printApproxBounds(FILE*, ApproxCounter*);
+
+// destroyApprox() frees the ApproxCounter and its Dictionary.
+void destroyApprox(ApproxCounter*);
+
+#endif
@@ -0,0 +1,93 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ************************************************
+// ************************************************
+// ** arena.c is the bump allocator that owns the
+// ** words stored in a Dictionary. See arena.h for
+// ** more information on each individual function.
+
+#define ARENA_ALIGN (sizeof(void*) > sizeof(double) ? sizeof(void*) : sizeof(double))
+
+// set up an empty arena:
+void initArena(Arena* arena, size_t chunkSize) {
+  arena->chunks = NULL;
+  arena->next = arena->end = NULL;
+  arena->chunkSize = chunkSize ? chunkSize : ARENA_CHUNK_SIZE;
+  arena->bytesUsed = 0;
+  arena->bytesReserved = 0;
+  arena->chunkCount = 0;
+}
+
+// add a chunk of at least size bytes; oversized chunks are linked
+// behind the current one so that it stays the one being filled
+static char* newChunk(Arena* arena, size_t size) {
+  int dedicated = size > arena->chunkSize / 4;
+  size_t chunkSize = dedicated ? size : arena->chunkSize;
+  ArenaChunk* chunk = malloc(sizeof(ArenaChunk) + chunkSize);
+
+  if (chunk == NULL) return NULL;
+  chunk->size = chunkSize;
+  arena->chunkCount++;
+  arena->bytesReserved += chunkSize;
+  if (dedicated && arena->chunks != NULL) {
+    chunk->next = arena->chunks->next;
+    arena->chunks->next = chunk;
+    return chunk->data;
+  }
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+  arena->next = chunk->data;
+  arena->end = chunk->data + chunkSize;
+  return chunk->data;
+}
+
+// allocate aligned memory from the arena:
+void* arenaAlloc(Arena* arena, size_t size) {
+  size_t padding = (ARENA_ALIGN - (size_t) arena->next % ARENA_ALIGN) % ARENA_ALIGN;
+  char* memory;
+
+  if (arena->next == NULL || size + padding > (size_t) (arena->end - arena->next)) {
+    memory = newChunk(arena, size);
+    if (memory == NULL || memory != arena->next) {
+      if (memory != NULL) arena->bytesUsed += size;
+      return memory; // NULL, or a dedicated chunk
+    }
+    padding = 0; // chunk data is already aligned
+  }
+  memory = arena->next + padding;
+  arena->next = memory + size;
+  arena->bytesUsed += size;
+  return memory;
+}
+
+// copy a string into the arena:
+char* arenaCopy(Arena* arena, const char* string, size_t length) {
+  char* copy;
+
+  if (arena->next == NULL || length + 1 > (size_t) (arena->end - arena->next)) {
+    copy = newChunk(arena, length + 1);
+    if (copy == NULL) return NULL;
+    if (copy == arena->next) arena->next += length + 1;
+  } else {
+    copy = arena->next;
+    arena->next += length + 1;
+  }
+  memcpy(copy, string, length);
+  copy[length] = '\0';
+  arena->bytesUsed += length + 1;
+  return copy;
+}
+
+// free every chunk of the arena:
+void freeArena(Arena* arena) {
+  ArenaChunk* chunk = arena->chunks;
+
+  while (chunk != NULL) {
+    ArenaChunk* next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  initArena(arena, arena->chunkSize);
+}
@@ -0,0 +1,59 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#ifndef ARENA_CHUNK_SIZE
+#define ARENA_CHUNK_SIZE (1 << 16) // bytes requested from malloc() at a time
+#endif
+
+typedef struct _arenaChunk {
+  struct _arenaChunk* next; // previously filled chunk
+  size_t size; // # of bytes in data[]
+  char data[]; // memory handed out by the arena
+} ArenaChunk;
+
+typedef struct _arena {
+  ArenaChunk* chunks; // most recent chunk first
+  char* next; // next free byte of the current chunk
+  char* end; // end of the current chunk
+  size_t chunkSize; // size of a regular chunk
+  size_t bytesUsed; // # of bytes handed out
+  size_t bytesReserved; // # of bytes in all chunks
+  int chunkCount; // # of chunks (= # of malloc() calls)
+} Arena;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  set up an Arena: initArena(Arena*, size_t)
+// **  allocate from it: arenaAlloc(Arena*, size_t)
+// **  copy a string into it: arenaCopy(Arena*, const char*, size_t)
+// **  release everything at once: freeArena(Arena*)
+// **
+// ** An Arena is a bump allocator: memory is carved out of large
+// ** chunks by moving a pointer, and nothing is ever freed on its
+// ** own. freeArena() releases the chunks, so tearing down millions
+// ** of small objects costs one free() per chunk.
+
+// initArena() sets up an empty Arena (no memory is allocated until
+// the first request) whose chunks are the given size, or
+// ARENA_CHUNK_SIZE if the size is 0.
+void initArena(Arena*, size_t);
+
+// arenaAlloc() returns size bytes aligned for any ordinary type. A new
+// chunk is allocated when the current one is full; requests larger
+// than a quarter of a chunk get a chunk of their own so they do not
+// waste the rest of the current one.
+void* arenaAlloc(Arena*, size_t);
+
+// arenaCopy() copies length bytes (which need not be NUL-terminated)
+// into the Arena, adds a NUL, and returns the copy. Copies are packed
+// back to back without alignment.
+char* arenaCopy(Arena*, const char*, size_t);
+
+// freeArena() frees every chunk. Everything allocated from the Arena
+// becomes invalid; the Arena may be used again afterwards.
+void freeArena(Arena*);
+
+#endif
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "../hash.h"
+#include "../ingest.h"
+#include "../approx.h"
+
+// ************************************************
+// ************************************************
+// ** approxBench compares --approx against exact
+// ** counting on one corpus. The file is counted
+// ** exactly once, then approximately with each
+// ** memory budget, and for every budget it prints
+// **
+// **   mode=approx mem_mb=M seconds=S recall=R mean_error=E max_error=X bound=B
+// **
+// ** recall is the fraction of the K pairs approximate mode would print
+// ** that belong in the exact top K (their exact count is at least the
+// ** K-th highest exact count, so ties do not matter), mean_error and
+// ** max_error are how far those K printed counts are above the exact
+// ** counts, and bound is the error bound approximate mode promises
+// ** (with probability 1 - e^-APPROX_DEPTH).
+// **
+// ** usage: approxBench file [K]
+
+static const long long budgets[] = { 1LL << 20, 4LL << 20, 16LL << 20, 64LL << 20, 256LL << 20 };
+
+// seconds on the monotonic clock
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// qsort compare function: candidates by count descending
+static int compareCounts(const void* n1, const void* n2) {
+  return ((const HashNode*) n2)->count - ((const HashNode*) n1)->count;
+}
+
+int main(int argc, char** argv) {
+  int k = argc > 2 ? atoi(argv[2]) : 100;
+  double start;
+
+  if (argc < 2 || k < 1) {
+    fprintf(stderr, "usage: %s file [K]\n", argv[0]);
+    return 1;
+  }
+
+  // exact counts and the count of the K-th pair
+  HashTable* exact = initHashTable();
+  start = now();
+  if (countFile(exact, argv[1], 1) != 0) {
+    fprintf(stderr, "Unable to open file: %s\n", argv[1]);
+    return 1;
+  }
+  if (k > exact->uniqueCount) k = exact->uniqueCount;
+  HashNode* top = topDump(exact, k);
+  printf("mode=exact seconds=%.3f mem_mb=%.1f pairs=%lld unique=%d k=%d\n", now() - start,
+         (exact->rowCount * sizeof(HashNode) + exact->dict->arena.bytesReserved) / 1048576.0
+         + exact->dict->rowCount * sizeof(DictSlot) / 1048576.0,
+         exact->entryCount, exact->uniqueCount, k);
+  int threshold = k ? top[k - 1].count : 0;
+
+  for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+    ApproxCounter* approx = createApprox(budgets[b], k);
+    if (approx == NULL) {
+      printf("mode=approx mem_mb=%.1f skipped: too small for k=%d\n", budgets[b] / 1048576.0, k);
+      continue;
+    }
+    start = now();
+    approxCountFile(approx, argv[1]);
+    double seconds = now() - start;
+
+    // the K candidates approximate mode would print
+    TopK* candidates = &approx->candidates;
+    HashNode* printed = malloc(sizeof(HashNode) * (candidates->size ? candidates->size : 1));
+    memcpy(printed, candidates->heap, sizeof(HashNode) * candidates->size);
+    qsort(printed, candidates->size, sizeof(HashNode), compareCounts);
+    int shown = candidates->size < k ? candidates->size : k;
+
+    int found = 0;
+    double totalError = 0;
+    int maxError = 0;
+    for (int i = 0; i < shown; i++) {
+      // translate the pair into the exact table's word ids
+      const char* first = dictionaryWord(approx->dict, PAIR_FIRST(printed[i].key));
+      const char* second = dictionaryWord(approx->dict, PAIR_SECOND(printed[i].key));
+      unsigned long long key = PAIR_KEY(internWord(exact->dict, first, strlen(first)),
+                                        internWord(exact->dict, second, strlen(second)));
+      int count = findCount(exact, key);
+      int error = printed[i].count - count;
+      totalError += error;
+      if (error > maxError) maxError = error;
+      if (count >= threshold) found++;
+    }
+    printf("mode=approx mem_mb=%.1f seconds=%.3f recall=%.4f mean_error=%.2f max_error=%d bound=%.0f\n",
+           approx->memoryBytes / 1048576.0, seconds, k ? (double) found / k : 1.0,
+           shown ? totalError / shown : 0.0, maxError, ceil(exp(1.0) / approx->width * approx->pairCount));
+    fflush(stdout);
+    free(printed);
+    destroyApprox(approx);
+  }
+
+  free(top);
+  destroy(exact);
+  return 0;
+}
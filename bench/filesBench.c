@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../hash.h"
+#include "../ingest.h"
+#include "../stats.h"
+#include "../fileList.h"
+
+// ************************************************
+// ************************************************
+// ** filesBench measures how countFiles() spreads
+// ** many files of very different sizes over its
+// ** worker threads. It counts the same files
+// ** (directories are searched, as wordpairs does)
+// ** with 1, 2, 4, ... threads up to the given
+// ** maximum and prints one machine-readable line
+// ** per thread count:
+// **
+// **   threads=N seconds=S files_per_sec=F mb_per_sec=M stolen=T merge_seconds=G
+// **
+// ** where stolen is the number of files (or parts of
+// ** files) workers took from each other and merge_seconds
+// ** the time spent merging the per-thread tables. Each
+// ** run must count exactly the pairs the single-threaded
+// ** run does, or the bench fails. A final "summary" line
+// ** gives the speedup of the last run over the first.
+// **
+// ** usage: filesBench maxThreads path1 <path2> ...
+
+// seconds on the monotonic clock
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+  FileList files;
+  int maxThreads = argc > 1 ? atoi(argv[1]) : 0;
+  long long pairs = -1; // pairs counted by the first run
+  int uniquePairs = -1;
+  double firstSeconds = 0, seconds = 0;
+
+  if (argc < 3 || maxThreads < 1) {
+    fprintf(stderr, "usage: %s maxThreads path1 <path2> ...\n", argv[0]);
+    return 1;
+  }
+  initFileList(&files);
+  for (int i = 2; i < argc; i++) {
+    if (addPath(&files, argv[i]) != 0) {
+      fprintf(stderr, "Unable to read directory: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    HashTable* hashTable = initHashTable();
+    const char* failedName;
+    long long stolen = runStats.stolenTasks;
+    long long mergeNanos = runStats.phases[PHASE_MERGE].wallNanos;
+    long long bytes = runStats.bytesRead;
+
+    double start = now();
+    if (countFiles(hashTable, files.paths, files.count, threads, &failedName) != 0) {
+      fprintf(stderr, "Unable to open file: %s\n", failedName);
+      return 1;
+    }
+    seconds = now() - start;
+    if (threads == 1) {
+      firstSeconds = seconds;
+      pairs = hashTable->entryCount;
+      uniquePairs = hashTable->uniqueCount;
+    } else if (hashTable->entryCount != pairs || hashTable->uniqueCount != uniquePairs) {
+      fprintf(stderr, "threads=%d counted %lld pairs (%d unique), expected %lld (%d unique)\n",
+              threads, hashTable->entryCount, hashTable->uniqueCount, pairs, uniquePairs);
+      return 1;
+    }
+    bytes = runStats.bytesRead - bytes;
+    printf("threads=%d seconds=%.6f files_per_sec=%.0f mb_per_sec=%.1f stolen=%lld merge_seconds=%.6f\n",
+           threads, seconds, files.count / seconds, bytes / seconds / 1e6,
+           runStats.stolenTasks - stolen, (runStats.phases[PHASE_MERGE].wallNanos - mergeNanos) / 1e9);
+    destroy(hashTable);
+  }
+
+  printf("summary files=%d pairs=%lld unique_pairs=%d speedup=%.2f\n",
+         files.count, pairs, uniquePairs, firstSeconds / seconds);
+  freeFileList(&files);
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// ************************************************
+// ************************************************
+// ** genCorpus writes a reproducible synthetic
+// ** text corpus to stdout: words are drawn from
+// ** a Zipf distribution over a generated
+// ** vocabulary, with sentence capitalization,
+// ** some punctuation and line breaks so that the
+// ** tokenizer's slow path is exercised too. The
+// ** same arguments always give the same bytes.
+// **
+// ** usage: genCorpus [-s bytes] [-v vocabulary] [-z exponent] [-seed n]
+
+#define DEFAULT_BYTES (64LL << 20)
+#define DEFAULT_VOCABULARY 50000
+#define DEFAULT_EXPONENT 1.0
+#define DEFAULT_SEED 360
+
+#define MAX_GENERATED_LEN 16
+
+// splitmix64: small, fast and identical on every platform
+static unsigned long long state;
+static unsigned long long nextRandom(void) {
+  unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// uniform double in [0, 1)
+static double uniform(void) {
+  return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int main(int argc, char** argv) {
+  long long bytes = DEFAULT_BYTES;
+  int vocabulary = DEFAULT_VOCABULARY;
+  double exponent = DEFAULT_EXPONENT;
+  unsigned long long seed = DEFAULT_SEED;
+
+  for (int a = 1; a < argc; a++) {
+    if (a + 1 < argc && strcmp(argv[a], "-s") == 0) bytes = atoll(argv[++a]);
+    else if (a + 1 < argc && strcmp(argv[a], "-v") == 0) vocabulary = atoi(argv[++a]);
+    else if (a + 1 < argc && strcmp(argv[a], "-z") == 0) exponent = atof(argv[++a]);
+    else if (a + 1 < argc && strcmp(argv[a], "-seed") == 0) seed = strtoull(argv[++a], NULL, 10);
+    else {
+      fprintf(stderr, "usage: %s [-s bytes] [-v vocabulary] [-z exponent] [-seed n]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (vocabulary < 1) vocabulary = 1;
+  state = seed;
+
+  // vocabulary: random lowercase words, short ones more likely
+  // (duplicates are harmless, they just merge two ranks)
+  char* words = malloc((size_t) vocabulary * (MAX_GENERATED_LEN + 1));
+  int* lengths = malloc(sizeof(int) * vocabulary);
+  for (int w = 0; w < vocabulary; w++) {
+    int length = 1 + (int) (-log(1.0 - uniform()) * 4.0);
+    if (length > MAX_GENERATED_LEN) length = MAX_GENERATED_LEN;
+    for (int i = 0; i < length; i++) {
+      words[(size_t) w * (MAX_GENERATED_LEN + 1) + i] = 'a' + nextRandom() % 26;
+    }
+    lengths[w] = length;
+  }
+
+  // cumulative Zipf weights for sampling by binary search
+  double* cumulative = malloc(sizeof(double) * vocabulary);
+  double total = 0;
+  for (int w = 0; w < vocabulary; w++) {
+    total += 1.0 / pow(w + 1, exponent);
+    cumulative[w] = total;
+  }
+
+  char buffer[1 << 16];
+  size_t used = 0;
+  long long written = 0;
+  int sentenceStart = 1;
+  while (written < bytes) {
+    double target = uniform() * total;
+    int low = 0, high = vocabulary - 1;
+    while (low < high) {
+      int middle = (low + high) / 2;
+      if (cumulative[middle] < target) low = middle + 1;
+      else high = middle;
+    }
+    const char* word = words + (size_t) low * (MAX_GENERATED_LEN + 1);
+    int length = lengths[low];
+
+    if (used + length + 3 > sizeof(buffer)) {
+      fwrite(buffer, 1, used, stdout);
+      used = 0;
+    }
+    memcpy(buffer + used, word, length);
+    if (sentenceStart) buffer[used] -= 'a' - 'A';
+    used += length;
+    written += length;
+    sentenceStart = 0;
+
+    unsigned long long roll = nextRandom() % 100;
+    if (roll < 6) {
+      buffer[used++] = ',';
+      written++;
+    } else if (roll < 10) {
+      buffer[used++] = '.';
+      written++;
+      sentenceStart = 1;
+    }
+    buffer[used++] = nextRandom() % 12 == 0 ? '\n' : ' ';
+    written++;
+  }
+  fwrite(buffer, 1, used, stdout);
+
+  free(cumulative);
+  free(lengths);
+  free(words);
+  return 0;
+}
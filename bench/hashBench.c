@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../getWord.h"
+#include "../wordHash.h"
+#include "../crc64.h"
+
+// ************************************************
+// ************************************************
+// ** hashBench measures every word hash function
+// ** (see wordHash.h) on real word-pair keys. The
+// ** pairs of the files given are collected as
+// ** "word1 word2" strings, as the original table
+// ** stored them, and each function hashes all of
+// ** them several times. One line per function is
+// ** printed:
+// **
+// **   hash=NAME keys=N bytes=B seconds=S hashes_per_sec=H mb_per_sec=M
+// **
+// ** usage: hashBench [-r rounds] file ...
+
+#define DEFAULT_ROUNDS 5
+
+// seconds on the monotonic clock
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+  int rounds = DEFAULT_ROUNDS;
+  char* keys = NULL; // all pair keys, back to back
+  size_t keyBytes = 0, keyCapacity = 0;
+  size_t* offsets = NULL; // offsets[i] is where key i starts (plus one end)
+  size_t keyCount = 0, offsetCapacity = 0;
+
+  for (int a = 1; a < argc; a++) {
+    WordReader reader;
+    const char* word;
+    int length;
+    char previous[DICT_MAX_WORD_LEN];
+    int previousLength = 0;
+
+    if (strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+      rounds = atoi(argv[++a]);
+      continue;
+    }
+    if (openWordReader(&reader, argv[a]) != 0) {
+      fprintf(stderr, "Unable to open file: %s\n", argv[a]);
+      return 1;
+    }
+    while ((length = getNextWordSlice(&reader, &word)) != 0) {
+      if (previousLength != 0) {
+        // append "previous word" to the key buffer
+        if (keyBytes + previousLength + 1 + length > keyCapacity) {
+          keyCapacity = (keyCapacity + previousLength + 1 + length) * 2;
+          keys = realloc(keys, keyCapacity);
+        }
+        if (keyCount + 2 > offsetCapacity) {
+          offsetCapacity = (offsetCapacity + 2) * 2;
+          offsets = realloc(offsets, sizeof(size_t) * offsetCapacity);
+        }
+        offsets[keyCount++] = keyBytes;
+        memcpy(keys + keyBytes, previous, previousLength);
+        keys[keyBytes + previousLength] = ' ';
+        memcpy(keys + keyBytes + previousLength + 1, word, length);
+        keyBytes += previousLength + 1 + length;
+      }
+      memcpy(previous, word, length);
+      previousLength = length;
+    }
+    closeWordReader(&reader);
+  }
+  if (keyCount == 0) {
+    fprintf(stderr, "usage: %s [-r rounds] file ... (files must hold at least one pair)\n", argv[0]);
+    return 1;
+  }
+  offsets[keyCount] = keyBytes;
+
+  // the slicing-by-8 CRC must agree with the byte-at-a-time one
+  for (size_t i = 0; i < keyCount; i++) {
+    size_t length = offsets[i + 1] - offsets[i];
+    if (crc64s8(keys + offsets[i], length) != crc64n(keys + offsets[i], length)) {
+      fprintf(stderr, "crc64s8 disagrees with crc64n on key %zu\n", i);
+      return 1;
+    }
+  }
+
+  const char* const* names = wordHashNames();
+  for (int n = 0; names[n] != NULL; n++) {
+    const WordHash* hash = findWordHash(names[n]);
+    if (hash == NULL) continue; // not supported by this CPU
+    unsigned long long sink = 0; // keeps the calls from being optimized out
+    double best = 0;
+
+    for (int r = 0; r < rounds; r++) {
+      double start = now();
+      for (size_t i = 0; i < keyCount; i++) {
+        sink += hash->hash(keys + offsets[i], offsets[i + 1] - offsets[i]);
+      }
+      double elapsed = now() - start;
+      if (r == 0 || elapsed < best) best = elapsed;
+    }
+    printf("hash=%s keys=%zu bytes=%zu seconds=%.6f hashes_per_sec=%.0f mb_per_sec=%.1f sink=%llx\n",
+           hash->name, keyCount, keyBytes, best, keyCount / best, keyBytes / best / 1e6, sink & 0xff);
+  }
+
+  free(keys);
+  free(offsets);
+  return 0;
+}
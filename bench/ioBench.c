@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../hash.h"
+#include "../ingest.h"
+
+// ************************************************
+// ************************************************
+// ** ioBench measures how well reading files
+// ** ahead overlaps the disk with counting. It
+// ** drops the files from the page cache with
+// ** posix_fadvise(POSIX_FADV_DONTNEED) before each
+// ** cold stage (so the disk is actually read,
+// ** unless the storage below caches it) and times:
+// **
+// **   read_cold       read() of every file, nothing counted (I/O time)
+// **   count_warm      countFiles() with every file cached (CPU time)
+// **   cold_mmap       countFiles() with --io mmap (no read-ahead)
+// **   cold_threads    countFiles() with --io threads
+// **   cold_uring      countFiles() with --io uring
+// **
+// ** Each stage prints one machine-readable line:
+// **
+// **   phase=NAME seconds=S mb_per_sec=M
+// **
+// ** and a final "summary" line gives the sum and the maximum of the
+// ** I/O and CPU times that the cold stages fall between.
+// **
+// ** usage: ioBench file1 <file2> ...
+
+#define READ_SIZE (1 << 20)
+
+// seconds on the monotonic clock
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// drop every file from the page cache
+static void evictFiles(char** paths, int pathCount) {
+  for (int i = 0; i < pathCount; i++) {
+    int fd = open(paths[i], O_RDONLY);
+    if (fd < 0) continue;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+}
+
+// read every file without counting it; returns the # of bytes read
+static long long readFiles(char** paths, int pathCount) {
+  char* buffer = malloc(READ_SIZE);
+  long long bytes = 0;
+  ssize_t got;
+
+  for (int i = 0; i < pathCount; i++) {
+    int fd = open(paths[i], O_RDONLY);
+    if (fd < 0) continue;
+    while ((got = read(fd, buffer, READ_SIZE)) > 0) bytes += got;
+    close(fd);
+  }
+  free(buffer);
+  return bytes;
+}
+
+// count every file with the given read method; returns the seconds taken
+static double countWith(ReadMethod method, char** paths, int pathCount) {
+  HashTable* hashTable = initHashTable();
+  const char* failedName;
+
+  setReadMethod(method);
+  double start = now();
+  if (countFiles(hashTable, paths, pathCount, 1, &failedName) != 0) {
+    fprintf(stderr, "Unable to open file: %s\n", failedName);
+    exit(1);
+  }
+  double seconds = now() - start;
+  destroy(hashTable);
+  return seconds;
+}
+
+// print one stage's line
+static void printPhase(const char* name, double seconds, long long bytes) {
+  printf("phase=%s seconds=%.6f mb_per_sec=%.1f\n", name, seconds, bytes / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+  char** paths = argv + 1;
+  int pathCount = argc - 1;
+
+  if (pathCount < 1) {
+    fprintf(stderr, "usage: %s file1 <file2> ...\n", argv[0]);
+    return 1;
+  }
+
+  evictFiles(paths, pathCount);
+  double start = now();
+  long long bytes = readFiles(paths, pathCount);
+  double ioSeconds = now() - start;
+  printPhase("read_cold", ioSeconds, bytes);
+
+  readFiles(paths, pathCount); // make sure every file is cached
+  double cpuSeconds = countWith(READ_MAPPED, paths, pathCount);
+  printPhase("count_warm", cpuSeconds, bytes);
+
+  static const struct { const char* name; ReadMethod method; } stages[] = {
+    { "cold_mmap", READ_MAPPED }, { "cold_threads", READ_THREADS }, { "cold_uring", READ_URING }
+  };
+  for (int s = 0; s < 3; s++) {
+    evictFiles(paths, pathCount);
+    printPhase(stages[s].name, countWith(stages[s].method, paths, pathCount), bytes);
+  }
+
+  printf("summary files=%d bytes=%lld io_plus_cpu_seconds=%.6f max_io_cpu_seconds=%.6f\n",
+         pathCount, bytes, ioSeconds + cpuSeconds, ioSeconds > cpuSeconds ? ioSeconds : cpuSeconds);
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../hash.h"
+#include "../getWord.h"
+
+// ************************************************
+// ************************************************
+// ** latencyBench times every single insert() of
+// ** the pairs of one corpus, to show how much
+// ** the inserts that make the table grow stand
+// ** out from the rest. The pairs are inserted
+// ** into a table grown from initHashTable() and
+// ** into one made by sizedHashTable() for the
+// ** final number of unique pairs (as with
+// ** --expect-unique), and for each it prints
+// **
+// **   table=NAME inserts=N p50_ns= p99_ns= p999_ns= p9999_ns= max_ns= seconds=
+// **
+// ** The times include reading the clock twice
+// ** (tens of nanoseconds), so only the upper
+// ** percentiles are meaningful.
+// **
+// ** usage: latencyBench file
+
+// nanoseconds on the monotonic clock
+static long long nowNanos(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// qsort compare function: ascending latencies
+static int compareNanos(const void* n1, const void* n2) {
+  int a = *(const int*) n1, b = *(const int*) n2;
+  return (a > b) - (a < b);
+}
+
+// insert every key into a table, timing each insert, and print the
+// distribution of the times
+static void timeInserts(const char* name, HashTable* hashTable,
+                        const unsigned long long* keys, size_t keyCount, int* nanos) {
+  long long start = nowNanos(), before = start, after;
+
+  for (size_t i = 0; i < keyCount; i++) {
+    insert(hashTable, keys[i]);
+    after = nowNanos();
+    nanos[i] = after - before > 0x7FFFFFFF ? 0x7FFFFFFF : after - before;
+    before = after;
+  }
+  double seconds = (before - start) / 1e9;
+
+  qsort(nanos, keyCount, sizeof(int), compareNanos);
+  printf("table=%s inserts=%zu p50_ns=%d p99_ns=%d p999_ns=%d p9999_ns=%d max_ns=%d seconds=%.3f\n",
+         name, keyCount, nanos[keyCount / 2], nanos[keyCount / 100 * 99],
+         nanos[keyCount / 1000 * 999], nanos[keyCount / 10000 * 9999], nanos[keyCount - 1], seconds);
+  fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  WordReader reader;
+  const char* word;
+  int length;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s file\n", argv[0]);
+    return 1;
+  }
+  if (openWordReader(&reader, argv[1]) != 0) {
+    fprintf(stderr, "Unable to open file: %s\n", argv[1]);
+    return 1;
+  }
+
+  // untimed pass: intern every word and build the pair keys
+  Dictionary* dict = createDictionary(INITIAL_DICT_SIZE);
+  size_t keyCount = 0, keyCapacity = 1 << 20;
+  unsigned long long* keys = malloc(sizeof(unsigned long long) * keyCapacity);
+  unsigned int previous = 0;
+  int first = 1;
+  while ((length = getNextWordSlice(&reader, &word)) != 0) {
+    unsigned int id = internWord(dict, word, length);
+    if (!first) {
+      if (keyCount == keyCapacity) keys = realloc(keys, sizeof(unsigned long long) * (keyCapacity *= 2));
+      keys[keyCount++] = PAIR_KEY(previous, id);
+    }
+    previous = id;
+    first = 0;
+  }
+  closeWordReader(&reader);
+  if (keyCount == 0) {
+    fprintf(stderr, "No pairs in file: %s\n", argv[1]);
+    return 1;
+  }
+
+  int* nanos = malloc(sizeof(int) * keyCount);
+  HashTable* growing = initHashTable();
+  timeInserts("growing", growing, keys, keyCount, nanos);
+  HashTable* sized = sizedHashTable(growing->uniqueCount);
+  timeInserts("sized", sized, keys, keyCount, nanos);
+
+  destroy(sized);
+  destroy(growing);
+  destroyDictionary(dict);
+  free(nanos);
+  free(keys);
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../hash.h"
+#include "../shardMerge.h"
+
+// ************************************************
+// ************************************************
+// ** mergeBench measures the merge of per-thread
+// ** count tables. It builds the given number of
+// ** partial tables, each with its own Dictionary
+// ** (the words are interned in a different order
+// ** in each, as on separate threads), and merges
+// ** them once with mergeHashTable() one table at a
+// ** time, then with mergeHashTables() on 1, 2, 4,
+// ** ... threads up to the given maximum. Each merge
+// ** prints one machine-readable line:
+// **
+// **   merge=NAME threads=N seconds=S pairs_per_sec=P
+// **
+// ** where pairs_per_sec is the number of distinct
+// ** pairs of all the partial tables merged per
+// ** second. Each parallel merge must produce
+// ** exactly the pairs the serial one does, or the
+// ** bench fails. A final "summary" line gives the
+// ** speedup of the last merge over the serial one.
+// **
+// ** usage: mergeBench maxThreads <tables> <pairsPerTable> <vocabulary>
+
+#define MERGE_BENCH_TABLES 64
+#define MERGE_BENCH_PAIRS 200000
+#define MERGE_BENCH_VOCABULARY 3000
+
+// seconds on the monotonic clock
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift64*, so that every run builds the same tables
+static unsigned long long nextRandom(unsigned long long* state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// build the given partial table; pairs are skewed towards low word
+// numbers, so that the tables share many of their pairs
+static HashTable* buildTable(int table, int pairs, int vocabulary, unsigned* ids) {
+  HashTable* hashTable = sizedHashTable(pairs);
+  unsigned long long state = 0x9E3779B97F4A7C15ULL * (table + 1);
+  char word[16];
+
+  // intern the words in a shuffled order, different in every table
+  for (int i = 0; i < vocabulary; i++) ids[i] = i;
+  for (int i = vocabulary - 1; i > 0; i--) {
+    int j = nextRandom(&state) % (i + 1);
+    unsigned swap = ids[i];
+    ids[i] = ids[j];
+    ids[j] = swap;
+  }
+  for (int i = 0; i < vocabulary; i++) {
+    int length = snprintf(word, sizeof(word), "w%u", ids[i]);
+    ids[i] = internWord(hashTable->dict, word, length);
+  }
+
+  for (int i = 0; i < pairs; i++) {
+    unsigned long long bits = nextRandom(&state);
+    unsigned first = (bits & 0xffffffff) % vocabulary;
+    unsigned second = (bits >> 32) % vocabulary;
+    first = first * (unsigned long long) first / vocabulary;
+    insert(hashTable, PAIR_KEY(ids[first], ids[second]));
+  }
+  return hashTable;
+}
+
+// build every partial table; the first is the one merged into
+static void buildTables(HashTable** tables, int tableCount, int pairs, int vocabulary,
+                        unsigned* ids, long long* distinctPairs) {
+  *distinctPairs = 0;
+  for (int i = 0; i < tableCount; i++) {
+    tables[i] = buildTable(i, pairs, vocabulary, ids);
+    *distinctPairs += tables[i]->uniqueCount;
+  }
+}
+
+int main(int argc, char** argv) {
+  int maxThreads = argc > 1 ? atoi(argv[1]) : 0;
+  int tableCount = argc > 2 ? atoi(argv[2]) : MERGE_BENCH_TABLES;
+  int pairs = argc > 3 ? atoi(argv[3]) : MERGE_BENCH_PAIRS;
+  int vocabulary = argc > 4 ? atoi(argv[4]) : MERGE_BENCH_VOCABULARY;
+  long long distinctPairs, entryCount;
+  int uniqueCount;
+  double serialSeconds, seconds = 0, start;
+
+  if (maxThreads < 1 || tableCount < 2 || pairs < 1 || vocabulary < 1) {
+    fprintf(stderr, "usage: %s maxThreads <tables> <pairsPerTable> <vocabulary>\n", argv[0]);
+    return 1;
+  }
+  HashTable** tables = malloc(sizeof(HashTable*) * tableCount);
+  unsigned* ids = malloc(sizeof(unsigned) * vocabulary);
+
+  buildTables(tables, tableCount, pairs, vocabulary, ids, &distinctPairs);
+  start = now();
+  for (int i = 1; i < tableCount; i++) {
+    mergeHashTable(tables[0], tables[i]);
+    destroy(tables[i]);
+  }
+  serialSeconds = now() - start;
+  entryCount = tables[0]->entryCount;
+  uniqueCount = tables[0]->uniqueCount;
+  destroy(tables[0]);
+  printf("merge=serial threads=1 seconds=%.6f pairs_per_sec=%.0f\n",
+         serialSeconds, distinctPairs / serialSeconds);
+
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    buildTables(tables, tableCount, pairs, vocabulary, ids, &distinctPairs);
+    start = now();
+    mergeHashTables(tables[0], tables + 1, tableCount - 1, threads);
+    seconds = now() - start;
+    if (tables[0]->entryCount != entryCount || tables[0]->uniqueCount != uniqueCount) {
+      fprintf(stderr, "threads=%d merged %lld pairs (%d unique), expected %lld (%d unique)\n",
+              threads, tables[0]->entryCount, tables[0]->uniqueCount, entryCount, uniqueCount);
+      return 1;
+    }
+    destroy(tables[0]);
+    printf("merge=sharded threads=%d seconds=%.6f pairs_per_sec=%.0f\n",
+           threads, seconds, distinctPairs / seconds);
+  }
+
+  printf("summary tables=%d pairs=%lld distinct_pairs=%lld unique_pairs=%d speedup=%.2f\n",
+         tableCount, entryCount, distinctPairs, uniqueCount, serialSeconds / seconds);
+  free(ids);
+  free(tables);
+  return 0;
+}
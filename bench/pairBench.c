@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "../hash.h"
+#include "../getWord.h"
+#include "../wordHash.h"
+#include "../ingest.h"
+#include "../successor.h"
+
+// ************************************************
+// ************************************************
+// ** pairBench times each stage of wordpairs on
+// ** one corpus separately:
+// **
+// **   tokenize       getNextWordSlice() over the file
+// **   hash           wordHash() of every word
+// **   intern         internWord() of every word
+// **   insert         insert() of every pair, table pre-sized
+// **   insert_expand  insert() of every pair from initHashTable()
+// **                  (the difference is the cost of expand())
+// **   insert_batch   insertBatch() of every pair, table pre-sized
+// **                  (the difference is what prefetching saves)
+// **   sort           arrayDump() of the whole table
+// **   topk           topDump() of the top 10 pairs
+// **   successors     buildSuccessorIndex() of the whole table
+// **   print          printSortedHashTable() of every pair to /dev/null
+// **   end_to_end     countFile() plus printing the top 10
+// **
+// ** Each stage prints one machine-readable line:
+// **
+// **   phase=NAME seconds=S mb_per_sec=M pairs_per_sec=P mallocs=A
+// **
+// ** where mallocs counts malloc/calloc/realloc calls made by the
+// ** wordpairs code during the stage (linked with -Wl,--wrap). A
+// ** final "summary" line gives the corpus size, pair counts, the
+// ** number of expand() calls, the bytes taken by the table and by the
+// ** successor index, the mean time of a findSuccessors() lookup (over
+// ** every word) and the peak RSS of the process.
+// **
+// ** usage: pairBench file
+
+// allocation counters, see -Wl,--wrap in the Makefile
+static long long allocations = 0;
+void* __real_malloc(size_t);
+void* __real_calloc(size_t, size_t);
+void* __real_realloc(void*, size_t);
+void* __wrap_malloc(size_t size) { allocations++; return __real_malloc(size); }
+void* __wrap_calloc(size_t count, size_t size) { allocations++; return __real_calloc(count, size); }
+void* __wrap_realloc(void* p, size_t size) { allocations++; return __real_realloc(p, size); }
+
+// seconds on the monotonic clock
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double phaseStart;
+static long long phaseAllocations;
+static size_t corpusBytes;
+
+static void startPhase(void) {
+  phaseAllocations = allocations;
+  phaseStart = now();
+}
+
+static void endPhase(const char* name, long long pairs) {
+  double seconds = now() - phaseStart;
+  printf("phase=%s seconds=%.6f mb_per_sec=%.1f pairs_per_sec=%.0f mallocs=%lld\n",
+         name, seconds, corpusBytes / seconds / 1e6, pairs / seconds,
+         allocations - phaseAllocations);
+  fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  WordReader reader;
+  const char* word;
+  int length;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s file\n", argv[0]);
+    return 1;
+  }
+  if (openWordReader(&reader, argv[1]) != 0) {
+    fprintf(stderr, "Unable to open file: %s\n", argv[1]);
+    return 1;
+  }
+  corpusBytes = reader.size;
+
+  // untimed pass: fault the file in and keep a copy of every word
+  size_t wordCount = 0, wordCapacity = 1 << 20, textBytes = 0, textCapacity = 1 << 24;
+  char* text = malloc(textCapacity);
+  size_t* offsets = malloc(sizeof(size_t) * (wordCapacity + 1));
+  while ((length = getNextWordSlice(&reader, &word)) != 0) {
+    if (textBytes + length > textCapacity) text = realloc(text, textCapacity *= 2);
+    if (wordCount == wordCapacity) offsets = realloc(offsets, sizeof(size_t) * ((wordCapacity *= 2) + 1));
+    offsets[wordCount++] = textBytes;
+    memcpy(text + textBytes, word, length);
+    textBytes += length;
+  }
+  offsets[wordCount] = textBytes;
+  closeWordReader(&reader);
+  long long pairCount = wordCount > 0 ? wordCount - 1 : 0;
+
+  // tokenize
+  size_t seen = 0;
+  openWordReader(&reader, argv[1]);
+  startPhase();
+  while (getNextWordSlice(&reader, &word) != 0) seen++;
+  endPhase("tokenize", pairCount);
+  closeWordReader(&reader);
+
+  // hash
+  const WordHash* hash = wordHash();
+  unsigned long long sink = 0;
+  startPhase();
+  for (size_t i = 0; i < wordCount; i++) {
+    sink += hash->hash(text + offsets[i], offsets[i + 1] - offsets[i]);
+  }
+  endPhase("hash", pairCount);
+
+  // intern
+  HashTable* growing = initHashTable();
+  unsigned int* ids = malloc(sizeof(unsigned int) * (wordCount ? wordCount : 1));
+  startPhase();
+  for (size_t i = 0; i < wordCount; i++) {
+    ids[i] = internWord(growing->dict, text + offsets[i], offsets[i + 1] - offsets[i]);
+  }
+  endPhase("intern", pairCount);
+
+  // insert_expand (from the initial size) first, to learn the final size
+  int rowsBefore = growing->rowCount, expandCount = 0;
+  startPhase();
+  for (size_t i = 1; i < wordCount; i++) {
+    insert(growing, PAIR_KEY(ids[i - 1], ids[i]));
+  }
+  endPhase("insert_expand", pairCount);
+  for (int rows = rowsBefore; rows < growing->rowCount; rows *= 2) expandCount++;
+
+  // insert into a table already large enough
+  HashTable* presized = createHashTable(growing->rowCount);
+  startPhase();
+  for (size_t i = 1; i < wordCount; i++) {
+    insert(presized, PAIR_KEY(ids[i - 1], ids[i]));
+  }
+  endPhase("insert", pairCount);
+  destroy(presized);
+
+  // the same, a batch at a time
+  unsigned long long* keys = malloc(sizeof(unsigned long long) * (pairCount ? pairCount : 1));
+  for (size_t i = 1; i < wordCount; i++) keys[i - 1] = PAIR_KEY(ids[i - 1], ids[i]);
+  presized = createHashTable(growing->rowCount);
+  startPhase();
+  insertBatch(presized, keys, pairCount);
+  endPhase("insert_batch", pairCount);
+  destroy(presized);
+  free(keys);
+
+  // sort / topk / print
+  sortDictionary(growing->dict); // ranks are shared by all three; build them once
+  startPhase();
+  free(arrayDump(growing));
+  endPhase("sort", pairCount);
+
+  startPhase();
+  free(topDump(growing, growing->uniqueCount < 10 ? growing->uniqueCount : 10));
+  endPhase("topk", pairCount);
+
+  SuccessorIndex successors;
+  startPhase();
+  buildSuccessorIndex(&successors, growing, 1);
+  endPhase("successors", pairCount);
+  double lookupStart = now();
+  for (int w = 0; w < growing->dict->wordCount; w++) {
+    int followers;
+    const Successor* row = findSuccessors(&successors, dictionaryWord(growing->dict, w), &followers);
+    if (followers > 0) sink += row[0].count;
+  }
+  double lookupNanos = (now() - lookupStart) * 1e9 / (growing->dict->wordCount ? growing->dict->wordCount : 1);
+
+  fflush(stdout);
+  FILE* saved = fdopen(dup(fileno(stdout)), "w");
+  if (freopen("/dev/null", "w", stdout) == NULL) return 1;
+  startPhase();
+  printSortedHashTable(growing, -1);
+  fflush(stdout);
+  double printSeconds = now() - phaseStart;
+  long long printAllocations = allocations - phaseAllocations;
+
+  // end_to_end
+  HashTable* fresh = initHashTable();
+  startPhase();
+  countFile(fresh, argv[1], 1);
+  printSortedHashTable(fresh, 10);
+  fflush(stdout);
+  double totalSeconds = now() - phaseStart;
+  long long totalAllocations = allocations - phaseAllocations;
+  destroy(fresh);
+
+  // back to the real stdout to report the last two stages
+  dup2(fileno(saved), fileno(stdout));
+  fclose(saved);
+  printf("phase=print seconds=%.6f mb_per_sec=%.1f pairs_per_sec=%.0f mallocs=%lld\n",
+         printSeconds, corpusBytes / printSeconds / 1e6, pairCount / printSeconds, printAllocations);
+  printf("phase=end_to_end seconds=%.6f mb_per_sec=%.1f pairs_per_sec=%.0f mallocs=%lld\n",
+         totalSeconds, corpusBytes / totalSeconds / 1e6, pairCount / totalSeconds, totalAllocations);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("summary bytes=%zu words=%zu pairs=%lld unique=%d vocabulary=%d rows=%d expands=%d "
+         "table_bytes=%zu successor_bytes=%zu follow_ns=%.0f hash=%s peak_rss_kb=%ld check=%llx\n",
+         corpusBytes, seen, pairCount, growing->uniqueCount, growing->dict->wordCount,
+         growing->rowCount, expandCount, sizeof(HashNode) * growing->rowCount,
+         successorBytes(&successors), lookupNanos, hash->name, usage.ru_maxrss, sink & 0xff);
+  freeSuccessorIndex(&successors);
+
+  destroy(growing);
+  free(ids);
+  free(offsets);
+  free(text);
+  return 0;
+}
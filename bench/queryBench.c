@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// ************************************************
+// ************************************************
+// ** queryBench is a load generator for the query
+// ** server of wordpairs --serve. It asks the
+// ** server for its top pairs to learn some words,
+// ** then opens a number of connections that each
+// ** send a share of the requests one at a time,
+// ** cycling through
+// **
+// **   TOP 10, COUNT word1 word2, NEXT word 10
+// **
+// ** with words picked at random from the sample,
+// ** and timing each request from sending it to
+// ** reading the last line of its answer. It
+// ** prints one line per request kind and one
+// ** for all of them:
+// **
+// **   request=KIND count=N p50_us= p99_us= p999_us= max_us=
+// **   summary requests=N connections=C seconds=S requests_per_sec=R
+// **
+// ** usage: queryBench socket [requests] [connections]
+
+#define SAMPLE_PAIRS 1000 // # of top pairs the words are picked from
+#define REQUEST_KINDS 3
+
+static const char* kindNames[REQUEST_KINDS] = { "top", "count", "next" };
+
+// a connection with a buffer for reading answers
+typedef struct _client {
+  int fd;
+  char buffer[65536];
+  size_t start, end; // unread bytes of buffer
+} Client;
+
+// the words of the sample pairs
+static char (*sampleFirst)[256];
+static char (*sampleSecond)[256];
+static int sampleCount;
+
+// what each connection thread is given and measures
+typedef struct _worker {
+  const char* path;
+  int requests; // # of requests to send
+  unsigned int seed;
+  int* nanos[REQUEST_KINDS]; // latency of each request, by kind
+  int counts[REQUEST_KINDS];
+  int failed;
+} Worker;
+
+// nanoseconds on the monotonic clock
+static long long nowNanos(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// connect to the server, returning -1 on failure
+static int connectClient(Client* client, const char* path) {
+  struct sockaddr_un address;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  client->start = client->end = 0;
+  if (client->fd < 0) return -1;
+  return connect(client->fd, (struct sockaddr*) &address, sizeof(address));
+}
+
+// read one line of an answer (without its newline) into line; returns
+// its length, or -1 if the connection closed
+static int readLine(Client* client, char* line, int size) {
+  int length = 0;
+  for (;;) {
+    while (client->start < client->end) {
+      char ch = client->buffer[client->start++];
+      if (ch == '\n') {
+        line[length] = '\0';
+        return length;
+      }
+      if (length < size - 1) line[length++] = ch;
+    }
+    ssize_t bytes = read(client->fd, client->buffer, sizeof(client->buffer));
+    if (bytes <= 0) return -1;
+    client->start = 0;
+    client->end = bytes;
+  }
+}
+
+// send a request and read its whole answer; returns the # of pair
+// lines in it, or -1 on an error
+static int ask(Client* client, const char* request, char* line, int size) {
+  int count;
+  size_t length = strlen(request);
+
+  if (write(client->fd, request, length) != (ssize_t) length) return -1;
+  if (readLine(client, line, size) < 0 || sscanf(line, "OK %d", &count) != 1) return -1;
+  for (int i = 0; i < count; i++) {
+    if (readLine(client, line, size) < 0) return -1;
+  }
+  return count;
+}
+
+// thread body: send this worker's share of the requests
+static void* runWorker(void* argument) {
+  Worker* worker = argument;
+  Client client;
+  char request[600], line[1024];
+
+  if (connectClient(&client, worker->path) != 0) {
+    worker->failed = 1;
+    return NULL;
+  }
+  for (int i = 0; i < worker->requests; i++) {
+    int kind = i % REQUEST_KINDS;
+    int pick = rand_r(&worker->seed) % sampleCount;
+    if (kind == 0) snprintf(request, sizeof(request), "TOP 10\n");
+    else if (kind == 1) snprintf(request, sizeof(request), "COUNT %s %s\n", sampleFirst[pick], sampleSecond[pick]);
+    else snprintf(request, sizeof(request), "NEXT %s 10\n", sampleFirst[pick]);
+
+    long long start = nowNanos();
+    if (ask(&client, request, line, sizeof(line)) < 0) {
+      worker->failed = 1;
+      break;
+    }
+    worker->nanos[kind][worker->counts[kind]++] = nowNanos() - start;
+  }
+  close(client.fd);
+  return NULL;
+}
+
+// qsort compare function: ascending latencies
+static int compareNanos(const void* n1, const void* n2) {
+  int a = *(const int*) n1, b = *(const int*) n2;
+  return (a > b) - (a < b);
+}
+
+// print the latency percentiles of some requests
+static void printLatencies(const char* name, int* nanos, int count) {
+  if (count == 0) return;
+  qsort(nanos, count, sizeof(int), compareNanos);
+  printf("request=%s count=%d p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n", name, count,
+         nanos[count / 2] / 1e3, nanos[(long long) count * 99 / 100] / 1e3,
+         nanos[(long long) count * 999 / 1000] / 1e3, nanos[count - 1] / 1e3);
+}
+
+int main(int argc, char** argv) {
+  int requests = argc > 2 ? atoi(argv[2]) : 100000;
+  int connections = argc > 3 ? atoi(argv[3]) : 4;
+  Client client;
+  char line[1024];
+
+  if (argc < 2 || requests < 1 || connections < 1) {
+    fprintf(stderr, "usage: %s socket [requests] [connections]\n", argv[0]);
+    return 1;
+  }
+
+  // learn some words from the top pairs
+  sampleFirst = malloc(sizeof(*sampleFirst) * SAMPLE_PAIRS);
+  sampleSecond = malloc(sizeof(*sampleSecond) * SAMPLE_PAIRS);
+  if (connectClient(&client, argv[1]) != 0) {
+    fprintf(stderr, "Unable to connect to: %s\n", argv[1]);
+    return 1;
+  }
+  snprintf(line, sizeof(line), "TOP %d\n", SAMPLE_PAIRS);
+  if (write(client.fd, line, strlen(line)) < 0 || readLine(&client, line, sizeof(line)) < 0
+      || sscanf(line, "OK %d", &sampleCount) != 1) {
+    fprintf(stderr, "Unexpected answer from: %s\n", argv[1]);
+    return 1;
+  }
+  for (int i = 0; i < sampleCount; i++) {
+    int count;
+    if (readLine(&client, line, sizeof(line)) < 0
+        || sscanf(line, "%d %255s %255s", &count, sampleFirst[i], sampleSecond[i]) != 3) {
+      fprintf(stderr, "Unexpected answer from: %s (is it serving --format text?)\n", argv[1]);
+      return 1;
+    }
+  }
+  close(client.fd);
+  if (sampleCount == 0) {
+    fprintf(stderr, "No pairs served by: %s\n", argv[1]);
+    return 1;
+  }
+
+  // split the requests between the connections
+  Worker* workers = calloc(connections, sizeof(Worker));
+  pthread_t* threads = malloc(sizeof(pthread_t) * connections);
+  long long start = nowNanos();
+  for (int c = 0; c < connections; c++) {
+    workers[c].path = argv[1];
+    workers[c].requests = requests / connections + (c < requests % connections);
+    workers[c].seed = 360 + c;
+    for (int k = 0; k < REQUEST_KINDS; k++) {
+      workers[c].nanos[k] = malloc(sizeof(int) * (workers[c].requests / REQUEST_KINDS + 1));
+    }
+    pthread_create(&threads[c], NULL, runWorker, &workers[c]);
+  }
+  for (int c = 0; c < connections; c++) pthread_join(threads[c], NULL);
+  double seconds = (nowNanos() - start) / 1e9;
+
+  // gather the latencies by kind and overall
+  int* all = malloc(sizeof(int) * requests);
+  int allCount = 0, failed = 0;
+  for (int k = 0; k < REQUEST_KINDS; k++) {
+    int* kind = malloc(sizeof(int) * requests);
+    int kindCount = 0;
+    for (int c = 0; c < connections; c++) {
+      memcpy(kind + kindCount, workers[c].nanos[k], sizeof(int) * workers[c].counts[k]);
+      kindCount += workers[c].counts[k];
+    }
+    memcpy(all + allCount, kind, sizeof(int) * kindCount);
+    allCount += kindCount;
+    printLatencies(kindNames[k], kind, kindCount);
+    free(kind);
+  }
+  printLatencies("all", all, allCount);
+  for (int c = 0; c < connections; c++) failed += workers[c].failed;
+  printf("summary requests=%d connections=%d failed_connections=%d seconds=%.3f requests_per_sec=%.0f\n",
+         allCount, connections, failed, seconds, allCount / seconds);
+
+  for (int c = 0; c < connections; c++) {
+    for (int k = 0; k < REQUEST_KINDS; k++) free(workers[c].nanos[k]);
+  }
+  free(all);
+  free(workers);
+  free(threads);
+  free(sampleFirst);
+  free(sampleSecond);
+  return failed != 0;
+}
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../getWord.h"
+#include "../wordScan.h"
+
+// ************************************************
+// ************************************************
+// ** scanCheck is the differential test of the
+// ** tokenizer kernels. It generates random byte
+// ** streams and random punctuated text (mixed case,
+// ** digits, punctuation inside and around words,
+// ** every kind of whitespace and words longer than
+// ** DICT_MAX_WORD_LEN), tokenizes each with the
+// ** original getNextWord() and checks that
+// ** getNextWordSlice() yields exactly the same words
+// ** with every kernel set the CPU supports (scalar,
+// ** sse2, avx2) and from every kind of input:
+// **
+// **   mapped  a regular file, memory-mapped
+// **   read    a pipe, read() into a small buffer (the
+// **           Makefile builds it with a 61-byte
+// **           WORD_READ_BUFFER_SIZE so that words
+// **           straddle every buffer boundary)
+// **   blocks  blocks of random sizes from a fill()
+// **
+// ** It prints one line per kernel set and exits with
+// ** 1 at the first word that differs.
+// **
+// ** usage: scanCheck <rounds> <seed>
+
+#define SCAN_CHECK_ROUNDS 200
+#define SCAN_CHECK_MAX_SIZE 20000 // bytes of one input at most
+
+typedef struct _wordList {
+  char** words;
+  int count;
+} WordList;
+
+typedef struct _blockSource {
+  const char* data;
+  size_t size;
+  size_t pos;
+} BlockSource;
+
+// the input being checked, kept in a file for getNextWord() and mapping
+static char inputName[] = "/tmp/scanCheckXXXXXX";
+
+// one byte of punctuated text: mostly letters, some digits,
+// punctuation and whitespace, and now and then a very long word
+static size_t textByte(char* out, size_t pos, size_t size) {
+  static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  static const char other[] = "0123456789'-.,;:!?\"()";
+  static const char spaces[] = " \t\n\v\f\r";
+  int pick = rand() % 100;
+
+  if (pick < 60) out[pos++] = letters[rand() % (sizeof(letters) - 1)];
+  else if (pick < 75) out[pos++] = other[rand() % (sizeof(other) - 1)];
+  else if (pick < 99) out[pos++] = spaces[rand() % (sizeof(spaces) - 1)];
+  else {
+    int length = DICT_MAX_WORD_LEN - 3 + rand() % 8;
+    for (int i = 0; i < length && pos < size; i++) {
+      out[pos++] = rand() % 3 == 0 ? letters[rand() % (sizeof(letters) - 1)] : 'a' + rand() % 26;
+    }
+  }
+  return pos;
+}
+
+// fill data with size bytes of random bytes or of punctuated text;
+// 0xff is left out, since getNextWord() reads it as EOF
+static void generate(char* data, size_t size, int text) {
+  size_t pos = 0;
+
+  while (pos < size) {
+    if (text) pos = textByte(data, pos, size);
+    else data[pos++] = rand() % 255;
+  }
+}
+
+// the words getNextWord() finds in the input file
+static void referenceWords(WordList* list) {
+  FILE* in = fopen(inputName, "r");
+  char* word;
+
+  list->count = 0;
+  while ((word = getNextWord(in)) != NULL) list->words[list->count++] = word;
+  fclose(in);
+}
+
+// hand out the input in blocks of 1 to 100 bytes
+static int nextBlock(void* context, const char** data, size_t* size) {
+  BlockSource* source = context;
+
+  if (source->pos == source->size) return 0;
+  *data = source->data + source->pos;
+  *size = 1 + rand() % 100;
+  if (*size > source->size - source->pos) *size = source->size - source->pos;
+  source->pos += *size;
+  return 1;
+}
+
+// compare every word the reader yields with the reference words
+static int compareWords(WordReader* reader, WordList* expected, const char* scanner,
+                        const char* mode, int round) {
+  const char* word;
+  int length, count = 0;
+
+  while ((length = getNextWordSlice(reader, &word)) > 0) {
+    if (count == expected->count || (int) strlen(expected->words[count]) != length ||
+        memcmp(expected->words[count], word, length) != 0) {
+      fprintf(stderr, "%s %s round %d: word %d is \"%.*s\", expected \"%s\"\n", scanner, mode,
+              round, count, length, word, count < expected->count ? expected->words[count] : "(EOF)");
+      return 1;
+    }
+    count++;
+  }
+  if (count != expected->count) {
+    fprintf(stderr, "%s %s round %d: %d words, expected %d\n", scanner, mode, round, count,
+            expected->count);
+    return 1;
+  }
+  return 0;
+}
+
+// check one input with the current kernels, from every kind of input
+static int checkInput(const char* data, size_t size, WordList* expected, const char* scanner,
+                      int round) {
+  WordReader reader;
+  BlockSource source = {data, size, 0};
+  const char* first;
+  size_t firstSize = 0;
+  int pipeFds[2], failed;
+  pid_t writer;
+
+  // mapped (an empty file is read() instead, which is fine too)
+  if (openWordReader(&reader, inputName) != 0) return 1;
+  failed = compareWords(&reader, expected, scanner, "mapped", round);
+  closeWordReader(&reader);
+  if (failed) return 1;
+
+  // read() from a pipe, fed by a child process
+  if (pipe(pipeFds) != 0) return 1;
+  writer = fork();
+  if (writer == 0) {
+    close(pipeFds[0]);
+    for (size_t written = 0; written < size; ) {
+      ssize_t got = write(pipeFds[1], data + written, size - written);
+      if (got <= 0) _exit(1);
+      written += got;
+    }
+    _exit(0);
+  }
+  close(pipeFds[1]);
+  openWordReaderFd(&reader, pipeFds[0]);
+  failed = compareWords(&reader, expected, scanner, "read", round);
+  closeWordReader(&reader);
+  close(pipeFds[0]);
+  waitpid(writer, NULL, 0);
+  if (failed) return 1;
+
+  // blocks of random sizes
+  if (!nextBlock(&source, &first, &firstSize)) first = data;
+  openWordReaderBlocks(&reader, first, firstSize, nextBlock, &source);
+  failed = compareWords(&reader, expected, scanner, "blocks", round);
+  closeWordReader(&reader);
+  return failed;
+}
+
+int main(int argc, char** argv) {
+  static const char* scannerNames[] = {"scalar", "sse2", "avx2"};
+  int rounds = argc > 1 ? atoi(argv[1]) : SCAN_CHECK_ROUNDS;
+  unsigned seed = argc > 2 ? atoi(argv[2]) : 1;
+  char* data = malloc(SCAN_CHECK_MAX_SIZE);
+  WordList expected;
+  int checked[3] = {0, 0, 0};
+  int fd = mkstemp(inputName);
+
+  if (fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+  expected.words = malloc(sizeof(char*) * SCAN_CHECK_MAX_SIZE);
+
+  srand(seed);
+  for (int round = 0; round < rounds; round++) {
+    size_t size = rand() % SCAN_CHECK_MAX_SIZE;
+    FILE* out = fopen(inputName, "w");
+
+    generate(data, size, round % 2);
+    fwrite(data, 1, size, out);
+    fclose(out);
+    referenceWords(&expected);
+
+    for (int s = 0; s < 3; s++) {
+      const WordScanner* scanner = findWordScanner(scannerNames[s]);
+      if (scanner == NULL) continue;
+      setWordScanner(scanner);
+      if (checkInput(data, size, &expected, scannerNames[s], round) != 0) {
+        unlink(inputName);
+        return 1;
+      }
+      checked[s]++;
+    }
+    for (int i = 0; i < expected.count; i++) free(expected.words[i]);
+  }
+
+  for (int s = 0; s < 3; s++) {
+    if (checked[s]) printf("scanner=%s rounds=%d ok\n", scannerNames[s], checked[s]);
+    else printf("scanner=%s unsupported\n", scannerNames[s]);
+  }
+  unlink(inputName);
+  free(expected.words);
+  free(data);
+  return 0;
+}
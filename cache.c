@@ -0,0 +1,401 @@
+#include "cache.h"
+#include "ingest.h"
+#include "snapshot.h"
+#include "crc64.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+// ************************************************
+// ************************************************
+// ** cache.c implements incremental counting: the
+// ** pair counts of each input file are kept in a
+// ** cache directory between runs, and only files
+// ** whose contents changed are tokenized again.
+// **
+// ** See cache.h for the layout of the cache and
+// ** more information on each individual function.
+
+#define INPUT_UNCHANGED 0 // the cached counts of the file are current
+#define INPUT_CHANGED 1 // the file is new or changed and must be counted
+#define INPUT_UNCACHED 2 // the file cannot be cached (e.g. a pipe)
+#define INPUT_GONE 3 // (old entries only) the file is no longer named
+
+typedef struct _cacheInput {
+  CacheEntry entry; // what the new index will say about the file
+  CacheEntry* previous; // the file's entry in the old index (NULL if none)
+  int state; // INPUT_UNCHANGED, INPUT_CHANGED or INPUT_UNCACHED
+} CacheInput;
+
+// join the cache directory and a file name (free() the result)
+static char* cacheFile(const char* dir, const char* name) {
+  char* path = malloc(strlen(dir) + strlen(name) + 2);
+  sprintf(path, "%s/%s", dir, name);
+  return path;
+}
+
+// name of the totals snapshot of a generation of the cache
+static void totalsName(char* name, long long generation) {
+  sprintf(name, "totals-%lld.snap", generation);
+}
+
+// qsort/bsearch compare functions, by path
+static int comparePaths(const void* p1, const void* p2) {
+  return strcmp(*(char* const*) p1, *(char* const*) p2);
+}
+static int compareEntries(const void* e1, const void* e2) {
+  return strcmp(((const CacheEntry*) e1)->path, ((const CacheEntry*) e2)->path);
+}
+
+// free the entries read by readIndex()
+static void freeIndex(CacheEntry* entries, int count) {
+  for (int i = 0; i < count; i++) free(entries[i].path);
+  free(entries);
+}
+
+// read the index of a cache into an array sorted by path; returns 0,
+// or -1 (with no entries) if there is no index or it cannot be parsed
+static int readIndex(const char* dir, CacheEntry** entries, int* count, long long* generation) {
+  char* path = cacheFile(dir, CACHE_INDEX);
+  FILE* file = fopen(path, "r");
+  char* line = NULL;
+  size_t lineSize = 0;
+  int capacity = 64, version, pathStart, ok = 1;
+
+  free(path);
+  *entries = NULL;
+  *count = 0;
+  if (file == NULL) return -1;
+  if (getline(&line, &lineSize, file) < 0
+      || sscanf(line, "wordpairs-cache %d %lld", &version, generation) != 2
+      || version != CACHE_VERSION) {
+    ok = 0;
+  }
+
+  *entries = malloc(sizeof(CacheEntry) * capacity);
+  while (ok && getline(&line, &lineSize, file) > 0) {
+    CacheEntry* entry;
+    if (*count == capacity) *entries = realloc(*entries, sizeof(CacheEntry) * (capacity *= 2));
+    entry = &(*entries)[*count];
+    pathStart = 0;
+    sscanf(line, "%lld %lld %lld %llx %d %47s %n", &entry->size, &entry->mtimeSeconds,
+           &entry->mtimeNanos, &entry->contentHash, &entry->copies, entry->snapshot, &pathStart);
+    if (pathStart == 0 || line[pathStart] == '\0' || line[pathStart] == '\n') {
+      ok = 0;
+      break;
+    }
+    line[strcspn(line, "\n")] = '\0';
+    entry->path = strdup(line + pathStart);
+    (*count)++;
+  }
+  free(line);
+  fclose(file);
+
+  if (!ok) {
+    freeIndex(*entries, *count);
+    *entries = NULL;
+    *count = 0;
+    return -1;
+  }
+  qsort(*entries, *count, sizeof(CacheEntry), compareEntries);
+  return 0;
+}
+
+// write a new index listing the cached inputs and commit it (rename)
+static int writeIndex(const char* dir, CacheInput* inputs, int inputCount, long long generation) {
+  char* path = cacheFile(dir, CACHE_INDEX ".tmp");
+  char* final = cacheFile(dir, CACHE_INDEX);
+  FILE* file = fopen(path, "w");
+  int ok = file != NULL;
+
+  if (ok) fprintf(file, "wordpairs-cache %d %lld\n", CACHE_VERSION, generation);
+  for (int i = 0; ok && i < inputCount; i++) {
+    CacheEntry* entry = &inputs[i].entry;
+    if (inputs[i].state == INPUT_UNCACHED) continue;
+    fprintf(file, "%lld %lld %lld %016llx %d %s %s\n", entry->size, entry->mtimeSeconds,
+            entry->mtimeNanos, entry->contentHash, entry->copies, entry->snapshot, entry->path);
+  }
+  if (file != NULL && fclose(file) != 0) ok = 0;
+  if (ok && rename(path, final) != 0) ok = 0;
+  free(path);
+  free(final);
+  return ok ? 0 : -1;
+}
+
+// add (or subtract) a snapshot in the cache to a HashTable
+static int applyCacheFile(HashTable* hashTable, const char* dir, const char* name, int subtract) {
+  char* path = cacheFile(dir, name);
+  int result = subtract ? unloadSnapshot(hashTable, path) : loadSnapshot(hashTable, path);
+  free(path);
+  return result;
+}
+
+// save a HashTable as a snapshot in the cache (written under a
+// temporary name first, so a snapshot is either complete or absent)
+static int saveCacheFile(HashTable* hashTable, const char* dir, const char* name) {
+  char* path = cacheFile(dir, name);
+  char* temporary = malloc(strlen(path) + 5);
+  int result;
+
+  sprintf(temporary, "%s.tmp", path);
+  result = saveSnapshot(hashTable, temporary);
+  if (result == 0) result = rename(temporary, path);
+  free(temporary);
+  free(path);
+  return result;
+}
+
+// delete a file from the cache
+static void removeCacheFile(const char* dir, const char* name) {
+  char* path = cacheFile(dir, name);
+  unlink(path);
+  free(path);
+}
+
+// delete every snapshot (or temporary file) in the cache that is
+// neither the totals nor the snapshot of one of the inputs
+static void sweepCache(const char* dir, CacheInput* inputs, int inputCount, const char* totals) {
+  DIR* directory = opendir(dir);
+  struct dirent* file;
+  char** kept = malloc(sizeof(char*) * (inputCount + 1));
+  int keptCount = 0;
+
+  if (directory == NULL) {
+    free(kept);
+    return;
+  }
+  for (int i = 0; i < inputCount; i++) {
+    if (inputs[i].state != INPUT_UNCACHED) kept[keptCount++] = inputs[i].entry.snapshot;
+  }
+  kept[keptCount++] = (char*) totals;
+  qsort(kept, keptCount, sizeof(char*), comparePaths);
+
+  while ((file = readdir(directory)) != NULL) {
+    size_t length = strlen(file->d_name);
+    char* name = file->d_name;
+    if ((length < 5 || strcmp(name + length - 5, ".snap") != 0)
+        && (length < 4 || strcmp(name + length - 4, ".tmp") != 0)) continue;
+    if (bsearch(&name, kept, keptCount, sizeof(char*), comparePaths) == NULL) {
+      removeCacheFile(dir, name);
+    }
+  }
+  closedir(directory);
+  free(kept);
+}
+
+// hash the contents of a file of the given size
+static int hashContents(const char* path, long long size, unsigned long long* hash) {
+  int fd = open(path, O_RDONLY);
+  void* map;
+
+  if (fd < 0) return -1;
+  if (size == 0) {
+    close(fd);
+    *hash = crc64s8("", 0);
+    return 0;
+  }
+  map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return -1;
+  madvise(map, size, MADV_SEQUENTIAL);
+  *hash = crc64s8(map, size);
+  munmap(map, size);
+  return 0;
+}
+
+// decide whether an input file named copies times has changed since
+// its entry in the old index was written
+static int describeInput(CacheInput* input, char* path, int copies,
+                         CacheEntry* old, int oldCount) {
+  CacheEntry key;
+  struct stat st;
+
+  if (stat(path, &st) != 0) return -1;
+  memset(input, 0, sizeof(CacheInput));
+  input->entry.path = path;
+  input->entry.copies = copies;
+  if (!S_ISREG(st.st_mode) || strchr(path, '\n') != NULL) {
+    input->state = INPUT_UNCACHED;
+    return 0;
+  }
+  input->entry.size = st.st_size;
+  input->entry.mtimeSeconds = st.st_mtim.tv_sec;
+  input->entry.mtimeNanos = st.st_mtim.tv_nsec;
+
+  key.path = path;
+  CacheEntry* previous = bsearch(&key, old, oldCount, sizeof(CacheEntry), compareEntries);
+  input->previous = previous;
+
+  // same size and mtime: trust the cached counts without reading the file
+  if (previous != NULL && previous->copies == copies && previous->size == input->entry.size
+      && previous->mtimeSeconds == input->entry.mtimeSeconds
+      && previous->mtimeNanos == input->entry.mtimeNanos) {
+    input->entry.contentHash = previous->contentHash;
+    strcpy(input->entry.snapshot, previous->snapshot);
+    input->state = INPUT_UNCHANGED;
+    return 0;
+  }
+
+  // otherwise compare the contents (the file may only have been touched)
+  if (hashContents(path, input->entry.size, &input->entry.contentHash) != 0) return -1;
+  if (previous != NULL && previous->copies == copies && previous->size == input->entry.size
+      && previous->contentHash == input->entry.contentHash) {
+    strcpy(input->entry.snapshot, previous->snapshot);
+    input->state = INPUT_UNCHANGED;
+    return 0;
+  }
+  sprintf(input->entry.snapshot, "%016llx-%016llx.snap",
+          crc64n(path, strlen(path)), input->entry.contentHash);
+  input->state = INPUT_CHANGED;
+  return 0;
+}
+
+// bring the totals of the previous run up to date by taking back the
+// counts of every file that changed or is no longer named; returns 0,
+// or -1 if there are no usable totals
+static int updateTotals(HashTable* totals, const char* dir, long long generation,
+                        CacheEntry* old, int oldCount, char* oldState) {
+  char name[48];
+
+  totalsName(name, generation);
+  if (applyCacheFile(totals, dir, name, 0) != 0) return -1;
+  for (int i = 0; i < oldCount; i++) {
+    if (oldState[i] == INPUT_UNCHANGED) continue;
+    for (int c = 0; c < old[i].copies; c++) {
+      if (applyCacheFile(totals, dir, old[i].snapshot, 1) != 0) return -1;
+    }
+  }
+  return 0;
+}
+
+// add the cached counts of every unchanged file to empty totals; files
+// whose snapshots are missing or damaged are marked to be counted again
+static void rebuildTotals(HashTable* totals, const char* dir, CacheInput* inputs, int inputCount) {
+  for (int i = 0; i < inputCount; i++) {
+    if (inputs[i].state != INPUT_UNCHANGED) continue;
+    for (int c = 0; c < inputs[i].entry.copies; c++) {
+      // a failed load changes nothing, and every copy fails alike
+      if (applyCacheFile(totals, dir, inputs[i].entry.snapshot, 0) != 0) {
+        inputs[i].state = INPUT_CHANGED;
+        break;
+      }
+    }
+  }
+}
+
+// count files, reusing the counts cached for unchanged ones:
+int countCached(HashTable* hashTable, const char* dir, char** paths, int pathCount,
+                int threads, const char** failed) {
+  CacheEntry* old; // entries of the previous run, sorted by path
+  int oldCount;
+  long long generation = 0; // bumped every time the index is replaced
+  char name[48];
+  int result = -1;
+  int i, c;
+
+  *failed = dir;
+  if (mkdir(dir, 0777) != 0 && errno != EEXIST) return -1;
+  int haveIndex = readIndex(dir, &old, &oldCount, &generation) == 0;
+  char* oldState = malloc(oldCount ? oldCount : 1); // INPUT_* of each old entry
+  memset(oldState, INPUT_GONE, oldCount);
+
+  // sort the names so that repeats of a path are next to each other
+  char** sorted = malloc(sizeof(char*) * (pathCount ? pathCount : 1));
+  CacheInput* inputs = malloc(sizeof(CacheInput) * (pathCount ? pathCount : 1));
+  int inputCount = 0, copies;
+  memcpy(sorted, paths, sizeof(char*) * pathCount);
+  qsort(sorted, pathCount, sizeof(char*), comparePaths);
+  for (i = 0; i < pathCount; i += copies) {
+    copies = 1;
+    while (i + copies < pathCount && strcmp(sorted[i], sorted[i + copies]) == 0) copies++;
+    if (describeInput(&inputs[inputCount], sorted[i], copies, old, oldCount) != 0) {
+      *failed = sorted[i];
+      goto done;
+    }
+    if (inputs[inputCount].previous != NULL) {
+      oldState[inputs[inputCount].previous - old] = inputs[inputCount].state;
+    }
+    inputCount++;
+  }
+
+  // start from the previous totals, or from the cached files if there
+  // are none that can be used
+  HashTable* totals = initHashTable();
+  if (!haveIndex || updateTotals(totals, dir, generation, old, oldCount, oldState) != 0) {
+    destroy(totals);
+    totals = initHashTable();
+    rebuildTotals(totals, dir, inputs, inputCount);
+  }
+
+  // count the new and changed files, keeping a snapshot of each
+  for (i = 0; i < inputCount; i++) {
+    if (inputs[i].state == INPUT_UNCHANGED) {
+      addStat(&runStats.cachedFiles, inputs[i].entry.copies);
+    }
+    if (inputs[i].state != INPUT_CHANGED) continue;
+    HashTable* counted = initHashTable();
+    if (countFile(counted, inputs[i].entry.path, threads) != 0) {
+      *failed = inputs[i].entry.path;
+      destroy(counted);
+      destroy(totals);
+      goto done;
+    }
+    if (saveCacheFile(counted, dir, inputs[i].entry.snapshot) != 0) {
+      destroy(counted);
+      destroy(totals);
+      goto done;
+    }
+    for (c = 0; c < inputs[i].entry.copies; c++) mergeHashTable(totals, counted);
+    destroy(counted);
+  }
+
+  // save the new totals and commit them with the new index
+  totalsName(name, generation + 1);
+  if (saveCacheFile(totals, dir, name) != 0
+      || writeIndex(dir, inputs, inputCount, generation + 1) != 0) {
+    removeCacheFile(dir, name);
+    destroy(totals);
+    goto done;
+  }
+
+  // the previous totals, the snapshots of files that changed or are
+  // gone, and anything left by an interrupted run are now unreferenced
+  sweepCache(dir, inputs, inputCount, name);
+
+  // hand the totals over (a plain swap if nothing was counted yet and
+  // the table has no size limit)
+  if (hashTable->uniqueCount == 0 && hashTable->dict->wordCount == 0 && hashTable->maxRows == 0) {
+    HashTable swap = *hashTable;
+    *hashTable = *totals;
+    *totals = swap;
+  } else {
+    mergeHashTable(hashTable, totals);
+  }
+  destroy(totals);
+
+  // files that cannot be cached are counted directly, every time
+  for (i = 0; i < inputCount; i++) {
+    if (inputs[i].state != INPUT_UNCACHED) continue;
+    for (c = 0; c < inputs[i].entry.copies; c++) {
+      if (countFile(hashTable, inputs[i].entry.path, threads) != 0) {
+        *failed = inputs[i].entry.path;
+        goto done;
+      }
+    }
+  }
+  result = 0;
+
+done:
+  free(inputs);
+  free(sorted);
+  free(oldState);
+  freeIndex(old, oldCount);
+  return result;
+}
@@ -0,0 +1,57 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "hash.h"
+
+#define CACHE_INDEX "index" // name of the index file in a cache directory
+#define CACHE_VERSION 1 // bumped whenever the index format changes
+
+typedef struct _cacheEntry {
+  char* path; // input file as named on the command line
+  long long size; // size of the file when it was counted
+  long long mtimeSeconds; // modification time of the file when counted
+  long long mtimeNanos; // (nanosecond part)
+  unsigned long long contentHash; // crc64s8() of the file's contents
+  int copies; // # of times the path was named (each copy is counted)
+  char snapshot[48]; // the file's pair counts, a snapshot in the cache
+} CacheEntry;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  count files through a cache: countCached(HashTable*, const char*,
+// **                                            char**, int, int, const char**)
+// **
+// ** A cache directory remembers the pair counts of every file of the
+// ** previous run, so a run only tokenizes the files that changed. It
+// ** holds one snapshot (see snapshot.h) per counted file, a snapshot of
+// ** the totals of all of them, and an index:
+// **
+// **   wordpairs-cache VERSION GENERATION
+// **   size mtime-seconds mtime-nanos content-hash copies snapshot path
+// **   ...
+// **
+// ** A file is unchanged if its size and mtime match its entry, or if
+// ** they do not but its size and content hash do. The totals are
+// ** brought up to date by subtracting the old snapshot of every file
+// ** that changed or is no longer named (unloadSnapshot()) and adding
+// ** the new counts of the changed files, so the work done is
+// ** proportional to the changed data plus the size of the totals, not
+// ** to all of the input. New files are written under new names and the
+// ** index is replaced with rename(), which is what commits a run: an
+// ** interrupted run leaves the previous index and its files intact.
+// ** Once it is committed, every snapshot in the directory that the new
+// ** index does not refer to is deleted.
+
+// countCached() counts the files named by the third argument (the fourth
+// argument is how many there are) into the HashTable, using and updating
+// the cache directory named by the second argument (created if needed).
+// The fifth argument is the thread count passed on to countFile(). The
+// result is exactly what counting every file with countFile() would give.
+// Files that are not regular files are counted every time and never
+// cached. The function returns 0 on success. If a file cannot be opened,
+// or the cache cannot be written, it returns -1 (with errno set) and points
+// the last argument at the name of the file or cache directory.
+int countCached(HashTable*, const char*, char**, int, int, const char**);
+
+#endif
@@ -1,12 +1,17 @@
+#include <string.h>
 #include "crc64.h"
 
 #define CRC64_REV_POLY      0x95AC9329AC4BC9B5ULL
 #define CRC64_INITIALIZER   0xFFFFFFFFFFFFFFFFULL
 #define CRC64_TABLE_SIZE    256
 
-unsigned long long crc64(char* string) {
+/* table[0] is the classic byte-at-a-time table; table[k] gives the  */
+/* effect of a byte followed by k zero bytes, which is what lets     */
+/* crc64s8 fold eight bytes per step ("slicing-by-8").               */
+
+static unsigned long long (*crc64Tables(void))[CRC64_TABLE_SIZE] {
     static int initFlag = 0;
-    static unsigned long long table[CRC64_TABLE_SIZE];
+    static unsigned long long table[8][CRC64_TABLE_SIZE];
     
     if (!initFlag) { initFlag++;
         for (int i = 0; i < CRC64_TABLE_SIZE; i++) {
@@ -16,12 +21,47 @@ unsigned long long crc64(char* string) {
                     part = (part >> 1) ^ CRC64_REV_POLY;
                 else part >>= 1;
             }
-            table[i] = part;
+            table[0][i] = part;
         }
+        for (int k = 1; k < 8; k++)
+            for (int i = 0; i < CRC64_TABLE_SIZE; i++)
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
     }
-    
+    return table;
+}
+
+unsigned long long crc64(char* string) {
+    unsigned long long* table = crc64Tables()[0];
     unsigned long long crc = CRC64_INITIALIZER;
     while (*string)
         crc = table[(crc ^ *string++) & 0xff] ^ (crc >> 8);
     return crc;
 }
+
+unsigned long long crc64n(const char* string, int length) {
+    unsigned long long* table = crc64Tables()[0];
+    unsigned long long crc = CRC64_INITIALIZER;
+    while (length-- > 0)
+        crc = table[(crc ^ *string++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+unsigned long long crc64s8(const char* string, size_t length) {
+    unsigned long long (*table)[CRC64_TABLE_SIZE] = crc64Tables();
+    unsigned long long crc = CRC64_INITIALIZER;
+    unsigned long long word;
+
+    while (length >= 8) {
+        memcpy(&word, string, 8);       /* little-endian load assumed */
+        crc ^= word;
+        crc = table[7][crc & 0xff] ^ table[6][(crc >> 8) & 0xff] ^
+              table[5][(crc >> 16) & 0xff] ^ table[4][(crc >> 24) & 0xff] ^
+              table[3][(crc >> 32) & 0xff] ^ table[2][(crc >> 40) & 0xff] ^
+              table[1][(crc >> 48) & 0xff] ^ table[0][crc >> 56];
+        string += 8;
+        length -= 8;
+    }
+    while (length-- > 0)
+        crc = table[0][(crc ^ *string++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
@@ -1,6 +1,8 @@
 #ifndef CRC64_H
 #define CRC64_H
 
+#include <stddef.h>
+
 /* interface to CRC 64 module */
 
 /* crc64 takes a string argument and computes a 64-bit hash based on */
@@ -8,4 +10,15 @@
 
 unsigned long long crc64(char* string);
 
+/* crc64n computes the same hash over the first length bytes of a    */
+/* string that does not have to be NUL-terminated.                   */
+
+unsigned long long crc64n(const char* string, int length);
+
+/* crc64s8 computes the same value as crc64n, but folds in eight     */
+/* bytes per table step (slicing-by-8) instead of one.  It assumes a */
+/* little-endian machine.                                            */
+
+unsigned long long crc64s8(const char* string, size_t length);
+
 #endif
@@ -0,0 +1,190 @@
+#include "dict.h"
+#include "wordHash.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ************************************************
+// ************************************************
+// ** dict.c is the word dictionary used by the
+// ** pair table in hash.c. Every distinct word is
+// ** stored once and given a dense 32-bit id. The
+// ** slots use open addressing with linear probing;
+// ** each slot keeps the low 32 bits of the word's
+// ** hash so that most mismatches are rejected
+// ** without touching the word text.
+// **
+// ** See dict.h for more information on each
+// ** individual function and wordHash.h for the
+// ** hash functions words can be hashed with.
+
+// round a requested size up to a power of two (minimum 16)
+static int powerOfTwo(int rows) {
+  int size = 16;
+  while (size < rows) size <<= 1;
+  return size;
+}
+
+// allocate an array of empty slots
+static DictSlot* newSlots(int rows) {
+  DictSlot* slots = malloc(sizeof(DictSlot) * rows);
+  for (int i = 0; i < rows; i++) {
+    slots[i].id = DICT_EMPTY;
+  }
+  return slots;
+}
+
+// create a new dictionary:
+Dictionary* createDictionary(int rows) {
+  Dictionary* dict = malloc(sizeof(Dictionary));
+  dict->hash = wordHash()->hash;
+  dict->rowCount = powerOfTwo(rows);
+  dict->slots = newSlots(dict->rowCount);
+  dict->wordCount = 0;
+  dict->wordCapacity = dict->rowCount / 2;
+  dict->words = malloc(sizeof(char*) * dict->wordCapacity);
+  initArena(&dict->arena, 0);
+  dict->lengths = malloc(sizeof(unsigned char) * dict->wordCapacity);
+  dict->order = NULL;
+  dict->rank = NULL;
+  dict->sortedCount = -1;
+  return dict;
+}
+
+// double the number of slots and re-place every word; the stored
+// hash fragment means no word has to be hashed again
+static void expandDictionary(Dictionary* dict) {
+  int newRowCount = dict->rowCount * 2;
+  unsigned int mask = newRowCount - 1;
+  DictSlot* newTable = newSlots(newRowCount);
+
+  for (int i = 0; i < dict->rowCount; i++) {
+    if (dict->slots[i].id != DICT_EMPTY) {
+      unsigned int index = dict->slots[i].hash & mask;
+      while (newTable[index].id != DICT_EMPTY) {
+        index = (index + 1) & mask;
+      }
+      newTable[index] = dict->slots[i];
+    }
+  }
+  free(dict->slots);
+  dict->slots = newTable;
+  dict->rowCount = newRowCount;
+}
+
+// intern a word, returning its id:
+unsigned int internWord(Dictionary* dict, const char* word, int length) {
+  unsigned int hash = (unsigned int) dict->hash(word, length);
+  unsigned int mask = dict->rowCount - 1;
+  unsigned int index = hash & mask;
+
+  // probe until we find the word or an empty slot
+  while (dict->slots[index].id != DICT_EMPTY) {
+    unsigned int id = dict->slots[index].id;
+    if (dict->slots[index].hash == hash && dict->lengths[id] == length
+        && memcmp(dict->words[id], word, length) == 0) {
+      return id; // word already interned
+    }
+    index = (index + 1) & mask;
+  }
+
+  // new word: store a copy and give it the next id
+  if (dict->wordCount == dict->wordCapacity) {
+    dict->wordCapacity *= 2;
+    dict->words = realloc(dict->words, sizeof(char*) * dict->wordCapacity);
+    dict->lengths = realloc(dict->lengths, sizeof(unsigned char) * dict->wordCapacity);
+  }
+  unsigned int id = dict->wordCount++;
+  dict->words[id] = arenaCopy(&dict->arena, word, length);
+  dict->lengths[id] = length;
+  dict->slots[index].hash = hash;
+  dict->slots[index].id = id;
+
+  // check load factor and expand the slots if needed
+  if ((double) dict->wordCount / dict->rowCount > DICT_LOAD_FACTOR) {
+    expandDictionary(dict);
+  }
+  return id;
+}
+
+// look up a word without interning it:
+unsigned int findWord(Dictionary* dict, const char* word, int length) {
+  unsigned int hash = (unsigned int) dict->hash(word, length);
+  unsigned int mask = dict->rowCount - 1;
+  unsigned int index = hash & mask;
+
+  while (dict->slots[index].id != DICT_EMPTY) {
+    unsigned int id = dict->slots[index].id;
+    if (dict->slots[index].hash == hash && dict->lengths[id] == length
+        && memcmp(dict->words[id], word, length) == 0) {
+      return id;
+    }
+    index = (index + 1) & mask;
+  }
+  return DICT_EMPTY;
+}
+
+// look up the text of an id:
+const char* dictionaryWord(Dictionary* dict, unsigned int id) {
+  return dict->words[id];
+}
+
+// word/id pairs sorted by sortDictionary()
+typedef struct _rankedWord {
+  const char* word;
+  unsigned int id;
+} RankedWord;
+
+// qsort's compare function to sort words alphabetically
+static int compareWords(const void* w1, const void* w2) {
+  return strcmp(((const RankedWord*) w1)->word, ((const RankedWord*) w2)->word);
+}
+
+// rank every word alphabetically:
+void sortDictionary(Dictionary* dict) {
+  if (dict->sortedCount == dict->wordCount) return; // already up to date
+
+  size_t count = dict->wordCount;
+  RankedWord* ranked = malloc(sizeof(RankedWord) * (count ? count : 1));
+  for (size_t i = 0; i < count; i++) {
+    ranked[i].word = dict->words[i];
+    ranked[i].id = i;
+  }
+  qsort(ranked, count, sizeof(RankedWord), compareWords);
+
+  free(dict->order);
+  free(dict->rank);
+  dict->order = malloc(sizeof(unsigned int) * (count ? count : 1));
+  dict->rank = malloc(sizeof(unsigned int) * (count ? count : 1));
+  for (size_t i = 0; i < count; i++) {
+    dict->order[i] = ranked[i].id;
+    dict->rank[ranked[i].id] = i;
+  }
+  dict->sortedCount = count;
+  free(ranked);
+}
+
+// find a word's rank by binary search:
+unsigned int findRank(Dictionary* dict, const char* word) {
+  unsigned int low = 0; // the rank is in [low, high)
+  unsigned int high = dict->sortedCount > 0 ? dict->sortedCount : 0; // (-1 if never sorted)
+
+  while (low < high) {
+    unsigned int middle = low + (high - low) / 2;
+    int order = strcmp(word, dict->words[dict->order[middle]]);
+    if (order == 0) return middle;
+    if (order < 0) high = middle;
+    else low = middle + 1;
+  }
+  return DICT_EMPTY;
+}
+
+// free the dictionary and every word stored in it:
+void destroyDictionary(Dictionary* dict) {
+  freeArena(&dict->arena); // every word at once
+  free(dict->words);
+  free(dict->lengths);
+  free(dict->order);
+  free(dict->rank);
+  free(dict->slots);
+  free(dict);
+}
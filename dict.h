@@ -0,0 +1,94 @@
+#ifndef DICT_H
+#define DICT_H
+
+#include <stddef.h>
+#include "arena.h"
+
+#ifndef INITIAL_DICT_SIZE
+#define INITIAL_DICT_SIZE 1024
+#endif
+
+#ifndef DICT_LOAD_FACTOR
+#define DICT_LOAD_FACTOR 0.5
+#endif
+
+#define DICT_EMPTY 0xFFFFFFFFu // id stored in unused dictionary slots
+
+typedef struct _dictSlot {
+  unsigned int hash; // low 32 bits of the word's hash value
+  unsigned int id; // id of the word in this slot, DICT_EMPTY if unused
+} DictSlot;
+
+typedef struct _dictionary {
+  unsigned long long (*hash)(const char*, size_t); // word hash (see wordHash.h)
+  DictSlot* slots; // open addressing (linear probing) array of slots
+  int rowCount; // # of slots, always a power of two
+  char** words; // words[id] is the NUL-terminated text of word id
+  Arena arena; // owns the text of every word
+  unsigned char* lengths; // lengths[id] is the length of word id
+  int wordCount; // # of distinct words (ids 0..wordCount-1 are in use)
+  int wordCapacity; // allocated length of words[] and lengths[]
+  unsigned int* order; // order[rank] = id of the rank'th word alphabetically
+  unsigned int* rank; // rank[id] = alphabetical position of word id
+  int sortedCount; // wordCount when order[]/rank[] were built (-1 if never)
+} Dictionary;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  create Dictionary: createDictionary(int)
+// **  map a word to its id: internWord(Dictionary*, const char*, int)
+// **  look a word up without adding it: findWord(Dictionary*, const char*, int)
+// **  map an id back to its word: dictionaryWord(Dictionary*, unsigned)
+// **  rank words alphabetically: sortDictionary(Dictionary*)
+// **  find a word's rank by binary search: findRank(Dictionary*, const char*)
+// **  free memory stored in Dictionary: destroyDictionary(Dictionary*)
+// **
+// ** A Dictionary interns every distinct word exactly once and
+// ** hands out dense ids (0, 1, 2, ...) in order of first
+// ** appearance, so the pair table only ever has to store two
+// ** 32-bit ids per pair instead of two copies of the text.
+
+// createDictionary() creates an empty Dictionary with at least the
+// number of slots passed as an argument (rounded up to a power of two).
+// Its words are hashed with the function wordHash() returns at the time.
+Dictionary* createDictionary(int);
+
+// internWord() looks up the word of the given length (it does not
+// need to be NUL-terminated) and returns its id. Slots whose stored hash
+// matches are only accepted after comparing the length and the bytes of
+// the word, so two words with equal hashes never merge. If the word has not
+// been seen before, a copy of it is stored and it receives the next
+// unused id (the copy is carved out of the Dictionary's Arena, so
+// only every ARENA_CHUNK_SIZE bytes of new words cost a malloc()). The
+// Dictionary doubles its slots when the load factor
+// reaches DICT_LOAD_FACTOR.
+unsigned int internWord(Dictionary*, const char*, int);
+
+// findWord() returns the id of the word of the given length like
+// internWord() does, but returns DICT_EMPTY instead of adding a word it
+// has not seen. It never changes the Dictionary, so any number of
+// threads may call it at once (as long as none interns words meanwhile).
+unsigned int findWord(Dictionary*, const char*, int);
+
+// dictionaryWord() returns the NUL-terminated text of an id returned
+// by internWord().
+const char* dictionaryWord(Dictionary*, unsigned int);
+
+// sortDictionary() fills in the order[] and rank[] arrays of the
+// Dictionary so that words can be compared alphabetically by comparing
+// their ranks. The arrays are only rebuilt if words have been added
+// since the last call.
+void sortDictionary(Dictionary*);
+
+// findRank() returns the alphabetical rank of the given NUL-terminated
+// word by binary search over order[], or DICT_EMPTY if it has not been
+// seen. sortDictionary() must have been called since the last word was
+// added. Like findWord(), it never changes the Dictionary.
+unsigned int findRank(Dictionary*, const char*);
+
+// destroyDictionary() frees the Dictionary, its slots and all of the
+// words stored in it (by releasing the Arena's chunks, not word by word).
+void destroyDictionary(Dictionary*);
+
+#endif
@@ -0,0 +1,129 @@
+#include "fileList.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// ************************************************
+// ************************************************
+// ** fileList.c expands the inputs of a run into
+// ** the list of files to count: directories are
+// ** searched with scandir() (which also sorts
+// ** each directory), and list files are read
+// ** whole and split at NULs or newlines.
+// **
+// ** See fileList.h for more information on each
+// ** individual function.
+
+#define FILE_LIST_INITIAL_CAPACITY 64
+#define FILE_LIST_READ_SIZE (1 << 16) // bytes read from a list file at a time
+
+// set up an empty list:
+void initFileList(FileList* list) {
+  list->paths = NULL;
+  list->count = 0;
+  list->capacity = 0;
+  initArena(&list->names, 0);
+}
+
+// add one path to the end of the list
+static void appendPath(FileList* list, char* path) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : FILE_LIST_INITIAL_CAPACITY;
+    list->paths = realloc(list->paths, sizeof(char*) * list->capacity);
+  }
+  list->paths[list->count++] = path;
+}
+
+// add every regular file under a directory, recursively
+static int addDirectory(FileList* list, const char* directory) {
+  struct dirent** entries;
+  int entryCount = scandir(directory, &entries, NULL, alphasort);
+  size_t directoryLength = strlen(directory);
+  int result = 0;
+
+  if (entryCount < 0) return -1;
+  if (directoryLength > 0 && directory[directoryLength - 1] == '/') directoryLength--;
+  for (int i = 0; i < entryCount; i++) {
+    const char* name = entries[i]->d_name;
+    unsigned char type = entries[i]->d_type;
+    if (result == 0 && strcmp(name, ".") != 0 && strcmp(name, "..") != 0) {
+      size_t nameLength = strlen(name);
+      char* path = arenaAlloc(&list->names, directoryLength + nameLength + 2);
+      struct stat info;
+      memcpy(path, directory, directoryLength);
+      path[directoryLength] = '/';
+      memcpy(path + directoryLength + 1, name, nameLength + 1);
+
+      // the entry's type usually comes with it; ask only when it does not
+      if (type == DT_UNKNOWN) {
+        if (lstat(path, &info) != 0) type = DT_REG; // let the counting report it
+        else if (S_ISDIR(info.st_mode)) type = DT_DIR;
+        else if (S_ISREG(info.st_mode)) type = DT_REG;
+        else if (S_ISLNK(info.st_mode)) type = DT_LNK;
+      }
+      if (type == DT_LNK && stat(path, &info) == 0 && S_ISREG(info.st_mode)) type = DT_REG;
+
+      if (type == DT_DIR) result = addDirectory(list, path);
+      else if (type == DT_REG) appendPath(list, path);
+    }
+    free(entries[i]);
+  }
+  free(entries);
+  return result;
+}
+
+// add a file, or every file under a directory:
+int addPath(FileList* list, const char* path) {
+  struct stat info;
+
+  if (stat(path, &info) == 0 && S_ISDIR(info.st_mode)) return addDirectory(list, path);
+  appendPath(list, (char*) path);
+  return 0;
+}
+
+// add the files named in a list file:
+int readFileList(FileList* list, const char* listName) {
+  FILE* in = strcmp(listName, "-") == 0 ? stdin : fopen(listName, "r");
+  char* text = NULL;
+  size_t size = 0, capacity = 0, got;
+
+  if (in == NULL) return -1;
+  do {
+    if (size + FILE_LIST_READ_SIZE > capacity) {
+      capacity = capacity ? capacity * 2 : FILE_LIST_READ_SIZE;
+      text = realloc(text, capacity);
+    }
+    got = fread(text + size, 1, FILE_LIST_READ_SIZE, in);
+    size += got;
+  } while (got > 0);
+  if (ferror(in)) {
+    int error = errno;
+    if (in != stdin) fclose(in);
+    free(text);
+    errno = error;
+    return -1;
+  }
+  if (in != stdin) fclose(in);
+
+  // NUL-separated if there is a NUL anywhere, newline-separated otherwise
+  char separator = memchr(text, '\0', size) != NULL ? '\0' : '\n';
+  size_t start = 0;
+  int result = 0;
+  for (size_t i = 0; i <= size && result == 0; i++) {
+    if (i == size || text[i] == separator) {
+      if (i > start) result = addPath(list, arenaCopy(&list->names, text + start, i - start));
+      start = i + 1;
+    }
+  }
+  free(text);
+  return result;
+}
+
+// free the array of paths and the copies:
+void freeFileList(FileList* list) {
+  free(list->paths);
+  freeArena(&list->names);
+}
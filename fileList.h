@@ -0,0 +1,51 @@
+#ifndef FILELIST_H
+#define FILELIST_H
+
+#include "arena.h"
+
+typedef struct _fileList {
+  char** paths; // the files to count, in order
+  int count; // # of paths
+  int capacity; // # of paths the array has room for
+  Arena names; // copies of the paths found in directories and lists
+} FileList;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  set up an empty list: initFileList(FileList*)
+// **  add a file, or every file under a directory: addPath(FileList*, const char*)
+// **  add the files named in a list file: readFileList(FileList*, const char*)
+// **  free memory: freeFileList(FileList*)
+// **
+// ** A FileList gathers the files a run counts from the command line,
+// ** from directories (searched recursively) and from --files-from
+// ** lists, which have no ARG_MAX limit. Paths given directly are kept
+// ** as they are (they must outlive the list, as argv does); the paths
+// ** found in directories and lists are copied into the list's Arena,
+// ** so a list of millions of files costs a few large allocations.
+
+// initFileList() sets up an empty FileList.
+void initFileList(FileList*);
+
+// addPath() adds a path to the list. A directory is replaced by every
+// regular file below it, in alphabetical order within each directory;
+// symbolic links to directories are not followed (so a link cannot
+// make the search loop) but links to files are kept. Any other path,
+// including one that does not exist, is added as it is: counting it
+// reports the error. The function returns 0 on success and -1 (with
+// errno set) if a directory cannot be read.
+int addPath(FileList*, const char*);
+
+// readFileList() adds every path named in a list file ("-" reads
+// stdin), as addPath() does. The paths are separated by NUL characters
+// if the list contains any (as "find -print0" writes them) and by
+// newlines otherwise; empty entries are skipped. The function returns
+// 0 on success and -1 (with errno set) if the list, or a directory it
+// names, cannot be read.
+int readFileList(FileList*, const char*);
+
+// freeFileList() frees the array of paths and the copies.
+void freeFileList(FileList*);
+
+#endif
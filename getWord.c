@@ -2,7 +2,15 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "getWord.h"
+#include "wordScan.h"
 
 /* Reads characters from fd until a single word is assembled */
 /* and returns a copy of the word allocated from the heap.   */
@@ -43,3 +51,201 @@ char* getNextWord(FILE* fd) {
 	wordBuffer[putChar] = '\0';		/* terminate the word          */
 	return strdup(wordBuffer);		/* re-allocate it off the heap */
 }
+
+static int initWordReader(WordReader* reader, int fd, int ownsFd) {
+	struct stat st;
+	void* map;
+
+	memset(reader, 0, offsetof(WordReader, word));
+	reader->fd = fd;
+	reader->ownsFd = ownsFd;
+
+	/* map regular, non-empty files; everything else is read() */
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			reader->data = map;
+			reader->size = st.st_size;
+			reader->bytesRead = st.st_size;
+			reader->mapped = 1;
+			reader->ownsMap = 1;
+			return 0;
+		}
+	}
+
+	reader->buffer = malloc(WORD_READ_BUFFER_SIZE);
+	if (reader->buffer == NULL) return -1;
+	reader->data = reader->buffer;
+	return 0;
+}
+
+int openWordReader(WordReader* reader, const char* path) {
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) return -1;
+	if (initWordReader(reader, fd, 1) < 0) {
+		close(fd);
+		return -1;
+	}
+	return 0;
+}
+
+int openWordReaderFd(WordReader* reader, int fd) {
+	return initWordReader(reader, fd, 0);
+}
+
+void openWordReaderMemory(WordReader* reader, const char* data, size_t size) {
+	memset(reader, 0, offsetof(WordReader, word));
+	reader->fd = -1;
+	reader->data = data;
+	reader->size = size;
+	reader->bytesRead = size;
+	reader->mapped = 1;
+}
+
+void openWordReaderBlocks(WordReader* reader, const char* data, size_t size,
+						  int (*fill)(void*, const char**, size_t*), void* context) {
+	memset(reader, 0, offsetof(WordReader, word));
+	reader->fd = -1;
+	reader->data = data;
+	reader->size = size;
+	reader->bytesRead = size;
+	reader->fill = fill;
+	reader->fillContext = context;
+}
+
+/* Replaces the contents of the read() buffer (or the block) */
+/* with the next block of input.  Returns 0 once the input   */
+/* is exhausted, or WORD_TIMEOUT if mayWait is 0 and         */
+/* reader->timeout ms pass without any input arriving.       */
+
+static int fillWordReader(WordReader* reader, int mayWait) {
+	struct pollfd waitFor;
+	ssize_t got;
+
+	if (reader->mapped || reader->eof) return 0;
+	if (reader->fill != NULL) {
+		if (!reader->fill(reader->fillContext, &reader->data, &reader->size)) {
+			reader->eof = 1;
+			reader->size = reader->pos = 0;
+			return 0;
+		}
+		reader->bytesRead += reader->size;
+		reader->pos = 0;
+		return 1;
+	}
+	if (reader->timeout > 0 && !mayWait) {
+		waitFor.fd = reader->fd;
+		waitFor.events = POLLIN;
+		if (poll(&waitFor, 1, reader->timeout) == 0) return WORD_TIMEOUT;
+	}
+	do {
+		got = read(reader->fd, reader->buffer, WORD_READ_BUFFER_SIZE);
+	} while (got < 0 && errno == EINTR);
+	if (got <= 0) {				/* treat read errors like EOF  */
+		reader->eof = 1;		/* as fgetc() does             */
+		reader->size = reader->pos = 0;
+		return 0;
+	}
+	reader->size = got;
+	reader->bytesRead += got;
+	reader->pos = 0;
+	return 1;
+}
+
+int getNextWordSlice(WordReader* reader, const char** word) {
+	const WordScanner* scan = wordScanner();
+	const char* data;
+	size_t start, p, end, limit, n;
+	int length, filled;
+
+	/* skip to an alphabetic character (or the end of input) */
+	for (;;) {
+		p = scan->skipToAlpha(reader->data, reader->pos, reader->size);
+		reader->pos = p;
+		if (p < reader->size) break;
+		filled = fillWordReader(reader, 0);
+		if (filled <= 0) return filled;
+	}
+
+	/* fast path: the word is already lowercase alphanumerics */
+	/* and ends inside the current block, so hand out a slice */
+	data = reader->data;
+	start = p;
+	if (IS_CLASS(data[p], CH_CLEAN)) {
+		limit = reader->size - start > DICT_MAX_WORD_LEN - 1 ?
+			start + DICT_MAX_WORD_LEN - 1 : reader->size;
+		p = scan->skipClean(data, start + 1, limit);
+		length = p - start;
+		if (p < reader->size) {
+			if (length >= DICT_MAX_WORD_LEN - 1 || IS_CLASS(data[p], CH_SPACE)) {
+				reader->pos = p + 1;	/* terminator is consumed */
+				*word = data + start;
+				return length;
+			}
+		} else if (reader->mapped) {
+			reader->pos = p;			/* the word ends at EOF   */
+			*word = data + start;
+			return length;
+		}
+		memcpy(reader->word, data + start, length);
+	} else {
+		reader->word[0] = TO_LOWER(data[p]);
+		length = 1;
+		p++;
+	}
+
+	/* slow path: the word needs normalizing or runs past the */
+	/* end of the read() buffer; copy it into reader->word    */
+	/* exactly as getNextWord() assembles its wordBuffer: a   */
+	/* whitespace byte ends the word, and once the buffer is  */
+	/* full the next byte (whatever it is) is consumed too    */
+	reader->pos = p;
+	end = p;					/* end of the non-space run    */
+	for (;;) {
+		if (reader->pos == reader->size) {
+			if (!fillWordReader(reader, 1)) break;
+			end = 0;
+		}
+		if (length >= DICT_MAX_WORD_LEN - 1) {
+			reader->pos++;
+			break;
+		}
+		if (end <= reader->pos)
+			end = scan->findSpace(reader->data, reader->pos, reader->size);
+		if (end == reader->pos) {
+			reader->pos++;		/* whitespace ends the word    */
+			break;
+		}
+		n = end - reader->pos;
+		if (n > (size_t) (DICT_MAX_WORD_LEN - 1 - length))
+			n = DICT_MAX_WORD_LEN - 1 - length;
+		length += scan->normalize(reader->word + length, reader->data + reader->pos, n);
+		reader->pos += n;
+	}
+	*word = reader->word;
+	return length;
+}
+
+int normalizeWord(const char* text, char* word) {
+	WordReader reader;
+	const char* slice;
+	int length;
+
+	openWordReaderMemory(&reader, text, strlen(text));
+	length = getNextWordSlice(&reader, &slice);
+	if (length > 0) memcpy(word, slice, length);
+	word[length] = '\0';
+	closeWordReader(&reader);
+	return length;
+}
+
+void closeWordReader(WordReader* reader) {
+	if (reader->ownsMap)
+		munmap((void*) reader->data, reader->size);
+	free(reader->buffer);
+	if (reader->ownsFd) close(reader->fd);
+	reader->data = reader->buffer = NULL;
+	reader->size = reader->pos = 0;
+}
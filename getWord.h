@@ -2,9 +2,14 @@
 #define GETWORD_H
 
 #include <stdio.h>
+#include <stddef.h>
 
 #define DICT_MAX_WORD_LEN	256		/* maximum length of a word (+1) */
 
+#ifndef WORD_READ_BUFFER_SIZE
+#define WORD_READ_BUFFER_SIZE	(1 << 20)	/* read() size when not mapped   */
+#endif
+
 /* Reads characters from fd until a single word is assembled */
 /* and returns a copy of the word allocated from the heap.   */
 /* NULL is returned at EOF.                                  */
@@ -15,4 +20,83 @@
 
 char* getNextWord(FILE* fd);
 
+/* A WordReader yields the same words as getNextWord() but   */
+/* without copying them off the heap.  Regular files are     */
+/* memory-mapped; pipes, terminals and anything else that    */
+/* cannot be mapped are read in large blocks with read().    */
+
+typedef struct _wordReader {
+	int fd;							/* input file descriptor         */
+	int ownsFd;						/* close fd in closeWordReader() */
+	int mapped;						/* data holds the whole input    */
+	int ownsMap;					/* munmap() data when closed     */
+	int eof;						/* read() has returned 0         */
+	int timeout;					/* ms to wait between words, 0   */
+									/* waits for input indefinitely  */
+	const char* data;				/* mapped file or read buffer    */
+	size_t size;					/* valid bytes in data           */
+	size_t pos;						/* next byte to examine          */
+	long long bytesRead;			/* input bytes seen so far       */
+	char* buffer;					/* read() buffer (if not mapped) */
+	int (*fill)(void*, const char**, size_t*);
+									/* block source, NULL if none    */
+	void* fillContext;				/* first argument of fill()      */
+	char word[DICT_MAX_WORD_LEN];	/* normalized copy of a word     */
+} WordReader;
+
+/* Opens the named file for reading words.  Returns 0 on     */
+/* success and -1 (with errno set) if it cannot be opened.   */
+
+int openWordReader(WordReader* reader, const char* path);
+
+/* Reads words from an already open descriptor (e.g. stdin). */
+/* The descriptor is not closed by closeWordReader().        */
+
+int openWordReaderFd(WordReader* reader, int fd);
+
+/* Reads words from size bytes of memory, e.g. one chunk of  */
+/* a file mapped by another reader.  The memory is neither   */
+/* copied nor released by the reader.  The end of the range  */
+/* is treated as EOF.                                        */
+
+void openWordReaderMemory(WordReader* reader, const char* data, size_t size);
+
+/* Reads words from blocks handed out by a fill() function  */
+/* (e.g. the ring of readAhead.h) instead of a descriptor.   */
+/* The first block is given to the reader; whenever it runs  */
+/* out, fill(context, &data, &size) is called, which is done */
+/* with the current block and either points data and size   */
+/* at the next block and returns 1, or returns 0 at EOF.     */
+/* Words may span blocks, as they span read() buffers.       */
+
+void openWordReaderBlocks(WordReader* reader, const char* data, size_t size,
+						  int (*fill)(void*, const char**, size_t*), void* context);
+
+#define WORD_TIMEOUT	(-1)		/* getNextWordSlice(): no input  */
+
+/* Finds the next word and points *word at it, returning its */
+/* length, or 0 at EOF.  If reader->timeout is set and no    */
+/* input arrives for that many milliseconds while the reader */
+/* is between words, WORD_TIMEOUT is returned instead and    */
+/* the next call carries on where this one left off.         */
+/* The word is NOT NUL-terminated.  It points into the       */
+/* mapped file when the word is already in normalized form,  */
+/* and into reader->word when it had to be lowercased or     */
+/* stripped of punctuation.  Either way it is only valid     */
+/* until the next call.                                      */
+
+int getNextWordSlice(WordReader* reader, const char** word);
+
+/* Copies the first word of a NUL-terminated string, exactly */
+/* as getNextWordSlice() would read it (lowercased, without  */
+/* punctuation), NUL-terminated into word, which must hold   */
+/* DICT_MAX_WORD_LEN bytes.  Used to look up query words.    */
+/* Returns the word's length, 0 if the string has no word.   */
+
+int normalizeWord(const char* text, char* word);
+
+/* Unmaps/frees the input and closes the file if we own it.  */
+
+void closeWordReader(WordReader* reader);
+
 #endif
@@ -1,7 +1,10 @@
 #include "hash.h"
-#include "crc64.h"
+#include "stats.h"
+#include "radixSort.h"
+#include "output.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 // ************************************************
 // ************************************************
@@ -10,14 +13,16 @@
 // **
 // ** hash.c represents the functions that control
 // ** the hash table implemented for the wordpairs
-// ** assigment in FALL 2021 - CS360. The hash
-// ** table implemented uses separate chaining and
-// ** grows dynamically by checking a load factor
-// ** specified in hash.h. The data stored in this
-// ** assignment happens to be a char*, but this
-// ** hash table is generalized and can handle
-// ** other types of data as well. The hash function
-// ** used is specified in crc64.h.
+// ** assigment in FALL 2021 - CS360. Words are
+// ** interned into a Dictionary (see dict.h) and
+// ** a pair is stored as the two word ids packed
+// ** into one 64-bit key. The table uses open
+// ** addressing with linear probing, keeps each
+// ** key and its count inline in a 16 byte
+// ** HashNode, and grows dynamically by checking
+// ** a load factor specified in hash.h. Growing
+// ** is spread over the inserts that follow it
+// ** (see insertResizing()).
 // **
 // ** See hash.h for more information on each
 // ** individual function and the data structures
@@ -26,16 +31,22 @@
 // create a new hash table:
 HashTable* createHashTable(int rows) {
   HashTable* hashTable = malloc(sizeof(HashTable));
-  hashTable->table = malloc(sizeof(HashNode*) * rows);
-  hashTable->rowCount = rows; // total number of rows (buckets) in hash table
+  int rowCount = 16;
+  while (rowCount < rows && rowCount < HASH_MAX_ROWS) rowCount <<= 1; // rows must be a power of two
+
+  // calloc() leaves every HashNode with a count of 0 (empty)
+  hashTable->table = calloc(rowCount, sizeof(HashNode));
+  hashTable->rowCount = rowCount; // total number of rows in hash table
   hashTable->entryCount = 0; // total number of inserts into the hash table
   hashTable->uniqueCount = 0; // total number of unique data entries in hash table
-                              // (also the total number of individual hash nodes)
-
-  // initialize all rows (buckets) in the hash table to NULL to start
-  for (int i = 0; i < hashTable->rowCount; i++) {
-    hashTable->table[i] = NULL;
-  }
+                              // (also the total number of used hash nodes)
+  hashTable->dict = createDictionary(INITIAL_DICT_SIZE);
+  hashTable->maxRows = 0; // may grow without limit
+  hashTable->overflow = NULL;
+  hashTable->overflowContext = NULL;
+  hashTable->oldTable = NULL; // not resizing
+  hashTable->oldRowCount = 0;
+  hashTable->moved = 0;
 
   return hashTable;
 }
@@ -43,90 +54,299 @@ HashTable* createHashTable(int rows) {
 // initialize a new HashTable:
 HashTable* initHashTable(void) {
   // wrapper for the creation of a hash table
-  // NOTE: createHashTable() was initially meant to be called
-  //       each time the hash table grew, so this wrapper was
-  //       only to be used during the initial creation of the
-  //       hash table. This is no longer the case.
   HashTable* initialHashTable = createHashTable(INITIAL_HASH_SIZE);
   return initialHashTable;
 }
 
-// insert a new HashNode into the HashTable
-void insert(HashTable* hashTable, void* dataEntry) {
-  // hash the data entry
-  unsigned long long hashValue = crc64(dataEntry); // get hash value
-  int index = hashValue % hashTable->rowCount; // get index
-  
-  // crawl through linked list at row (bucket)
-  HashNode* previousNode;
-  HashNode* currentNode = hashTable->table[index];
-  if (currentNode == NULL) {
-    // empty list, create new hash node
-    hashTable->table[index] = newHashNode(dataEntry, hashValue);
-    hashTable->uniqueCount++; // increase the number of unique HashNodes in table
-  } else {
-    // start the crawl through the linked list
-    while (currentNode != NULL) {
-      // check if currentNode value equals hashValue
-      if (currentNode->value == hashValue) {
-        // a copy of the inserted data is already present in the
-        // HashTable, so free the data currently in the hash table
-        // and replace it to avoid a memory leak.
-        free(currentNode->data);
-        currentNode->data = dataEntry;
-        currentNode->count++; // increase this nodes count
-        hashTable->entryCount++; // increase total number of insertions
-        return; // insertion is complete. number of total nodes hasn't
-                // increased so no need to expand the HashTable
-      } else {
-        // continue crawling through the linked list
-        previousNode = currentNode;
-        currentNode = currentNode->next;
-      }
+// create a HashTable that holds a number of unique pairs without resizing:
+HashTable* sizedHashTable(int uniqueCount) {
+  return createHashTable((int) (uniqueCount / LOAD_FACTOR) + 1);
+}
+
+// mix a pair key (final step of MurmurHash3's 64-bit hash)
+unsigned long long hashKey(unsigned long long key) {
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  key *= 0xC4CEB9FE1A85EC53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+// undo hashKey(): each xor-shift by 33 of 64 bits is its own inverse,
+// and each multiply is undone by the constant's inverse modulo 2^64
+unsigned long long unhashKey(unsigned long long hash) {
+  hash ^= hash >> 33;
+  hash *= 0x9CB4B2F8129337DBULL; // inverse of 0xC4CEB9FE1A85EC53
+  hash ^= hash >> 33;
+  hash *= 0x4F74430C22A54005ULL; // inverse of 0xFF51AFD7ED558CCD
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// count one occurance of a pair key in the HashTable
+int insert(HashTable* hashTable, unsigned long long key) {
+  return insertCount(hashTable, key, 1);
+}
+
+// move up to rows rows of the old array of a resizing HashTable into
+// its new rows, freeing the old array once all of them are moved. The
+// old rows themselves are left as they are (and stay searchable) until
+// then: only rows from moved on are still counted in the old array.
+static void moveRows(HashTable* hashTable, int rows) {
+  int end = hashTable->oldRowCount - hashTable->moved > rows
+            ? hashTable->moved + rows : hashTable->oldRowCount;
+
+  for (int i = hashTable->moved; i < end; i++) {
+    if (hashTable->oldTable[i].count > 0) { // skip empty rows and tombstones
+      expansionInsert(hashTable->table, hashTable->rowCount, &hashTable->oldTable[i]);
+    }
+  }
+  hashTable->moved = end;
+  if (end == hashTable->oldRowCount) {
+    free(hashTable->oldTable); // every row moved over
+    hashTable->oldTable = NULL;
+  }
+}
+
+// find a key among the rows of a resizing HashTable that have not been
+// moved yet, returning NULL if it is not there
+static HashNode* findOldRow(HashTable* hashTable, unsigned long long key) {
+  unsigned long long mask = hashTable->oldRowCount - 1;
+  unsigned long long index = HOME_ROW(hashKey(key), hashTable->oldRowCount);
+  HashNode* table = hashTable->oldTable;
+
+  // rows that were moved are still in place (so that probes get past
+  // them) but no longer count: their key is in the new rows, or was
+  // deleted from there
+  while (table[index].count != 0) {
+    if (table[index].key == key && table[index].count > 0) {
+      return index >= (unsigned long long) hashTable->moved ? &table[index] : NULL;
     }
-    // HashNode not in linked list, create a new one following the
-    // previous node in the list
-    previousNode->next = newHashNode(dataEntry, hashValue);
-    hashTable->uniqueCount++;
+    index = (index + 1) & mask;
   }
+  return NULL;
+}
 
-  hashTable->entryCount++; // increase entryCount
+// start growing a HashTable: allocate the doubled rows and keep the
+// current ones as the old array that inserts move rows out of
+static void startResize(HashTable* hashTable) {
+  StatTimer timer = startTimer(PHASE_EXPAND);
+  hashTable->oldTable = hashTable->table;
+  hashTable->oldRowCount = hashTable->rowCount;
+  hashTable->moved = 0;
+  hashTable->rowCount *= 2;
+  hashTable->table = calloc(hashTable->rowCount, sizeof(HashNode));
+  addStat(&runStats.rowsMoved, hashTable->uniqueCount);
+  stopTimer(timer);
+}
 
-  // check if load factor exceeded and expand table if needed
-  if (calcLoadFactor(hashTable) > LOAD_FACTOR) {
-    expand(hashTable);
+// grow a HashTable whose load factor has been exceeded (or, at its size
+// limit, let the overflow function make room)
+static void growTable(HashTable* hashTable) {
+  finishResize(hashTable); // a no-op unless RESIZE_ROWS is too small
+  if (hashTable->maxRows != 0 && hashTable->rowCount > hashTable->maxRows / 2) {
+    hashTable->overflow(hashTable);
+  } else if (hashTable->rowCount < HASH_MAX_ROWS) {
+    startResize(hashTable);
+  } else if (hashTable->uniqueCount >= HASH_MAX_UNIQUE) {
+    tableFull(); // cannot double again, and nearly every row is used
   }
 }
 
-// create new HashNode function
-HashNode* newHashNode(void* dataEntry, unsigned long long hashValue) {
-  HashNode* new = malloc(sizeof(HashNode));
-  new->data = dataEntry; // data pointed to by this node
-  new->count = 1; // initial count of data
-  new->value = hashValue; // hash value determined by crc_64() call
-  new->next = NULL;
-  return new;
+// insertHashed() for a HashTable that is resizing: move the next rows
+// over, then look the key up in the new rows and the old rows not yet
+// moved, in that order
+static int insertResizing(HashTable* hashTable, unsigned long long key, unsigned long long hash, int count) {
+  moveRows(hashTable, RESIZE_ROWS);
+
+  unsigned long long mask = hashTable->rowCount - 1;
+  unsigned long long index = HOME_ROW(hash, hashTable->rowCount);
+  HashNode* table = hashTable->table;
+  HashNode* old;
+
+  hashTable->entryCount += count;
+  while (table[index].count != 0) {
+    if (table[index].key == key) return table[index].count += count;
+    index = (index + 1) & mask;
+  }
+  if (hashTable->oldTable != NULL && (old = findOldRow(hashTable, key)) != NULL) {
+    return old->count += count; // moved over with its count later
+  }
+
+  // key in neither, claim the empty row of the new rows
+  table[index].key = key;
+  table[index].count = count;
+  hashTable->uniqueCount++;
+  if (calcLoadFactor(hashTable) > LOAD_FACTOR) growTable(hashTable);
+  return count;
 }
 
-// insertion of a HashNode that has already been created into
-// a new hash table (used during expand() call)
-void expansionInsert(HashNode** table, int rowCount ,HashNode* hashNode) {
-  int index = hashNode->value % rowCount; // row (bucket) to insert into
-  HashNode* currentNode = table[index]; // node at head of row (bucket)
-  if (currentNode == NULL) {
-    // empty row (bucket), so point to inserted HashNode
-    table[index] = hashNode;
-  } else {
-    // move to the end of the linked list
-    while (currentNode->next != NULL) {
-      currentNode = currentNode->next;
+// add count occurances of a pair key whose hashKey() is already known
+static inline int insertHashed(HashTable* hashTable, unsigned long long key, unsigned long long hash, int count) {
+  if (hashTable->oldTable != NULL) return insertResizing(hashTable, key, hash, count);
+
+  unsigned long long mask = hashTable->rowCount - 1;
+  unsigned long long index = HOME_ROW(hash, hashTable->rowCount); // get index
+  HashNode* table = hashTable->table;
+
+  hashTable->entryCount += count; // increase entryCount
+
+  // probe rows until we find the key or an empty row
+  while (table[index].count != 0) {
+    if (table[index].key == key) {
+      table[index].count += count; // pair already present, increase its count
+      return table[index].count; // number of used nodes hasn't increased
+                                 // so no need to expand the HashTable
+    }
+    index = (index + 1) & mask;
+  }
+
+  // key not in table, claim the empty row
+  table[index].key = key;
+  table[index].count = count;
+  hashTable->uniqueCount++;
+
+  // check if load factor exceeded and grow table if needed
+  if (calcLoadFactor(hashTable) > LOAD_FACTOR) growTable(hashTable);
+  return count;
+}
+
+// add count occurances of a pair key to the HashTable
+int insertCount(HashTable* hashTable, unsigned long long key, int count) {
+  return insertHashed(hashTable, key, hashKey(key), count);
+}
+
+// count one occurance of each of a number of pair keys
+void insertBatch(HashTable* hashTable, const unsigned long long* keys, int keyCount) {
+  unsigned long long hashes[INSERT_BATCH];
+
+  for (int first = 0; first < keyCount; first += INSERT_BATCH) {
+    int batch = keyCount - first < INSERT_BATCH ? keyCount - first : INSERT_BATCH;
+
+    // hash the whole batch and start loading every row it will probe
+    for (int i = 0; i < batch; i++) {
+      hashes[i] = hashKey(keys[first + i]);
+      __builtin_prefetch(&hashTable->table[HOME_ROW(hashes[i], hashTable->rowCount)], 1);
+    }
+
+    // by now most of the rows are in cache (if the table grows in the
+    // middle of the batch the rest is simply looked up without help)
+    for (int i = 0; i < batch; i++) {
+      insertHashed(hashTable, keys[first + i], hashes[i], 1);
+    }
+  }
+}
+
+// look up the count of a pair key:
+int findCount(HashTable* hashTable, unsigned long long key) {
+  unsigned long long mask = hashTable->rowCount - 1;
+  unsigned long long index = HOME_ROW(hashKey(key), hashTable->rowCount);
+  HashNode* table = hashTable->table;
+  HashNode* old;
+
+  while (table[index].count != 0) {
+    if (table[index].key == key) return table[index].count;
+    index = (index + 1) & mask;
+  }
+  if (hashTable->oldTable != NULL && (old = findOldRow(hashTable, key)) != NULL) return old->count;
+  return 0;
+}
+
+// remove count occurances of a pair key from the HashTable
+int subtractCount(HashTable* hashTable, unsigned long long key, int count) {
+  unsigned long long mask = hashTable->rowCount - 1;
+  unsigned long long index = HOME_ROW(hashKey(key), hashTable->rowCount);
+  HashNode* table = hashTable->table;
+  HashNode* old;
+
+  // a pair that has not been moved yet is only counted down: rows of
+  // the old array are never shifted, so an emptied one becomes a
+  // tombstone that probes go past
+  if (hashTable->oldTable != NULL && (old = findOldRow(hashTable, key)) != NULL) {
+    if (count > old->count) count = old->count;
+    hashTable->entryCount -= count;
+    old->count -= count;
+    if (old->count != 0) return old->count;
+    old->count = -1;
+    hashTable->uniqueCount--;
+    return 0;
+  }
+
+  // find the key (it may already be gone)
+  while (table[index].key != key || table[index].count == 0) {
+    if (table[index].count == 0) return 0;
+    index = (index + 1) & mask;
+  }
+
+  if (count > table[index].count) count = table[index].count;
+  hashTable->entryCount -= count;
+  table[index].count -= count;
+  if (table[index].count != 0) return table[index].count;
+
+  // the row is now empty; pull back any later key in the same probe
+  // run whose home row is not between the hole and its current row,
+  // so that no probe sequence is broken by the hole
+  unsigned long long hole = index;
+  for (;;) {
+    index = (index + 1) & mask;
+    if (table[index].count == 0) break;
+    unsigned long long home = HOME_ROW(hashKey(table[index].key), hashTable->rowCount);
+    if (((index - home) & mask) >= ((index - hole) & mask)) {
+      table[hole] = table[index];
+      table[index].count = 0;
+      hole = index;
+    }
+  }
+  hashTable->uniqueCount--;
+  return 0;
+}
+
+// add every pair counted in one HashTable to another:
+void mergeHashTable(HashTable* into, HashTable* from) {
+  Dictionary* fromDict = from->dict;
+  unsigned int* remap = malloc(sizeof(unsigned int) * (fromDict->wordCount ? fromDict->wordCount : 1));
+
+  // translate every word id of "from" into an id of "into"
+  for (int i = 0; i < fromDict->wordCount; i++) {
+    remap[i] = internWord(into->dict, fromDict->words[i], fromDict->lengths[i]);
+  }
+
+  // re-key and add every used HashNode
+  finishResize(from);
+  for (int i = 0; i < from->rowCount; i++) {
+    HashNode* node = &from->table[i];
+    if (node->count != 0) {
+      insertCount(into, PAIR_KEY(remap[PAIR_FIRST(node->key)],
+                                 remap[PAIR_SECOND(node->key)]), node->count);
     }
-    currentNode->next = hashNode; // add the HashNode at the end of the linked list
   }
+  free(remap);
+}
+
+// insertion of a HashNode that has already been counted into
+// a new table array (used during expand() call)
+void expansionInsert(HashNode* table, int rowCount, HashNode* hashNode) {
+  unsigned long long mask = rowCount - 1;
+  unsigned long long index = HOME_ROW(hashKey(hashNode->key), rowCount);
+
+  // keys are unique, so just find the first empty row
+  while (table[index].count != 0) {
+    index = (index + 1) & mask;
+  }
+  table[index] = *hashNode;
+}
+
+// give up on a table that cannot hold any more pairs:
+void tableFull(void) {
+  fprintf(stderr, "Unable to keep more than %d unique pairs or n-grams in memory (--mem spills pairs to disk)...\n",
+          HASH_MAX_UNIQUE);
+  exit(1);
+}
 
-  // HashNode is in a new position compared to where it was before
-  // It is now a tail node in this linked list so make sure ->next is NULL
-  hashNode->next = NULL;
+// move every remaining row of a resizing HashTable:
+void finishResize(HashTable* hashTable) {
+  if (hashTable->oldTable != NULL) moveRows(hashTable, hashTable->oldRowCount);
 }
 
 // calculate load factor of HashTable
@@ -134,139 +354,202 @@ double calcLoadFactor(HashTable* hashTable) {
   return (double) hashTable->uniqueCount / hashTable->rowCount;
 }
 
-// destroy hashTable (free HashTable and associated HashNodes from memory)
-// NOTE: For this assignment, destroy() also frees the data that has been
-//       inserted into the HashTable.
+// destroy hashTable (free HashTable, its rows and its Dictionary)
 void destroy(HashTable* hashTable) {
-  int i; // iterator to move through rows (buckets) of HashTable
-
-  // variables to crawl through HashNode linked lists:
-  HashNode* previousNode;
-  HashNode* currentNode;
-
-  // loop through hashTable rows
-  for (i = 0; i < hashTable->rowCount; i++) {
-    if (hashTable->table[i] != NULL) {
-      // crawl through linked list, free nodes as we go
-      previousNode = hashTable->table[i];
-      currentNode = previousNode->next;
-      while (currentNode != NULL) {
-        free(previousNode->data); // free the data pointed to by the node
-        free(previousNode); // free the pointer to the node
-        previousNode = currentNode; // move to next node
-        currentNode = currentNode->next;
-      }
-      free(previousNode->data); // free data pointed to by final node in linked list
-      free(previousNode); // free the pointer to the final node in linked list
-    }
-  }
-  // free the pointer to the HashNode row (bucket) array
+  free(hashTable->oldTable);
   free(hashTable->table);
-  // free the pointer to the hashTable
+  destroyDictionary(hashTable->dict);
   free(hashTable);
 }
 
-// expand hashTable function (used when load factor exceeded)
+// expand hashTable function (used to make room ahead of inserts)
 void expand(HashTable* hashTable) {
-  int i; // iterator
+  finishResize(hashTable);
+  if (hashTable->rowCount >= HASH_MAX_ROWS) return;
+  startResize(hashTable);
+  finishResize(hashTable); // move every used HashNode over right away
+}
+
+// # of threads arrayDump() may sort on (see setSortThreads())
+static int sortThreads = 1;
 
-  // create new table (array of HashNode rows/buckets)
-  int newRowCount = hashTable->rowCount * 3; // number of new rows/buckets
-  HashNode** newTable = malloc(sizeof(HashNode*) * newRowCount);
+// set the # of threads arrayDump() may sort on:
+void setSortThreads(int threads) {
+  sortThreads = threads > 0 ? threads : 1;
+}
 
-  for (i = 0; i < newRowCount; i++) {
-    newTable[i] = NULL; // nullify the head HashNodes in each row/bucket
+// # of bits needed to hold every value from 0 to value
+static int bitsFor(unsigned long long value) {
+  int bits = 0;
+  while (value >> bits) bits++;
+  return bits;
+}
+
+// sort rank-keyed HashNodes into compare() order with radixSort(),
+// returning 0 (and leaving them as they are) if their counts and
+// keys do not fit in one 64-bit value together
+static int radixDump(HashNode* nodes, int nodeCount, int wordCount) {
+  int maxCount = 1;
+  for (int i = 0; i < nodeCount; i++) {
+    if (nodes[i].count > maxCount) maxCount = nodes[i].count;
   }
-  
-  // set the HashTable to point to the new table, but
-  // retain the old table to reinsert the existing HashNodes
-  HashNode** previousTable = hashTable->table;
-  hashTable->table = newTable;
-
-  // loop through the old hashTable and move over hashed HashNodes
-  HashNode* previousNode;
-  HashNode* currentNode;
-
-  for (i = 0; i < hashTable->rowCount; i++) {
-    if (previousTable[i] != NULL) {
-      // crawl through linked list at this non-empty row/bucket
-       previousNode = previousTable[i];
-       currentNode = previousNode->next;
-      while (currentNode != NULL) {
-        expansionInsert(newTable, newRowCount, previousNode);
-        previousNode = currentNode;
-        currentNode = currentNode->next;
-      }
-      // insert last node in the linked list at this row/bucket
-      expansionInsert(newTable, newRowCount, previousNode);
-    }
+
+  // sort on maxCount - count (so higher counts come first), then the
+  // first word's rank, then the second's
+  int rankBits = bitsFor(wordCount > 0 ? wordCount - 1 : 0);
+  int bits = bitsFor(maxCount - 1) + 2 * rankBits;
+  if (bits > 64) return 0;
+
+  // the values are packed into the front half of the nodes' own
+  // memory (node i is read before value 2i or 2i + 1 is written) and
+  // the back half is the scratch space
+  unsigned long long* values = (unsigned long long*) nodes;
+  for (int i = 0; i < nodeCount; i++) {
+    unsigned long long rest = (unsigned long long) (maxCount - nodes[i].count) << rankBits << rankBits;
+    values[i] = rest | ((unsigned long long) PAIR_FIRST(nodes[i].key) << rankBits) | PAIR_SECOND(nodes[i].key);
+  }
+  unsigned long long* sorted = radixSort(values, values + nodeCount, nodeCount, bits, sortThreads);
+  if (sorted != values) memcpy(values, sorted, sizeof(unsigned long long) * nodeCount);
+
+  // unpack back to front, so that no value is overwritten before it is read
+  unsigned long long rankMask = (1ULL << rankBits) - 1;
+  for (int i = nodeCount - 1; i >= 0; i--) {
+    unsigned long long value = values[i];
+    nodes[i].key = PAIR_KEY((value >> rankBits) & rankMask, value & rankMask);
+    nodes[i].count = maxCount - (int) (value >> rankBits >> rankBits);
   }
-  free(previousTable); // all nodes moved over, previousTable no longer needed
-  hashTable->rowCount = newRowCount; // correct the row/bucket count in the new HashTable
+  return 1;
 }
 
 // dump out an array of HashNodes sorted in descending
 // order of their frequency:
-HashNode** arrayDump(HashTable* hashTable) {
+HashNode* arrayDump(HashTable* hashTable) {
   int arraySize = hashTable->uniqueCount; // size of dumped HashNode array
-  int rows = hashTable->rowCount; // number of rows/buckets in HashTable
-  HashNode** hashArray = malloc(sizeof(HashNode*) * arraySize); // create hashArray
-
-  // iterator variables:
+  HashNode* hashArray = malloc(sizeof(HashNode) * (arraySize ? arraySize : 1));
+  unsigned int* rank; // alphabetical rank of each word id
   int i = 0; // iterator for HashNodes in hashArray
-  int r; // iterator for rows in hashTable
-  
-  // variables for crawling through linked lists:
-  HashNode* currentNode;
-  HashNode* previousNode;
-
-  // iterator through rows, adding pointers to HashNodes 
-  // to the hashArray as we go...
-  for (r = 0; r < rows; r++) {
-    if (hashTable->table[r] != NULL) {
-      // start crawling through this row's linked list
-      previousNode = hashTable->table[r];
-      currentNode = previousNode->next;
-      while (currentNode != NULL) {
-        hashArray[i++] = previousNode; // add node to hashArray
-
-        // move to next node in linked list
-        previousNode = currentNode;
-        currentNode = currentNode->next;
-      }
 
-      hashArray[i++] = previousNode; // add last node in linked list
+  finishResize(hashTable);
+  sortDictionary(hashTable->dict);
+  rank = hashTable->dict->rank;
+
+  // copy the used rows into the front of hashArray, re-keyed by
+  // word rank so that equal counts sort alphabetically by pair
+  for (int r = 0; r < hashTable->rowCount; r++) {
+    HashNode* node = &hashTable->table[r];
+    if (node->count != 0) {
+      hashArray[i].key = PAIR_KEY(rank[PAIR_FIRST(node->key)], rank[PAIR_SECOND(node->key)]);
+      hashArray[i++].count = node->count;
     }
   }
 
   // sort the dumped array in descending order by count and then return
-  qsort(hashArray, hashTable->uniqueCount, sizeof(HashNode*), compare);
+  // (by radix sort unless the sort keys would not fit in 64 bits)
+  if (!radixDump(hashArray, arraySize, hashTable->dict->wordCount)) {
+    qsort(hashArray, arraySize, sizeof(HashNode), compare);
+  }
   return hashArray;
 }
 
+// move heap[i] down until neither child sorts after it (the root of
+// the heap is the HashNode that sorts last)
+static void siftDown(HashNode* heap, int size, int i) {
+  HashNode node = heap[i];
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= size) break;
+    if (child + 1 < size && compare(&heap[child + 1], &heap[child]) > 0) {
+      child++; // pick the child that sorts last
+    }
+    if (compare(&heap[child], &node) <= 0) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = node;
+}
+
+// dump out the first k HashNodes of arrayDump()'s order
+// without sorting the whole table:
+HashNode* topDump(HashTable* hashTable, int k) {
+  HashNode* heap = malloc(sizeof(HashNode) * (k ? k : 1)); // bounded heap of k nodes
+  unsigned int* rank; // alphabetical rank of each word id
+  int size = 0; // # of HashNodes in the heap
+  HashNode node;
+
+  finishResize(hashTable);
+  sortDictionary(hashTable->dict);
+  rank = hashTable->dict->rank;
+
+  for (int r = 0; r < hashTable->rowCount && k > 0; r++) {
+    if (hashTable->table[r].count == 0) continue;
+
+    // re-key by word rank, as arrayDump() does
+    node.key = PAIR_KEY(rank[PAIR_FIRST(hashTable->table[r].key)],
+                        rank[PAIR_SECOND(hashTable->table[r].key)]);
+    node.count = hashTable->table[r].count;
+
+    if (size < k) {
+      // heap not full yet: add the node and restore the heap once full
+      heap[size++] = node;
+      if (size == k) {
+        for (int i = k / 2 - 1; i >= 0; i--) siftDown(heap, k, i);
+      }
+    } else if (compare(&node, &heap[0]) < 0) {
+      // node sorts before the last of the current top k: replace it
+      heap[0] = node;
+      siftDown(heap, k, 0);
+    }
+  }
+
+  // only k nodes remain, sort them into output order
+  qsort(heap, size, sizeof(HashNode), compare);
+  return heap;
+}
+
 // qsort's compare function to sort HashNodes in descending order
-// by their entry counts:
+// by their entry counts (ties in ascending order of key):
 int compare(const void* n1, const void* n2) {
-  HashNode* node1 = *(HashNode**) n1;
-  HashNode* node2 = *(HashNode**) n2;
+  const HashNode* node1 = n1;
+  const HashNode* node2 = n2;
 
-  return(node2->count - node1->count);
+  if (node1->count != node2->count) {
+    return(node2->count - node1->count);
+  }
+  return (node1->key > node2->key) - (node1->key < node2->key);
 }
 
-// print a specified number of HashNode data entries from a sorted 
-// array of HashNode pointers from a HashTable:
+// print a specified number of word pairs from a sorted
+// array of HashNodes from a HashTable:
 void printSortedHashTable(HashTable* hashTable, int displayCount) {
-  HashNode** array = arrayDump(hashTable); // create sorted HashNode* array
+  HashNode* array; // sorted HashNode array
+  Dictionary* dict = hashTable->dict;
 
   if (displayCount > hashTable->uniqueCount || displayCount == -1) {
     displayCount = hashTable->uniqueCount; // displayCount is either larger than uniqueCount
                                            // or is -1. If so, set the display count to uniqueCount
   }
+  if (displayCount <= 0) return; // nothing to print
+
+  StatTimer timer = startTimer(PHASE_SORT);
+  // only sort every pair when every pair is printed
+  if (displayCount == hashTable->uniqueCount) {
+    array = arrayDump(hashTable);
+  } else {
+    array = topDump(hashTable, displayCount);
+  }
+  unsigned int* order = dict->order; // dumped keys hold word ranks
+  stopTimer(timer);
 
-  // output the wordpairs
+  // output the wordpairs (see output.h)
+  timer = startTimer(PHASE_OUTPUT);
+  Output output;
+  openOutput(&output, 1);
   for (int i = 0; i < displayCount; i++) {
-    printf("%10d %s\n", array[i]->count, (char*) array[i]->data);
+    writePair(&output, dict, array[i].count, order[PAIR_FIRST(array[i].key)],
+              order[PAIR_SECOND(array[i].key)]);
   }
+  closeOutput(&output);
+  stopTimer(timer);
 
   free(array);
 }
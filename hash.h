@@ -1,72 +1,172 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include "dict.h"
+
 #ifndef INITIAL_HASH_SIZE
-#define INITIAL_HASH_SIZE 10
+#define INITIAL_HASH_SIZE 1024
 #endif
 
 #ifndef LOAD_FACTOR
-#define LOAD_FACTOR 0.75
+#define LOAD_FACTOR 0.7
+#endif
+
+// # of keys insertBatch() hashes and prefetches the rows of before
+// inserting them
+#ifndef INSERT_BATCH
+#define INSERT_BATCH 32
+#endif
+
+// # of old rows moved into the grown table by each insert while the
+// table is resizing (must be at least 1 / LOAD_FACTOR so that a resize
+// always finishes before the next one is due)
+#ifndef RESIZE_ROWS
+#define RESIZE_ROWS 256
+#endif
+
+// the most rows a table grows to: rowCount is an int, so 2^30 rows
+// cannot be doubled. A table that has reached it fills up past
+// LOAD_FACTOR (with longer and longer probes) until it holds
+// HASH_MAX_UNIQUE pairs, when the run ends (see tableFull())
+#ifndef HASH_MAX_ROWS
+#define HASH_MAX_ROWS (1 << 30)
 #endif
+#define HASH_MAX_UNIQUE (HASH_MAX_ROWS - HASH_MAX_ROWS / 16)
+
+// packs the ids of the first and second word of a pair into the
+// 64-bit key stored in the HashTable (and unpacks it again)
+#define PAIR_KEY(first, second) (((unsigned long long) (first) << 32) | (second))
+#define PAIR_FIRST(key) ((unsigned int) ((key) >> 32))
+#define PAIR_SECOND(key) ((unsigned int) (key))
+
+// the home row of a key (the row its probe starts at) in a table of
+// rowCount rows, from the key's hashKey(): the top bits of the hash, so
+// that the rows are in hash order and every hash prefix owns a
+// contiguous range of rows in a table of any size (see shardMerge.h)
+#define HOME_ROW(hash, rowCount) ((hash) >> (64 - __builtin_ctz(rowCount)))
 
 typedef struct _hashNode {
-  void* data; // data in node
-  int count; // # of occurances of data in table
-  unsigned long long value; // hash value of data (determined by crc_64())
-  struct _hashNode *next; // next node in linked list
+  unsigned long long key; // packed word ids of the pair (see PAIR_KEY)
+  int count; // # of occurances of the pair in table, 0 marks an empty slot
 } HashNode;
 
 typedef struct _hashTable {
-  HashNode** table;// pointer to table array of HashNode pointers
-  int rowCount;  // # of rows in table
-  int entryCount; // total # of entries in table
-  int uniqueCount; // # of unique entries (# of HashNodes) in table
+  HashNode* table; // open addressing array of HashNodes (stored inline)
+  int rowCount;  // # of rows in table, always a power of two
+  long long entryCount; // total # of entries in table
+  int uniqueCount; // # of unique entries (# of used HashNodes) in table
+  Dictionary* dict; // words the pair keys refer to
+  int maxRows; // expand() never grows table past this many rows (0 = no limit)
+  void (*overflow)(struct _hashTable*); // called instead of expand() at maxRows
+  void* overflowContext; // for the overflow function (see spill.h)
+  HashNode* oldTable; // rows being moved into table by a resize, NULL if none
+  int oldRowCount; // # of rows in oldTable
+  int moved; // rows of oldTable before this one are already in table
 } HashTable;
 
 // ***************************************************************
 // ***************************************************************
 // ** INTERFACE:
 // **  create HashTable: initHashTable(void)
-// **  insert into HashTable: insert(HashTable*, void*)
+// **  create HashTable for N unique pairs: sizedHashTable(int)
+// **  intern a word: internWord(hashTable->dict, const char*, int)
+// **  insert into HashTable: insert(HashTable*, unsigned long long)
+// **  insert many keys at once: insertBatch(HashTable*, const unsigned long long*, int)
 // **  print specified number of data entries in
 // **    descending order of occurances: printSortedHashTable(HashTable*,int)
 // **  free memory stored in HashTable: destroy(HashTable*)
+// **  before reading table[] directly: finishResize(HashTable*)
 // **
 // ** NOTE: The other functions described in this file should not
 // **       be implemented by the user directly.
 
 
 // createHashTable() creates a HashTable structure with an entryCount
-// of 0, uniqueCount of 0, and a rowCount specified by the integer
-// passed in as an argument. The rowCount also specifies the length of the
-// HashNode array created. All HashNodes in the array are set to NULL.
-// The function returns a pointer to the HashTable created.
+// of 0, uniqueCount of 0, an empty Dictionary, no row limit, and a rowCount of at
+// least the integer passed in as an argument (rounded up to a power of
+// two so that a row can be picked from the top bits of a hash). All HashNodes in the
+// array start out empty (count of 0). The function returns a pointer
+// to the HashTable created.
 HashTable* createHashTable(int);
 
 // initHashTable(void) is a wrapper that will call the createHashTable()
 // function with the defined argument INITIAL_HASH_SIZE specified above.
 // The function returns a pointer to the HashTable initialized.
-// NOTE: createHashTable was initially meant to be called every time the
-//       HashTable grew/expanded, so this wrapper was only to be used
-//       upon the initial creation of the HashTable. That is no longer
-//       the case, but this function is still used to initialize a 
-//       HashTable. 
 HashTable* initHashTable(void);
 
-// insert() is a function that takes a pointer to some data and
-// inserts it into a HashTable. The first argument is a pointer
-// to the HashTable to insert the data into. The second argument
-// is a pointer to the data to be inserted. The data is hashed
-// using the crc_64() function. If a node containing the hashed
-// value is already present in the HashTable, the data pointed
-// to by that node is freed and replaced by the pointer to the new
-// data passed as an argument to this function.
-void insert(HashTable*, void*);
-
-// newHashNode() creates a new HashNode structure with a count of
-// 1 and a next field of NULL. The first argument is a pointer to
-// the data that this node will point to, and the second argument
-// is the unsigned long long hash value determined by the hashing
-// function crc_64(). The function returns a pointer to the new
-// HashNode.
-HashNode* newHashNode(void*, unsigned long long);
+// sizedHashTable() creates a HashTable with enough rows for the given
+// number of unique pairs to be inserted without the table ever having
+// to resize (see --expect-unique). The function returns a pointer to the
+// HashTable created.
+HashTable* sizedHashTable(int);
+
+// insert() is a function that counts one occurance of a word pair.
+// The first argument is a pointer to the HashTable to insert into.
+// The second argument is the pair's key built with PAIR_KEY() from
+// two ids handed out by internWord(). The key is mixed by hashKey()
+// to pick a row and the table is probed linearly from there. If the
+// key is already present its count is increased, otherwise the first
+// empty HashNode found takes the key with a count of 1. Nothing is
+// allocated except when the table has to grow. Growing is incremental:
+// the doubled rows are allocated and every insert after that moves the
+// next RESIZE_ROWS rows of the old array over, so no single insert pays
+// for rehashing the whole table. Until all of them are moved, a key that
+// is not in the new rows is looked up in the old ones as well. If the
+// table would have to grow past maxRows, its overflow function is called
+// instead (it must leave the table with room, e.g. by emptying it). The
+// function returns the pair's count after the insertion.
+int insert(HashTable*, unsigned long long);
+
+// insertCount() works like insert() but adds count occurances of the
+// pair at once. It is used when combining tables that were counted
+// separately.
+int insertCount(HashTable*, unsigned long long, int);
+
+// insertBatch() counts one occurance of each of the given number of
+// keys, with the same result as calling insert() on each in turn. Keys
+// are taken INSERT_BATCH at a time: all of them are hashed and a
+// prefetch of each one's home row is issued before the first is
+// inserted, so that on a table too large for the cache the memory
+// accesses of the whole batch overlap instead of each insert waiting
+// for its own cache miss.
+void insertBatch(HashTable*, const unsigned long long*, int);
+
+// findCount() returns the count of a pair key, or 0 if it has not been
+// counted. It does not change the HashTable, so any number of threads
+// may look pairs up at once while nothing is inserted.
+int findCount(HashTable*, unsigned long long);
+
+// subtractCount() takes count occurances of a pair back out of the
+// HashTable (never more than it holds) and returns what is left. A pair
+// whose count drops to 0 is deleted: later keys of the same probe run
+// are shifted back into the hole (backward-shift deletion), so the
+// table never needs tombstones. (Only the old rows of a table that is
+// resizing get them: a pair deleted there is marked with a count of -1
+// until its rows are freed, since they are never shifted.)
+int subtractCount(HashTable*, unsigned long long, int);
+
+// mergeHashTable() adds every pair counted in the second HashTable to
+// the first one. The two tables have their own Dictionaries, so each
+// word of the second table is interned into the first table's
+// Dictionary and the pair keys are translated before being inserted.
+// The second HashTable is left unchanged.
+void mergeHashTable(HashTable*, HashTable*);
+
+// hashKey() mixes the bits of a packed pair key so that consecutive
+// ids spread over the whole table. The home row of a key is
+// HOME_ROW(hashKey(key), rowCount). The mix is a bijection, undone by
+// unhashKey(), so a hash stands for its key.
+unsigned long long hashKey(unsigned long long);
+
+// unhashKey() returns the key that hashKey() mixed into the given hash.
+unsigned long long unhashKey(unsigned long long);
+
+// finishResize() moves every row the table has not moved yet out of the
+// old array of a resizing HashTable and frees it, so that all pairs are
+// in table[] again. Anything that reads table[] directly (rather than
+// through insert() and subtractCount()) must call it first. It does
+// nothing if the table is not resizing.
+void finishResize(HashTable*);
 
 // calcLoadFactor is a function that determines the load factor
 // of a HashTable using that table's uniqueCount / rowCount. The
@@ -75,47 +175,77 @@ HashNode* newHashNode(void*, unsigned long long);
 // load factor for the HashTable.
 double calcLoadFactor(HashTable*);
 
-// destroy() is a function that frees the memory/data present in a 
-// HashTable as well as the HashTable itself. The only argument to
-// this function is a pointer to the HashTable to be freed from 
-// memory.
-// NOTE: For this assignment, destroy() will free all of the data
-//       pointed to by the HashNodes within the HashTable.
+// destroy() is a function that frees the memory/data present in a
+// HashTable (including its Dictionary) as well as the HashTable
+// itself. The only argument to this function is a pointer to the
+// HashTable to be freed from memory.
 void destroy(HashTable*);
 
 // expansionInsert() is a function that takes an existing HashNode
-// pointer and inserts it into an array of HashNode pointers. This
-// function is called when growing/expanding a HashTable. The first
-// argument is a pointer to the first HashNode pointer in an array
-// of HashNodes, the second argument is the rowCount/number of buckets
-// in the array, and the third argument is a pointer to the HashNode
-// to be inserted.
-void expansionInsert(HashNode**, int, HashNode*);
-
-// expand() is a function that grows the number of rows/buckets in an
-// existing HashTable. The only argument to the function is a pointer
-// to the HashTable to be expanded. The number of rows/buckets in the
-// HashTable is multiplied by 3 each time the table is expanded.
+// and places it into an array of HashNodes. This function is called
+// when growing/expanding a HashTable. The first argument is a pointer
+// to the first HashNode in an array of HashNodes, the second argument
+// is the rowCount/number of rows in the array (a power of two), and
+// the third argument is a pointer to the HashNode to be copied in.
+void expansionInsert(HashNode*, int, HashNode*);
+
+// expand() is a function that grows the number of rows in an existing
+// HashTable at once, moving every row before it returns (insert() grows
+// the table incrementally instead). It is meant for making room ahead of
+// a known number of inserts. The only argument to the function is a
+// pointer to the HashTable to be expanded. The number of rows in the
+// HashTable is doubled each time the table is expanded, up to
+// HASH_MAX_ROWS; a table that large is left as it is.
 void expand(HashTable*);
 
-// arrayDump() is a function that returns an array of all of the
-// HashNode pointers present in a HashTable, sorted in descending order
-// based on the HashNode's "count" variable. The function takes a pointer
-// to the HashTable to dump as the sole argument. qsort() is the function
-// used to sort the HashNode pointers in the pointer array.
+// tableFull() is called when more than HASH_MAX_UNIQUE distinct pairs
+// (or n-grams) are to be kept in memory. It writes an error to stderr,
+// suggesting --mem, and ends the run with an exit status of 1.
+void tableFull(void);
+
+// arrayDump() is a function that returns an array holding a copy of
+// every used HashNode in a HashTable, sorted in descending order based
+// on the HashNode's "count" variable. The function takes a pointer
+// to the HashTable to dump as the sole argument. Each HashNode is packed
+// into one 64-bit sort key (the count, then the two word ranks) and the
+// keys are sorted by radixSort() (see radixSort.h), on as many threads as
+// setSortThreads() allows; only if a key would need more than 64 bits is
+// the array sorted with qsort() and compare() instead. So that the
+// order of pairs with equal counts does not depend on how the table was
+// built, the copied keys are made of alphabetical word ranks (see
+// sortDictionary()) instead of word ids; dict->order[] maps a rank back
+// to its id.
+// NOTE: The array that is created will need to be freed by free() after it's
+//       creation.
+HashNode* arrayDump(HashTable*);
+
+// topDump() is a function that returns the same HashNodes as the first
+// k entries of arrayDump(), in the same order, but without sorting the
+// whole table. The first argument is the HashTable to dump and the second
+// argument is k, which must not be larger than the table's uniqueCount.
+// A heap of the k HashNodes that sort first so far is kept while the rows
+// are scanned, so the work is O(n log k) and only k HashNodes are copied.
 // NOTE: The array that is created will need to be freed by free() after it's
 //       creation.
-HashNode** arrayDump(HashTable*);
+HashNode* topDump(HashTable*, int);
 
-// compare() is the function that qsort() uses when comparing HashNode pointers
+// setSortThreads() sets the number of threads arrayDump() may use to
+// sort a large table (1 by default; main() passes -j on).
+void setSortThreads(int);
+
+// compare() is the function that qsort() uses when comparing HashNodes
 // in the arrayDump() function described above. The function results in qsort()
-// sorting the HashNode pointers in descending order based on their "count" variable.
+// sorting the HashNodes in descending order based on their "count" variable,
+// and pairs with the same count in ascending order of their key.
 int compare(const void*, const void*);
 
-// printSortedHashTable() is a function specific for the wordpair program, which
-// assumes that the data stored in the HashTable are strings. A sorted HashNode 
-// pointer array is created by arrayDump(), and a specified number of HashNode
-// data entries are printed to stdout. The first argument to the function is a pointer
-// to the HashTable to print the data from, the second argument to the function
-// is an integer that specifies the number of HashNode data entries to print.
+// printSortedHashTable() is a function specific for the wordpair program.
+// A sorted HashNode array is created by arrayDump() when every pair is
+// printed, or by topDump() when fewer are asked for, and a specified number
+// of word pairs are printed to stdout as "count word1 word2". The first
+// argument to the function is a pointer to the HashTable to print the
+// data from, the second argument to the function is an integer that
+// specifies the number of word pairs to print (-1 prints all of them).
 void printSortedHashTable(HashTable*, int);
+
+#endif
@@ -0,0 +1,455 @@
+#include "ingest.h"
+#include "stats.h"
+#include "workQueue.h"
+#include "shardMerge.h"
+#include <stdlib.h>
+#include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+
+// ************************************************
+// ************************************************
+// ** ingest.c turns the words of a file into pair
+// ** counts, either directly on the calling thread
+// ** or by splitting a mapped file into chunks that
+// ** are counted on several threads and merged, or
+// ** from blocks that a ReadAhead reads ahead,
+// ** or by handing many files (and the parts of
+// ** large ones) to worker threads that steal
+// ** work from each other.
+// **
+// ** See ingest.h for more information on each
+// ** individual function.
+
+// one chunk of a file and the results of counting it
+typedef struct _chunk {
+  HashTable* hashTable; // thread-local table the chunk is counted into
+  const char* data; // first byte of the chunk
+  size_t size; // # of bytes in the chunk
+  long long wordCount; // # of words found in the chunk
+  unsigned int firstWord; // id of the first word (in hashTable's dict)
+  unsigned int lastWord; // id of the last word (in hashTable's dict)
+} Chunk;
+
+// where the WordReader of a file being read ahead gets its blocks
+typedef struct _blockSource {
+  ReadAhead* ahead;
+  ReadBlock* block; // the block being tokenized
+} BlockSource;
+
+// a task of the workers of countFiles() is a file (or part of a file):
+// its index in the high 32 bits and WHOLE_FILE (or the part) in the low
+#define WHOLE_FILE 0xffffffffu
+#define FILE_TASK(file, part) ((unsigned long long) (file) << 32 | (unsigned int) (part))
+
+// the results of counting one part of a split file
+typedef struct _filePart {
+  int worker; // the worker whose table the part was counted into
+  long long wordCount; // # of words found in the part
+  unsigned int firstWord; // id of the first word (in that worker's dict)
+  unsigned int lastWord; // id of the last word (in that worker's dict)
+} FilePart;
+
+// a mapped file that is split into parts, each counted as its own task
+typedef struct _fileSplit {
+  WordReader reader; // the mapped file, shared by the parts
+  int partCount; // # of parts
+  int partsLeft; // parts not counted yet; the last one unmaps the file
+  FilePart parts[]; // results, in file order
+} FileSplit;
+
+// what the workers of one countFiles() share
+typedef struct _fileWork {
+  char** paths; // the files
+  WorkQueue queue; // tasks not started yet, one deque per worker
+  HashTable** tables; // one per worker; tables[0] is the caller's
+  int* errors; // errno of each file that could not be opened, else 0
+  FileSplit** splits; // each file's parts, NULL if it is counted whole
+} FileWork;
+
+// one worker of a countFiles()
+typedef struct _fileWorker {
+  FileWork* work;
+  int index; // which deque and table are this worker's
+} FileWorker;
+
+// count the pairs of consecutive words of a reader:
+long long countWords(HashTable* hashTable, WordReader* reader,
+                     unsigned int* firstWord, unsigned int* lastWord) {
+  const char* word; // current word, a slice into the reader
+  int wordLength; // length of current word
+  unsigned int previousWord; // dictionary id of the first word in a pair
+  unsigned int currentWord; // dictionary id of the second word in a pair
+  long long wordCount = 1;
+  unsigned long long keys[INSERT_BATCH]; // pairs not inserted yet
+  int keyCount = 0; // # of keys
+
+  // get first word
+  wordLength = getNextWordSlice(reader, &word);
+  if (wordLength == 0) return 0;
+  previousWord = internWord(hashTable->dict, word, wordLength);
+  *firstWord = previousWord;
+
+  while ((wordLength = getNextWordSlice(reader, &word)) != 0) {
+    // each word is interned once; a pair is just the two ids
+    // packed into a key, so nothing is copied or allocated here.
+    // The keys are inserted a batch at a time (see insertBatch())
+    currentWord = internWord(hashTable->dict, word, wordLength);
+    keys[keyCount++] = PAIR_KEY(previousWord, currentWord);
+    if (keyCount == INSERT_BATCH) {
+      insertBatch(hashTable, keys, keyCount);
+      keyCount = 0;
+    }
+    // get ready for next word pair
+    previousWord = currentWord;
+    wordCount++;
+  }
+
+  insertBatch(hashTable, keys, keyCount);
+
+  *lastWord = previousWord;
+  return wordCount;
+}
+
+// thread body: count one chunk into its own table
+static void* countChunk(void* argument) {
+  Chunk* chunk = argument;
+  WordReader reader;
+
+  openWordReaderMemory(&reader, chunk->data, chunk->size);
+  chunk->wordCount = countWords(chunk->hashTable, &reader,
+                                &chunk->firstWord, &chunk->lastWord);
+  closeWordReader(&reader);
+  return NULL;
+}
+
+// count a mapped file on chunkCount threads and merge the results:
+static void countChunks(HashTable* hashTable, const char* data, size_t size, int chunkCount) {
+  Chunk* chunks = malloc(sizeof(Chunk) * chunkCount);
+  pthread_t* threads = malloc(sizeof(pthread_t) * chunkCount);
+  int* started = calloc(chunkCount, sizeof(int));
+  size_t start = 0;
+  int i;
+
+  for (i = 0; i < chunkCount; i++) {
+    // nominal end of the chunk, moved forward to just past whitespace
+    size_t end = (i == chunkCount - 1) ? size : size / chunkCount * (i + 1);
+    if (end < start) end = start;
+    while (end < size && (end == start || !isspace((unsigned char) data[end - 1]))) {
+      end++;
+    }
+
+    chunks[i].hashTable = initHashTable();
+    chunks[i].data = data + start;
+    chunks[i].size = end - start;
+    start = end;
+
+    // the last chunk is counted on this thread; if a thread cannot be
+    // created its chunk is counted here after the others are started
+    if (i < chunkCount - 1 && pthread_create(&threads[i], NULL, countChunk, &chunks[i]) == 0) {
+      started[i] = 1;
+    }
+  }
+  for (i = 0; i < chunkCount; i++) {
+    if (!started[i]) countChunk(&chunks[i]);
+  }
+  for (i = 0; i < chunkCount; i++) {
+    if (started[i]) pthread_join(threads[i], NULL);
+  }
+
+  // add the pairs straddling each boundary, then merge the chunk tables
+  StatTimer timer = startTimer(PHASE_MERGE);
+  Chunk* previous = NULL; // last chunk that contained a word
+  for (i = 0; i < chunkCount; i++) {
+    if (chunks[i].wordCount == 0) continue;
+    if (previous != NULL) {
+      Dictionary* firstDict = previous->hashTable->dict;
+      Dictionary* secondDict = chunks[i].hashTable->dict;
+      unsigned int firstWord = internWord(hashTable->dict,
+                                          firstDict->words[previous->lastWord],
+                                          firstDict->lengths[previous->lastWord]);
+      unsigned int secondWord = internWord(hashTable->dict,
+                                           secondDict->words[chunks[i].firstWord],
+                                           secondDict->lengths[chunks[i].firstWord]);
+      insert(hashTable, PAIR_KEY(firstWord, secondWord));
+    }
+    previous = &chunks[i];
+  }
+  HashTable** tables = malloc(sizeof(HashTable*) * chunkCount);
+  for (i = 0; i < chunkCount; i++) {
+    tables[i] = chunks[i].hashTable;
+    addStat(&runStats.wordsRead, chunks[i].wordCount);
+  }
+  mergeHashTables(hashTable, tables, chunkCount, chunkCount);
+  stopTimer(timer);
+
+  free(tables);
+  free(started);
+  free(threads);
+  free(chunks);
+}
+
+// count the pairs of one file:
+int countFile(HashTable* hashTable, const char* path, int threads) {
+  WordReader reader; // tokenizer over the (memory-mapped) file
+  unsigned int firstWord, lastWord; // unused for a whole file
+  size_t chunkCount = 1;
+
+  StatTimer timer = startTimer(PHASE_COUNT);
+  if (openWordReader(&reader, path) != 0) return -1;
+
+  // split only mapped files, and only into chunks worth a thread
+  if (reader.mapped && threads > 1) {
+    chunkCount = reader.size / MIN_CHUNK_SIZE;
+    if (chunkCount > (size_t) threads) chunkCount = threads;
+    if (chunkCount < 1) chunkCount = 1;
+  }
+
+  if (chunkCount > 1) {
+    countChunks(hashTable, reader.data, reader.size, chunkCount);
+  } else {
+    addStat(&runStats.wordsRead, countWords(hashTable, &reader, &firstWord, &lastWord));
+  }
+
+  // unmap (or free the read buffer of) the file and close it
+  addStat(&runStats.bytesRead, reader.bytesRead);
+  addStat(&runStats.fileCount, 1);
+  closeWordReader(&reader);
+  stopTimer(timer);
+  return 0;
+}
+
+// where a part of a split file starts: the nominal offset, moved
+// forward to just past whitespace (as countChunks() moves chunk ends)
+static size_t partStart(const char* data, size_t size, size_t offset) {
+  while (offset > 0 && offset < size && !isspace((unsigned char) data[offset - 1])) offset++;
+  return offset;
+}
+
+// count one part of a split file into a worker's table
+static void countPart(FileWork* work, int worker, int file, int part) {
+  FileSplit* split = work->splits[file];
+  const char* data = split->reader.data;
+  size_t size = split->reader.size;
+  size_t start = partStart(data, size, size / split->partCount * part);
+  size_t end = part == split->partCount - 1 ? size : partStart(data, size, size / split->partCount * (part + 1));
+  FilePart* result = &split->parts[part];
+  WordReader reader;
+
+  openWordReaderMemory(&reader, data + start, end - start);
+  result->worker = worker;
+  result->wordCount = countWords(work->tables[worker], &reader, &result->firstWord, &result->lastWord);
+  closeWordReader(&reader);
+  addStat(&runStats.wordsRead, result->wordCount);
+
+  if (__atomic_sub_fetch(&split->partsLeft, 1, __ATOMIC_ACQ_REL) == 0) {
+    // every part is counted: the words are in the tables, so unmap
+    addStat(&runStats.bytesRead, split->reader.bytesRead);
+    closeWordReader(&split->reader);
+  }
+}
+
+// count one file into a worker's table, or split it into parts that any
+// worker may count if it is large
+static void countWholeFile(FileWork* work, int worker, int file) {
+  WordReader reader;
+  unsigned int firstWord, lastWord; // unused for a whole file
+
+  if (openWordReader(&reader, work->paths[file]) != 0) {
+    work->errors[file] = errno;
+    return;
+  }
+  addStat(&runStats.fileCount, 1);
+
+  if (reader.mapped && reader.size / MIN_CHUNK_SIZE >= 2) {
+    // the other parts go on this worker's deque, where idle workers
+    // steal them, and this worker starts on the first
+    int partCount = reader.size / MIN_CHUNK_SIZE > INT_MAX ? INT_MAX : reader.size / MIN_CHUNK_SIZE;
+    FileSplit* split = malloc(sizeof(FileSplit) + sizeof(FilePart) * partCount);
+    split->reader = reader;
+    split->partCount = partCount;
+    split->partsLeft = partCount;
+    work->splits[file] = split;
+    for (int part = partCount - 1; part > 0; part--) pushTask(&work->queue, worker, FILE_TASK(file, part));
+    countPart(work, worker, file, 0);
+    return;
+  }
+
+  addStat(&runStats.wordsRead, countWords(work->tables[worker], &reader, &firstWord, &lastWord));
+  addStat(&runStats.bytesRead, reader.bytesRead);
+  closeWordReader(&reader);
+}
+
+// thread body: run tasks until every file has been counted
+static void* countFileTasks(void* argument) {
+  FileWorker* worker = argument;
+  FileWork* work = worker->work;
+  unsigned long long task;
+
+  while (takeTask(&work->queue, worker->index, &task)) {
+    int file = task >> 32;
+    unsigned int part = (unsigned int) task;
+    if (part == WHOLE_FILE) countWholeFile(work, worker->index, file);
+    else countPart(work, worker->index, file, part);
+    finishTask(&work->queue);
+  }
+  return NULL;
+}
+
+// add the pairs that straddle the parts of a split file to a table
+static void addPartBoundaries(HashTable* hashTable, HashTable** tables, FileSplit* split) {
+  FilePart* previous = NULL; // last part that contained a word
+
+  for (int part = 0; part < split->partCount; part++) {
+    FilePart* current = &split->parts[part];
+    if (current->wordCount == 0) continue;
+    if (previous != NULL) {
+      Dictionary* firstDict = tables[previous->worker]->dict;
+      Dictionary* secondDict = tables[current->worker]->dict;
+      unsigned int firstWord = internWord(hashTable->dict,
+                                          firstDict->words[previous->lastWord],
+                                          firstDict->lengths[previous->lastWord]);
+      unsigned int secondWord = internWord(hashTable->dict,
+                                           secondDict->words[current->firstWord],
+                                           secondDict->lengths[current->firstWord]);
+      insert(hashTable, PAIR_KEY(firstWord, secondWord));
+    }
+    previous = current;
+  }
+}
+
+// count many files on several threads, each into its own table, and
+// merge the tables
+static int countFilesParallel(HashTable* hashTable, char** paths, int pathCount, int threads,
+                              const char** failedName) {
+  FileWork work;
+  FileWorker* workers = malloc(sizeof(FileWorker) * threads);
+  pthread_t* workerThreads = malloc(sizeof(pthread_t) * threads);
+  int* started = calloc(threads, sizeof(int));
+  int failed = -1; // first file that could not be opened
+
+  StatTimer timer = startTimer(PHASE_COUNT);
+  work.paths = paths;
+  work.tables = malloc(sizeof(HashTable*) * threads);
+  work.errors = calloc(pathCount ? pathCount : 1, sizeof(int));
+  work.splits = calloc(pathCount ? pathCount : 1, sizeof(FileSplit*));
+  initWorkQueue(&work.queue, threads);
+
+  // deal each worker a run of consecutive files, pushed last first so
+  // that it takes them in order while thieves take them from the end
+  for (int w = 0; w < threads; w++) {
+    int first = (long long) pathCount * w / threads;
+    int last = (long long) pathCount * (w + 1) / threads;
+    for (int file = last - 1; file >= first; file--) pushTask(&work.queue, w, FILE_TASK(file, WHOLE_FILE));
+    work.tables[w] = w == 0 ? hashTable : initHashTable();
+  }
+
+  // worker 0 runs on this thread; the deque of a worker whose thread
+  // cannot be created is simply emptied by the others
+  for (int w = 0; w < threads; w++) {
+    workers[w].work = &work;
+    workers[w].index = w;
+    if (w > 0) started[w] = pthread_create(&workerThreads[w], NULL, countFileTasks, &workers[w]) == 0;
+  }
+  countFileTasks(&workers[0]);
+  for (int w = 1; w < threads; w++) {
+    if (started[w]) pthread_join(workerThreads[w], NULL);
+  }
+  addStat(&runStats.stolenTasks, work.queue.stolen);
+
+  for (int file = 0; file < pathCount && failed < 0; file++) {
+    if (work.errors[file] != 0) failed = file;
+  }
+  StatTimer mergeTimer = startTimer(PHASE_MERGE);
+  for (int file = 0; file < pathCount; file++) {
+    if (work.splits[file] == NULL) continue;
+    if (failed < 0) addPartBoundaries(hashTable, work.tables, work.splits[file]);
+    free(work.splits[file]);
+  }
+  if (failed < 0) {
+    mergeHashTables(hashTable, work.tables + 1, threads - 1, threads);
+  } else {
+    for (int w = 1; w < threads; w++) destroy(work.tables[w]);
+  }
+  stopTimer(mergeTimer);
+  stopTimer(timer);
+
+  freeWorkQueue(&work.queue);
+  free(work.splits);
+  free(work.tables);
+  free(started);
+  free(workerThreads);
+  free(workers);
+  if (failed >= 0) {
+    *failedName = paths[failed];
+    errno = work.errors[failed];
+    free(work.errors);
+    return -1;
+  }
+  free(work.errors);
+  return 0;
+}
+
+// WordReader fill function: release the block that was tokenized and
+// hand out the file's next block, if it has one
+static int nextFileBlock(void* context, const char** data, size_t* size) {
+  BlockSource* source = context;
+  int last = source->block->last;
+
+  releaseBlock(source->ahead, source->block);
+  if (last) return 0;
+  source->block = nextBlock(source->ahead); // more blocks of the file follow
+  *data = source->block->data;
+  *size = source->block->size;
+  return 1;
+}
+
+// count the pairs of many files:
+int countFiles(HashTable* hashTable, char** paths, int pathCount, int threads, const char** failedName) {
+  ReadAhead ahead;
+  ReadBlock* block;
+
+  if (threads > 1) return countFilesParallel(hashTable, paths, pathCount, threads, failedName);
+  if (readMethod() == READ_MAPPED) {
+    for (int i = 0; i < pathCount; i++) {
+      if (countFile(hashTable, paths[i], 1) != 0) {
+        *failedName = paths[i];
+        return -1;
+      }
+    }
+    return 0;
+  }
+
+  startReadAhead(&ahead, paths, pathCount);
+  while ((block = nextBlock(&ahead)) != NULL) {
+    if (block->error != 0 || block->direct) {
+      // a file that cannot be opened, or one that has to be read as it
+      // arrives (a pipe), in its turn
+      int file = block->file;
+      int error = block->error;
+      releaseBlock(&ahead, block);
+      if (error == 0 && countFile(hashTable, paths[file], 1) == 0) continue;
+      if (error == 0) error = errno;
+      stopReadAhead(&ahead);
+      *failedName = paths[file];
+      errno = error;
+      return -1;
+    }
+
+    // the file's first block is here; the WordReader asks for the others
+    // (and releases each one) as it goes, up to the file's last block
+    StatTimer timer = startTimer(PHASE_COUNT);
+    WordReader reader;
+    BlockSource source = { &ahead, block };
+    unsigned int firstWord, lastWord; // unused for a whole file
+    openWordReaderBlocks(&reader, block->data, block->size, nextFileBlock, &source);
+    addStat(&runStats.wordsRead, countWords(hashTable, &reader, &firstWord, &lastWord));
+    addStat(&runStats.bytesRead, reader.bytesRead);
+    addStat(&runStats.fileCount, 1);
+    closeWordReader(&reader);
+    stopTimer(timer);
+  }
+  stopReadAhead(&ahead);
+  return 0;
+}
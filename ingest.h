@@ -0,0 +1,77 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "hash.h"
+#include "getWord.h"
+#include "readAhead.h"
+
+#ifndef MIN_CHUNK_SIZE
+#define MIN_CHUNK_SIZE (1 << 20) // files are never split into smaller chunks
+#endif
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  count the pairs of one file: countFile(HashTable*, const char*, int)
+// **  count the pairs of many files: countFiles(HashTable*, char**, int, int, const char**)
+// **  count the pairs of a reader: countWords(HashTable*, WordReader*, ...)
+// **
+// ** A file that is memory-mapped can be counted by several threads
+// ** at once. It is split into one chunk per thread, each chunk ending
+// ** just after a whitespace character so that no word is cut in two
+// ** (after whitespace getNextWord() is always between words, so every
+// ** chunk sees exactly the words a single reader would see). Every
+// ** chunk is counted into its own HashTable, the one pair that
+// ** straddles each chunk boundary is added from the last word of one
+// ** chunk and the first word of the next, and the chunk tables are
+// ** then merged into the caller's HashTable, in parallel, with
+// ** mergeHashTables() (see shardMerge.h).
+// **
+// ** Many files counted with more than one thread are spread over
+// ** worker threads by work stealing (see workQueue.h). Each worker
+// ** is dealt a run of the files and counts them into its own
+// ** HashTable; a worker that runs out steals files from the others,
+// ** so a few huge files hold up only the workers counting them. A
+// ** mapped file larger than two MIN_CHUNK_SIZE chunks is split, when
+// ** it is opened, into parts of about MIN_CHUNK_SIZE (cut just after
+// ** whitespace, as above) that the other workers steal as well, and
+// ** the pairs straddling the parts are added from their first and
+// ** last words. Pairs never span two files. The workers' tables are
+// ** merged into the caller's HashTable with mergeHashTables(), one
+// ** shard of the pairs per thread.
+// **
+// ** Files counted on one thread are instead read ahead (see
+// ** readAhead.h): while one block of a file is tokenized and counted,
+// ** the blocks after it, and the files after it, are already being
+// ** read, so a run over many files that are not in the page cache
+// ** takes about as long as the slower of reading and counting rather
+// ** than both added up.
+
+// countWords() counts every pair of consecutive words returned by the
+// WordReader into the HashTable. The ids of the first and last word
+// read are stored through the two unsigned int pointers (when at least
+// one word was read) so that the caller can pair them with the words
+// of neighbouring chunks. The function returns the number of words read.
+long long countWords(HashTable*, WordReader*, unsigned int*, unsigned int*);
+
+// countFile() opens the file named by the second argument and counts its
+// word pairs into the HashTable. The third argument is the number of
+// threads that may count the file; files that cannot be mapped, or that
+// are smaller than MIN_CHUNK_SIZE per thread, are counted on the calling
+// thread. The function returns 0 on success and -1 (with errno set) if
+// the file cannot be opened.
+int countFile(HashTable*, const char*, int);
+
+// countFiles() counts the word pairs of the given number of files (the
+// second argument) into the HashTable, each file on its own as
+// countFile() does. With one thread (the fourth argument) the files are
+// read ahead by the method set with setReadMethod() (or, with
+// READ_MAPPED, each is counted by countFile() in turn); with more they
+// are counted by that many workers stealing work from each other. The
+// function returns 0 on success, or -1 (with errno set, and the file's
+// name stored through the last argument) if a file cannot be opened:
+// the first one with one thread, after which nothing more is read, or
+// the first in the list with more, once the others have been counted.
+int countFiles(HashTable*, char**, int, int, const char**);
+
+#endif
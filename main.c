@@ -1,8 +1,22 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include "hash.h"
 #include "getWord.h"
+#include "ingest.h"
+#include "wordHash.h"
+#include "stream.h"
+#include "stats.h"
+#include "snapshot.h"
+#include "cache.h"
+#include "approx.h"
+#include "spill.h"
+#include "ngram.h"
+#include "output.h"
+#include "server.h"
+#include "successor.h"
+#include "fileList.h"
 
 // ********************************************************
 // ********************************************************
@@ -11,16 +25,69 @@
 // **
 // **  This program ingests 1 or more files and uses a 
 // **  hash table to store consecutive word pairs. The 
-// **  qsort() function is used to sort the word pairs by
-// **  the number of times they appear in the file(s). 
+// **  word pairs are then sorted by the number of times
+// **  they appear in the file(s) (see radixSort.h). 
 // **  An optional argument specifying the number of word 
 // **  pairs to display to stdout may be given. If no optional 
 // **  argument specifying the display count is given, all 
 // **  word pairs present in the file(s) will be displayed.
+// **  The other options are described in the README and
+// **  in the header of the module that implements each.
 // **  See hash.h for more information on the hash table
 // **  implementation.
 // **
 
+// read the number that follows an option such as "--interval 5",
+// advancing the argument iterator past it. Returns 0 (after printing
+// an error) if it is missing, not a number, or negative.
+static int optionValue(char** argv, int* argIterator, double* value) {
+  char* option = argv[*argIterator];
+  char* text = argv[++*argIterator];
+  char trailing; // catches anything after the number
+
+  if (text == NULL || sscanf(text, "%lf%c", value, &trailing) != 1 || *value < 0) {
+    fprintf(stderr, "Expected a non-negative number after %s...\n", option);
+    return 0;
+  }
+  return 1;
+}
+
+// read a memory size such as "256M" (suffixes K, M and G) after an
+// option, advancing the argument iterator past it. Returns 0 (after
+// printing an error) if it is missing or not a positive size.
+static int memoryValue(char** argv, int* argIterator, long long* bytes) {
+  char* option = argv[*argIterator];
+  char* text = argv[++*argIterator];
+  char* suffix = NULL; // K, M or G, if any
+  double size = text != NULL ? strtod(text, &suffix) : 0;
+
+  if (text == NULL || suffix == text || size <= 0
+      || (*suffix != '\0' && (strchr("KkMmGg", *suffix) == NULL || suffix[1] != '\0'))) {
+    fprintf(stderr, "Expected a memory size (such as 256M) after %s...\n", option);
+    return 0;
+  }
+  switch (*suffix) {
+    case 'G': case 'g': size *= 1024;
+    /* fall through */
+    case 'M': case 'm': size *= 1024;
+    /* fall through */
+    case 'K': case 'k': size *= 1024;
+  }
+  *bytes = size;
+  return 1;
+}
+
+// check whether an argument is the given short option, on its own
+// ("-j") or with its number attached ("-j4"); anything else that starts
+// the same way (such as "-junk.txt") is a filename
+static int isShortOption(const char* argument, char letter) {
+  if (argument[0] != '-' || argument[1] != letter) return 0;
+  for (const char* digit = argument + 2; *digit != '\0'; digit++) {
+    if (!isdigit((unsigned char) *digit)) return 0;
+  }
+  return 1;
+}
+
 int main(int argc, char** argv) {
   
   int displayWordpairCount = -1; // number of wordpairs to show, -1 indicates it is not set
@@ -36,21 +103,213 @@ int main(int argc, char** argv) {
   char argBuffer[10]; // used for sscanf read (during display count arg check)
   int tempInt; // temporary storage for display count arg scanned
   int argIterator; // for iterating through argv
-  
-  // variables needed for constructing wordpairs
-  char* word1;
-  char* word2;
-  char wordpair[514]; // maximum space for combined wordpairs
-  char* space = " "; // space concatenated between words in wordpair[]
-  
-  HashTable* myHashTable = initHashTable(); // initialize the HashTable
+  int threadCount = 1; // number of threads the files are counted on (-j)
+  const WordHash* hashFunction; // hash function for words (--hash)
+  FileList files; // files to count, in order, directories expanded (see fileList.h)
+  int streaming = 0; // --stream: count a live input (see stream.h)
+  StreamOptions streamOptions = { 0, 0, 0, 0, 0 }; // snapshot settings
+  double optionNumber; // value of a numeric option
+  int statsFormat = -1; // --stats: -1 = no report, 0 = text, 1 = JSON
+  char** loadNames = malloc(sizeof(char*) * argc); // --load snapshots, in order
+  int loadNameCount = 0; // number of --load snapshots
+  char* saveName = NULL; // --save snapshot
+  char* cacheName = NULL; // --cache directory
+  char* serveName = NULL; // --serve socket path
+  char* followWord = NULL; // --follow: print the pairs that start with this word
+  int followCount = -1; // -k: # of --follow pairs printed (-1 = not given)
+  int approximate = 0; // --approx: count in fixed memory (see approx.h)
+  long long memoryBytes = APPROX_DEFAULT_MEMORY; // --mem budget for --approx
+  int memoryLimited = 0; // --mem given: without --approx, spill past it
+  char* tmpDir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp"; // --tmpdir for spilled runs
+  int gramLength = 2; // -n: # of words counted together (2 = pairs)
+  int format = FORMAT_TEXT; // --format of the printed pairs
+  int expectUnique = 0; // --expect-unique: size the table up front (0 = grow as needed)
+  int ioGiven = 0; // --io given (n-grams are always read mapped)
+  int status = 1; // exit status, 1 until the pairs are printed
 
-  FILE* fp; // pointer to file to ingest from
+  initFileList(&files);
 
-  // iterate through arguments provided, check for optional display count
-  // arg, otherwise try to open a file with filename provided in arg  
+  // iterate through arguments provided, handling the options first
+  // so that they apply to every file; anything else is a filename
   for (argIterator = 1; argIterator < argc; argIterator++) {
 
+    // handle optional thread count argument ("-j N" or "-jN")
+    if (isShortOption(argv[argIterator], 'j')) {
+      char* value = argv[argIterator][2] != '\0' ? argv[argIterator] + 2 : argv[++argIterator];
+      if (value == NULL || sscanf(value, "%d%1s", &tempInt, argBuffer) != 1 || tempInt < 1) {
+        fprintf(stderr, "Expected a positive thread count after -j...\n");
+        goto done;
+      }
+      threadCount = tempInt;
+      continue;
+    }
+
+    // handle optional n-gram length argument ("-n N" or "-nN")
+    if (isShortOption(argv[argIterator], 'n')) {
+      char* value = argv[argIterator][2] != '\0' ? argv[argIterator] + 2 : argv[++argIterator];
+      if (value == NULL || sscanf(value, "%d%1s", &tempInt, argBuffer) != 1
+          || tempInt < 1 || tempInt > NGRAM_MAX) {
+        fprintf(stderr, "Expected an n-gram length from 1 to %d after -n...\n", NGRAM_MAX);
+        goto done;
+      }
+      gramLength = tempInt;
+      continue;
+    }
+
+    // handle optional hash function argument ("--hash NAME")
+    if (strcmp(argv[argIterator], "--hash") == 0) {
+      char* value = argv[++argIterator];
+      if (value == NULL || (hashFunction = findWordHash(value)) == NULL) {
+        const char* const* names = wordHashNames();
+        fprintf(stderr, "Expected a hash function after --hash, one of:");
+        for (int i = 0; names[i] != NULL; i++) fprintf(stderr, " %s", names[i]);
+        fprintf(stderr, "\n");
+        goto done;
+      }
+      setWordHash(hashFunction);
+      continue;
+    }
+
+    // handle optional read method argument ("--io NAME")
+    if (strcmp(argv[argIterator], "--io") == 0) {
+      char* value = argv[++argIterator];
+      if (value == NULL || (tempInt = findReadMethod(value)) < 0) {
+        fprintf(stderr, "Expected a read method after --io, one of: uring threads mmap\n");
+        goto done;
+      }
+      setReadMethod(tempInt);
+      ioGiven = 1;
+      continue;
+    }
+
+    // handle optional output format argument ("--format NAME")
+    if (strcmp(argv[argIterator], "--format") == 0) {
+      char* value = argv[++argIterator];
+      if (value == NULL || (format = findOutputFormat(value)) < 0) {
+        fprintf(stderr, "Expected an output format after --format, one of: text tsv binary\n");
+        goto done;
+      }
+      setOutputFormat(format);
+      continue;
+    }
+
+    // handle the report option ("--stats" or "--stats=json")
+    if (strcmp(argv[argIterator], "--stats") == 0 || strcmp(argv[argIterator], "--stats=text") == 0) {
+      statsFormat = 0;
+      continue;
+    }
+    if (strcmp(argv[argIterator], "--stats=json") == 0) {
+      statsFormat = 1;
+      continue;
+    }
+
+    // handle the snapshot options ("--load FILE", "--save FILE", "--cache DIR")
+    if (strcmp(argv[argIterator], "--load") == 0 || strcmp(argv[argIterator], "--save") == 0
+        || strcmp(argv[argIterator], "--cache") == 0) {
+      char* option = argv[argIterator];
+      char* value = argv[++argIterator];
+      if (value == NULL) {
+        fprintf(stderr, "Expected a %s after %s...\n", option[2] == 'c' ? "directory" : "snapshot file", option);
+        goto done;
+      }
+      if (option[2] == 'l') loadNames[loadNameCount++] = value;
+      else if (option[2] == 'c') cacheName = value;
+      else saveName = value;
+      continue;
+    }
+
+    // handle the file list option ("--files-from LIST")
+    if (strcmp(argv[argIterator], "--files-from") == 0) {
+      char* value = argv[++argIterator];
+      if (value == NULL) {
+        fprintf(stderr, "Expected a file list after --files-from...\n");
+        goto done;
+      }
+      if (readFileList(&files, value) != 0) {
+        fprintf(stderr, "Unable to read file list: %s\n", value);
+        goto done;
+      }
+      continue;
+    }
+
+    // handle the server option ("--serve PATH")
+    if (strcmp(argv[argIterator], "--serve") == 0) {
+      if ((serveName = argv[++argIterator]) == NULL) {
+        fprintf(stderr, "Expected a socket path after --serve...\n");
+        goto done;
+      }
+      continue;
+    }
+
+    // handle the follower query options ("--follow WORD", "-k N")
+    if (strcmp(argv[argIterator], "--follow") == 0) {
+      if ((followWord = argv[++argIterator]) == NULL) {
+        fprintf(stderr, "Expected a word after --follow...\n");
+        goto done;
+      }
+      continue;
+    }
+    if (strcmp(argv[argIterator], "-k") == 0) {
+      char* value = argv[++argIterator];
+      if (value == NULL || sscanf(value, "%d%1s", &tempInt, argBuffer) != 1 || tempInt < 0) {
+        fprintf(stderr, "Expected a non-negative pair count after -k...\n");
+        goto done;
+      }
+      followCount = tempInt;
+      continue;
+    }
+
+    // handle the approximate mode options ("--approx", "--mem SIZE")
+    if (strcmp(argv[argIterator], "--approx") == 0) {
+      approximate = 1;
+      continue;
+    }
+    if (strcmp(argv[argIterator], "--mem") == 0) {
+      if (!memoryValue(argv, &argIterator, &memoryBytes)) {
+        goto done;
+      }
+      memoryLimited = 1;
+      continue;
+    }
+    if (strcmp(argv[argIterator], "--tmpdir") == 0) {
+      if ((tmpDir = argv[++argIterator]) == NULL) {
+        fprintf(stderr, "Expected a directory after --tmpdir...\n");
+        goto done;
+      }
+      continue;
+    }
+
+    // handle the table size option ("--expect-unique N")
+    if (strcmp(argv[argIterator], "--expect-unique") == 0) {
+      if (!optionValue(argv, &argIterator, &optionNumber)) {
+        goto done;
+      }
+      if (optionNumber > LOAD_FACTOR * (1 << 30)) {
+        fprintf(stderr, "Expected at most %.0f unique pairs after --expect-unique...\n", LOAD_FACTOR * (1 << 30));
+        goto done;
+      }
+      expectUnique = optionNumber;
+      continue;
+    }
+
+    // handle the streaming mode options
+    if (strcmp(argv[argIterator], "--stream") == 0) {
+      streaming = 1;
+      continue;
+    }
+    if (strcmp(argv[argIterator], "--interval") == 0
+        || strcmp(argv[argIterator], "--interval-pairs") == 0
+        || strcmp(argv[argIterator], "--window") == 0) {
+      char* option = argv[argIterator];
+      if (!optionValue(argv, &argIterator, &optionNumber)) {
+        goto done;
+      }
+      if (option[2] == 'w') streamOptions.windowSeconds = optionNumber;
+      else if (option[10] == '-') streamOptions.intervalPairs = optionNumber;
+      else streamOptions.intervalSeconds = optionNumber;
+      continue;
+    }
+
     // handle optional integer argument first
     if (sscanf(argv[argIterator], "-%d%s", &tempInt, argBuffer) == 1) {
       // valid optional display count argument provided
@@ -58,57 +317,223 @@ int main(int argc, char** argv) {
       displayWordpairCount = tempInt;
       continue;
     }
- 
-    // this argument is not the optional display count arg
-    // try to open the file specified
-    fp = fopen(argv[argIterator], "r");
-    if (fp == NULL) {
-      // unable to open file specified, print to stderr
-      // and exit...
-      fprintf(stderr, "Unable to open file: %s\n", argv[argIterator]);
+
+    // this argument is not an option, so it names a file (or a
+    // directory of them)
+    if (addPath(&files, argv[argIterator]) != 0) {
+      fprintf(stderr, "Unable to read directory: %s\n", argv[argIterator]);
+      goto done;
+    }
+  }
+  char** fileNames = files.paths;
+  int fileNameCount = files.count;
+
+  if (gramLength != 2 && (streaming || approximate || memoryLimited || cacheName != NULL
+                          || loadNameCount > 0 || saveName != NULL || statsFormat >= 0
+                          || threadCount > 1 || expectUnique > 0 || ioGiven)) {
+    // these modes store word pairs, not n-grams, and n-grams are counted
+    // on one thread from mapped files into a table that grows as needed
+    fprintf(stderr, "Expected -n 2 with -j, --stream, --approx, --mem, --cache, --load, --save, --stats, --expect-unique and --io...\n");
+    goto done;
+  }
+
+  if (serveName != NULL && (streaming || approximate || memoryLimited || gramLength != 2)) {
+    // the server answers from one complete, exact pair table
+    fprintf(stderr, "Expected no --stream, --approx, --mem or -n with --serve...\n");
+    goto done;
+  }
+
+  if (followWord != NULL && (serveName != NULL || streaming || approximate || memoryLimited
+                             || gramLength != 2)) {
+    // the followers are looked up in one complete, exact pair table
+    fprintf(stderr, "Expected no --serve, --stream, --approx, --mem or -n with --follow...\n");
+    goto done;
+  }
+  if (followCount >= 0 && followWord == NULL) {
+    fprintf(stderr, "Expected --follow with -k...\n");
+    goto done;
+  }
+
+  if (streaming && (threadCount > 1 || statsFormat >= 0 || loadNameCount > 0 || saveName != NULL
+                    || cacheName != NULL || approximate || memoryLimited)) {
+    // the stream is counted on one thread, in memory, and only its
+    // snapshots are printed
+    fprintf(stderr, "Expected no -j, --stats, --load, --save, --cache, --approx or --mem with --stream...\n");
+    goto done;
+  }
+
+  if (approximate && (threadCount > 1 || statsFormat >= 0 || loadNameCount > 0 || saveName != NULL
+                      || cacheName != NULL || expectUnique > 0)) {
+    // the counts are estimates in a sketch, counted on one thread,
+    // and only the top pairs are kept
+    fprintf(stderr, "Expected no -j, --stats, --load, --save, --cache or --expect-unique with --approx...\n");
+    goto done;
+  }
+
+  if (streaming && format == FORMAT_BINARY) {
+    // snapshots are separated by "# snapshot" text lines
+    fprintf(stderr, "Expected --format text or tsv with --stream...\n");
+    goto done;
+  }
+
+  if (streaming) {
+    // count stdin (or the one file/FIFO named) as it arrives, printing
+    // a snapshot of the top pairs every interval (see stream.h)
+    char* streamName = fileNameCount > 0 && strcmp(fileNames[0], "-") != 0 ? fileNames[0] : NULL;
+    if (fileNameCount > 1) {
+      fprintf(stderr, "Expected at most 1 file to stream from...\n");
+      goto done;
+    }
+    streamOptions.expectUnique = expectUnique;
+    streamOptions.topCount = displayWordpairCount > 0 ? displayWordpairCount : STREAM_DEFAULT_TOP;
+    if (streamOptions.intervalSeconds == 0 && streamOptions.intervalPairs == 0) {
+      streamOptions.intervalSeconds = STREAM_DEFAULT_INTERVAL;
+    }
+    if (streamPairs(streamName, &streamOptions) != 0) {
+      fprintf(stderr, "Unable to open file: %s\n", streamName != NULL ? streamName : "stdin");
+      goto done;
+    }
+    status = 0;
+    goto done;
+  }
+
+  if (approximate) {
+    // estimate the top pairs of every file in a fixed amount of memory
+    int topCount = displayWordpairCount >= 0 ? displayWordpairCount : APPROX_DEFAULT_TOP;
+    ApproxCounter* approx = createApprox(memoryBytes, topCount);
+    if (approx == NULL) {
+      fprintf(stderr, "Expected at least %lldK after --mem to find the top %d pairs with --approx...\n",
+              (approxMinimumMemory(topCount) + 1023) / 1024, topCount);
+      goto done;
+    }
+    for (int i = 0; i < fileNameCount; i++) {
+      if (approxCountFile(approx, fileNames[i]) != 0) {
+        fprintf(stderr, "Unable to open file: %s\n", fileNames[i]);
+        destroyApprox(approx);
+        goto done;
+      }
+    }
+    printApprox(approx, topCount);
+    printApproxBounds(stderr, approx);
+    destroyApprox(approx);
+    status = 0;
+    goto done;
+  }
+
+  if (gramLength != 2) {
+    // count n-grams of every file in a GramTable (see ngram.h)
+    GramTable* grams = createGramTable(gramLength);
+    for (int i = 0; i < fileNameCount; i++) {
+      if (countGramFile(grams, fileNames[i]) != 0) {
+        fprintf(stderr, "Unable to open file: %s\n", fileNames[i]);
+        destroyGramTable(grams);
+        goto done;
+      }
+    }
+    if (fileNameCount == 0) fprintf(stderr, "Did not receive valid filename as argument...\n");
+    printSortedGramTable(grams, displayWordpairCount);
+    destroyGramTable(grams);
+    status = 0;
+    goto done;
+  }
+
+  setSortThreads(threadCount); // -j also sorts the pairs for printing
+
+  // initialize the HashTable (with room for --expect-unique pairs)
+  HashTable* myHashTable = expectUnique > 0 ? sizedHashTable(expectUnique) : initHashTable();
+  SpillState spill; // runs written past the --mem budget (see spill.h)
+  if (memoryLimited) {
+    startSpilling(myHashTable, &spill, memoryBytes, tmpDir);
+    threadCount = 1; // per-thread tables would not be bounded
+  }
+
+  // merge each saved snapshot specified (see snapshot.h)
+  for (int i = 0; i < loadNameCount; i++) {
+    if (loadSnapshot(myHashTable, loadNames[i]) != 0) {
+      fprintf(stderr, "Unable to load snapshot: %s\n", loadNames[i]);
       destroy(myHashTable);
-      return 1;
+      goto done;
     }
- 
-    if (feof(fp) != 0) {
-      // File exists but is empty. Close the file and then
-      // move on to the next argument.
-      fclose(fp);
-      continue;
-    }
-
-    fileCount++; // valid file read
-    
-    // get first two words in file
-    word1 = getNextWord(fp);
-    word2 = getNextWord(fp);
-
-    while (word2 != NULL) {
-      // wordpair is the temp storage for each wordpair;
-      // start copying words into worpair and insert into
-      // hash table as we go.
-      strcpy(wordpair, word1);
-      strcat(wordpair, space);
-      strcat(wordpair, word2);
-      // insert the new wordpair into the hashTable
-      insert(myHashTable, strdup(wordpair));    
-      // get ready for next word pair
-      free(word1);
-      word1 = word2;
-      word2 = getNextWord(fp);
+
+    fileCount++; // a snapshot counts as a viable input
+  }
+
+  // count the files that changed since the last run, reusing the
+  // cached counts of the others (see cache.h)
+  const char* failedName; // file or cache that could not be used
+  if (cacheName != NULL && fileNameCount > 0) {
+    if (countCached(myHashTable, cacheName, fileNames, fileNameCount, threadCount, &failedName) != 0) {
+      fprintf(stderr, "Unable to %s: %s\n", failedName == cacheName ? "update cache" : "open file", failedName);
+      destroy(myHashTable);
+      goto done;
     }
-  
-    // free up final word and close the file
-    free(word1);
-    fclose(fp);
+    fileCount += fileNameCount;
+    fileNameCount = 0; // all counted
+  }
+
+  // count each file specified, reading the files ahead of the
+  // counting (see ingest.h)
+  if (countFiles(myHashTable, fileNames, fileNameCount, threadCount, &failedName) != 0) {
+    // unable to open a file specified, print to stderr
+    // and exit...
+    fprintf(stderr, "Unable to open file: %s\n", failedName);
+    destroy(myHashTable);
+    goto done;
+  }
+  fileCount += fileNameCount; // valid files read
+
+  // write what was counted before printing it
+  if (saveName != NULL && fileCount != 0
+      && ((memoryLimited && spill.runCount != 0) || saveSnapshot(myHashTable, saveName) != 0)) {
+    fprintf(stderr, "Unable to save snapshot: %s%s\n", saveName,
+            memoryLimited && spill.runCount != 0 ? " (pairs were spilled to disk)" : "");
+    if (memoryLimited) stopSpilling(myHashTable, &spill);
+    destroy(myHashTable);
+    goto done;
   }
 
   if (fileCount != 0) {
-    // Hash table has ingested at least 1 viable file. We will now
+    // Hash table has ingested at least 1 viable file (or snapshot). We will now
     // print the entries of the hash table into an array and sort
     // them in descending order of appearance count prior to outputting to stdout.
  
-    printSortedHashTable(myHashTable, displayWordpairCount);
+    if (serveName != NULL) {
+      // answer queries until stopped instead of printing (see server.h)
+      PairIndex index;
+      buildPairIndex(&index, myHashTable, threadCount);
+      if (statsFormat >= 0) printStats(stderr, myHashTable, statsFormat);
+      fprintf(stderr, "# serving %d pairs on %s\n", index.pairCount, serveName);
+      int served = servePairs(&index, serveName);
+      if (served != 0) perror(serveName);
+      freePairIndex(&index);
+      destroy(myHashTable);
+      status = served != 0;
+      goto done;
+    } else if (followWord != NULL) {
+      // print the most frequent pairs that start with one word from a
+      // successor index of the table (see successor.h)
+      SuccessorIndex followers;
+      char followKey[DICT_MAX_WORD_LEN]; // the word as the files were tokenized
+      int followed;
+      StatTimer timer = startTimer(PHASE_SORT);
+      buildSuccessorIndex(&followers, myHashTable, threadCount);
+      stopTimer(timer);
+      timer = startTimer(PHASE_OUTPUT);
+      normalizeWord(followWord, followKey);
+      findSuccessors(&followers, followKey, &followed);
+      printSuccessors(&followers, followKey, followCount >= 0 ? followCount : FOLLOW_DEFAULT_COUNT);
+      stopTimer(timer);
+      if (followed == 0) fprintf(stderr, "No pairs start with: %s\n", followWord);
+      freeSuccessorIndex(&followers);
+    } else if (!memoryLimited) {
+      printSortedHashTable(myHashTable, displayWordpairCount);
+    } else if (printSpilled(myHashTable, &spill, displayWordpairCount) != 0) {
+      fprintf(stderr, "Unable to write temporary files in: %s\n", tmpDir);
+      stopSpilling(myHashTable, &spill);
+      destroy(myHashTable);
+      goto done;
+    }
+    if (statsFormat >= 0) printStats(stderr, myHashTable, statsFormat);
 
   } else {
     // User didn't specify a valid filename as an argument.
@@ -118,8 +543,21 @@ int main(int argc, char** argv) {
     fprintf(stderr, "Did not receive valid filename as argument...\n");
   }
 
+  if (memoryLimited) {
+    if (spill.failed) {
+      fprintf(stderr, "Unable to write temporary files in: %s (counted in memory instead)\n", tmpDir);
+    }
+    stopSpilling(myHashTable, &spill);
+  }
+
   // free all hash nodes as well as the hash table and return!
   // (See hash.h for more info on destroy())
   destroy(myHashTable);
-  return 0;
+  status = 0;
+
+done:
+  // every exit, successful or not, ends here
+  free(loadNames);
+  freeFileList(&files);
+  return status;
 }
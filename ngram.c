@@ -0,0 +1,271 @@
+#include "ngram.h"
+#include "hash.h"
+#include "getWord.h"
+#include "output.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// ************************************************
+// ************************************************
+// ** ngram.c counts n-grams of any length in a
+// ** table laid out like the pair HashTable of
+// ** hash.c, with each row holding n word ids and
+// ** a count. The insert function is specialized
+// ** for the common sizes by instantiating one
+// ** macro with a constant n.
+// **
+// ** See ngram.h for more information on each
+// ** individual function.
+
+// mix the n ids of an n-gram into one hash value
+static inline unsigned long long hashGram(const unsigned int* ids, int n) {
+  unsigned long long hash = ids[0];
+  for (int i = 1; i < n; i++) {
+    hash = hash * 0x9E3779B97F4A7C15ULL + ids[i];
+  }
+  return hashKey(hash);
+}
+
+// double the rows of a GramTable (used when the load factor is exceeded)
+static void expandGrams(GramTable* grams) {
+  if (grams->rowCount >= HASH_MAX_ROWS) {
+    if (grams->uniqueCount >= HASH_MAX_UNIQUE) tableFull(); // cannot double again
+    return;
+  }
+  int newRowCount = grams->rowCount * 2;
+  unsigned long long mask = newRowCount - 1;
+  unsigned int* newRows = calloc((size_t) newRowCount * grams->stride, sizeof(unsigned int));
+
+  for (int r = 0; r < grams->rowCount; r++) {
+    unsigned int* row = &grams->rows[(size_t) r * grams->stride];
+    if (row[grams->n] == 0) continue;
+    unsigned long long index = hashGram(row, grams->n) & mask;
+    while (newRows[index * grams->stride + grams->n] != 0) {
+      index = (index + 1) & mask;
+    }
+    memcpy(&newRows[index * grams->stride], row, sizeof(unsigned int) * grams->stride);
+  }
+  free(grams->rows);
+  grams->rows = newRows;
+  grams->rowCount = newRowCount;
+}
+
+// GRAM_INSERT(NAME, N) defines an insert function for n-grams of N words,
+// or of the table's n words when N is 0. With a constant N the compiler
+// unrolls the hashing, comparing and copying of the ids.
+#define GRAM_INSERT(NAME, N)                                                  \
+  static int NAME(GramTable* grams, const unsigned int* ids) {                \
+    const int n = (N) ? (N) : grams->n;                                       \
+    unsigned long long mask = grams->rowCount - 1;                            \
+    unsigned long long index = hashGram(ids, n) & mask;                       \
+    unsigned int* row;                                                        \
+                                                                              \
+    grams->entryCount++;                                                      \
+    for (;; index = (index + 1) & mask) {                                     \
+      row = &grams->rows[index * (n + 1)];                                    \
+      if (row[n] == 0) break; /* empty row: the n-gram is new */              \
+      if (memcmp(row, ids, sizeof(unsigned int) * n) == 0) return ++row[n];   \
+    }                                                                         \
+    memcpy(row, ids, sizeof(unsigned int) * n);                               \
+    row[n] = 1;                                                               \
+    grams->uniqueCount++;                                                     \
+    if ((double) grams->uniqueCount / grams->rowCount > LOAD_FACTOR) {        \
+      expandGrams(grams);                                                     \
+    }                                                                         \
+    return 1;                                                                 \
+  }
+
+GRAM_INSERT(insertGram3, 3)
+GRAM_INSERT(insertGram4, 4)
+GRAM_INSERT(insertGramAny, 0)
+
+// create a new n-gram table:
+GramTable* createGramTable(int n) {
+  GramTable* grams = malloc(sizeof(GramTable));
+  grams->n = n;
+  grams->stride = n + 1;
+  grams->rowCount = INITIAL_HASH_SIZE;
+  grams->rows = calloc((size_t) grams->rowCount * grams->stride, sizeof(unsigned int));
+  grams->entryCount = 0;
+  grams->uniqueCount = 0;
+  grams->insert = n == 3 ? insertGram3 : n == 4 ? insertGram4 : insertGramAny;
+  grams->dict = createDictionary(INITIAL_DICT_SIZE);
+  return grams;
+}
+
+// count one n-gram:
+int insertGram(GramTable* grams, const unsigned int* ids) {
+  return grams->insert(grams, ids);
+}
+
+// count the n-grams of a file:
+int countGramFile(GramTable* grams, const char* path) {
+  WordReader reader;
+  const char* word;
+  int wordLength, n = grams->n;
+  unsigned int window[NGRAM_MAX]; // ids of the last n words
+  int filled = 0; // # of ids in window
+
+  if (openWordReader(&reader, path) != 0) return -1;
+  while ((wordLength = getNextWordSlice(&reader, &word)) != 0) {
+    unsigned int id = internWord(grams->dict, word, wordLength);
+    if (filled == n) {
+      memmove(window, window + 1, sizeof(unsigned int) * (n - 1)); // slide by one word
+      filled--;
+    }
+    window[filled++] = id;
+    if (filled == n) grams->insert(grams, window);
+  }
+  closeWordReader(&reader);
+  return 0;
+}
+
+// what compareGrams() orders rows by: the rows and their n, and the
+// alphabetical rank of each word id (NULL if the rows hold ranks already)
+typedef struct _gramOrder {
+  const unsigned int* rows;
+  int n;
+  const unsigned int* rank;
+} GramOrder;
+
+// compare two rows (by number) in output order: descending by count,
+// then ascending by the word ranks in order; < 0 if row1 comes first
+static int compareGrams(const GramOrder* order, int row1, int row2) {
+  const unsigned int* ids1 = &order->rows[(size_t) row1 * (order->n + 1)];
+  const unsigned int* ids2 = &order->rows[(size_t) row2 * (order->n + 1)];
+  int n = order->n;
+
+  if (ids1[n] != ids2[n]) return ids1[n] < ids2[n] ? 1 : -1;
+  for (int i = 0; i < n; i++) {
+    unsigned int rank1 = order->rank ? order->rank[ids1[i]] : ids1[i];
+    unsigned int rank2 = order->rank ? order->rank[ids2[i]] : ids2[i];
+    if (rank1 != rank2) return rank1 < rank2 ? -1 : 1;
+  }
+  return 0;
+}
+
+// sort row numbers into output order by merging runs of doubling length
+// (qsort() has no argument to hand the GramOrder to compareGrams())
+static void sortGrams(const GramOrder* order, int* rows, int count) {
+  int* buffer = malloc(sizeof(int) * (count ? count : 1));
+  int* from = rows;
+  int* to = buffer;
+
+  for (long long width = 1; width < count; width *= 2) {
+    for (long long start = 0; start < count; start += 2 * width) {
+      int middle = start + width < count ? start + width : count;
+      int end = start + 2 * width < count ? start + 2 * width : count;
+      int i = start, j = middle, k = start;
+      while (i < middle && j < end) {
+        to[k++] = compareGrams(order, from[j], from[i]) < 0 ? from[j++] : from[i++];
+      }
+      while (i < middle) to[k++] = from[i++];
+      while (j < end) to[k++] = from[j++];
+    }
+    int* swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from != rows) memcpy(rows, from, sizeof(int) * count);
+  free(buffer);
+}
+
+// move heap[i] down until neither child sorts after it (the root of
+// the heap is the row that sorts last)
+static void siftDownGrams(const GramOrder* order, int* heap, int size, int i) {
+  int row = heap[i];
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= size) break;
+    if (child + 1 < size && compareGrams(order, heap[child + 1], heap[child]) > 0) {
+      child++; // pick the child that sorts last
+    }
+    if (compareGrams(order, heap[child], row) <= 0) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = row;
+}
+
+// print a number of n-grams sorted in descending order of occurances:
+void printSortedGramTable(GramTable* grams, int displayCount) {
+  Dictionary* dict = grams->dict;
+  int n = grams->n, used = 0;
+  unsigned int* ranked = NULL;
+  int* order;
+
+  if (displayCount > grams->uniqueCount || displayCount == -1) displayCount = grams->uniqueCount;
+  if (displayCount <= 0) return;
+  sortDictionary(dict);
+
+  if (displayCount == grams->uniqueCount) {
+    // every n-gram is printed: copy the used rows, re-keyed by
+    // alphabetical word rank, and sort them all
+    ranked = malloc(sizeof(unsigned int) * (size_t) grams->uniqueCount * (n + 1));
+    order = malloc(sizeof(int) * grams->uniqueCount);
+    for (int r = 0; r < grams->rowCount; r++) {
+      unsigned int* row = &grams->rows[(size_t) r * (n + 1)];
+      if (row[n] == 0) continue;
+      for (int i = 0; i < n; i++) ranked[(size_t) used * (n + 1) + i] = dict->rank[row[i]];
+      ranked[(size_t) used * (n + 1) + n] = row[n];
+      order[used] = used;
+      used++;
+    }
+    GramOrder byRank = { ranked, n, NULL };
+    sortGrams(&byRank, order, used);
+  } else {
+    // keep the rows that sort first in a bounded heap, as topDump() does
+    // for pairs, then heap sort them: the root is the row printed last,
+    // so each one taken off goes at the end
+    GramOrder byId = { grams->rows, n, dict->rank };
+    order = malloc(sizeof(int) * displayCount);
+    for (int r = 0; r < grams->rowCount; r++) {
+      if (grams->rows[(size_t) r * (n + 1) + n] == 0) continue;
+      if (used < displayCount) {
+        order[used++] = r;
+        if (used == displayCount) {
+          for (int i = displayCount / 2 - 1; i >= 0; i--) siftDownGrams(&byId, order, used, i);
+        }
+      } else if (compareGrams(&byId, r, order[0]) < 0) {
+        order[0] = r; // sorts before the last of the current top rows
+        siftDownGrams(&byId, order, used, 0);
+      }
+    }
+    for (int last = used - 1; last > 0; last--) {
+      int row = order[0];
+      order[0] = order[last];
+      order[last] = row;
+      siftDownGrams(&byId, order, last, 0);
+    }
+  }
+
+  Output output;
+  openOutput(&output, 1);
+  for (int g = 0; g < displayCount; g++) {
+    if (ranked != NULL) {
+      const unsigned int* row = &ranked[(size_t) order[g] * (n + 1)];
+      writeCount(&output, row[n]);
+      for (int i = 0; i < n; i++) {
+        unsigned int id = dict->order[row[i]];
+        writeWord(&output, dict->words[id], dict->lengths[id]);
+      }
+    } else {
+      const unsigned int* row = &grams->rows[(size_t) order[g] * (n + 1)];
+      writeCount(&output, row[n]);
+      for (int i = 0; i < n; i++) writeWord(&output, dict->words[row[i]], dict->lengths[row[i]]);
+    }
+    endRecord(&output);
+  }
+  closeOutput(&output);
+
+  free(order);
+  free(ranked);
+}
+
+// free an n-gram table:
+void destroyGramTable(GramTable* grams) {
+  free(grams->rows);
+  destroyDictionary(grams->dict);
+  free(grams);
+}
@@ -0,0 +1,66 @@
+#ifndef NGRAM_H
+#define NGRAM_H
+
+#include "dict.h"
+
+#define NGRAM_MAX 16 // longest n-gram that can be counted
+
+typedef struct _gramTable {
+  int n; // # of words in each n-gram
+  int stride; // n + 1: unsigned ints per row (n word ids, then the count)
+  unsigned int* rows; // open addressing array of rows, stored inline
+  int rowCount; // # of rows, always a power of two
+  long long entryCount; // total # of n-grams counted
+  int uniqueCount; // # of used rows (a count of 0 marks an empty row)
+  int (*insert)(struct _gramTable*, const unsigned int*); // insertGram() for this n
+  Dictionary* dict; // words the ids refer to
+} GramTable;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  create GramTable: createGramTable(int)
+// **  count one n-gram: insertGram(GramTable*, const unsigned int*)
+// **  count the n-grams of a file: countGramFile(GramTable*, const char*)
+// **  print in descending order of occurances: printSortedGramTable(GramTable*, int)
+// **  free memory: destroyGramTable(GramTable*)
+// **
+// ** A GramTable counts n-grams (runs of n consecutive words) for an n
+// ** other than 2; pairs keep using the HashTable of hash.h. Like the
+// ** HashTable, it interns words into a Dictionary and stores each
+// ** n-gram as its word ids, inline: a row is n ids followed by the
+// ** count, so a trigram row is 16 bytes. The rows use open addressing
+// ** with linear probing and double at LOAD_FACTOR.
+// **
+// ** The probing code is generated once per n-gram size from a macro:
+// ** n = 3 and n = 4 get copies in which n is a compile-time constant
+// ** (so hashing and comparing keys is unrolled), and every other n
+// ** uses a copy that reads n from the table.
+
+// createGramTable() creates an empty GramTable for n-grams of the given
+// number of words (1 to NGRAM_MAX) and picks the insert function for it.
+GramTable* createGramTable(int);
+
+// insertGram() counts one occurance of the n-gram made of the n word ids
+// (from internWord() on the table's Dictionary) the pointer points at,
+// and returns its new count.
+int insertGram(GramTable*, const unsigned int*);
+
+// countGramFile() counts every n-gram of the named file, sliding a
+// window of n words over it (n-grams never span two files). The function
+// returns 0 on success and -1 (with errno set) if the file cannot be
+// opened.
+int countGramFile(GramTable*, const char*);
+
+// printSortedGramTable() prints the given number of n-grams (-1 prints all
+// of them) as "count word1 word2 ... wordN", most frequent first and
+// n-grams with equal counts in alphabetical order, as
+// printSortedHashTable() does for pairs. When fewer than all of them are
+// printed, they are picked with a bounded heap (see topDump() in hash.h)
+// rather than by sorting every n-gram.
+void printSortedGramTable(GramTable*, int);
+
+// destroyGramTable() frees the GramTable, its rows and its Dictionary.
+void destroyGramTable(GramTable*);
+
+#endif
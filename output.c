@@ -0,0 +1,140 @@
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// ************************************************
+// ************************************************
+// ** output.c is the output stage of wordpairs:
+// ** records are formatted straight into a
+// ** buffer (counts by a hand-rolled integer
+// ** formatter) and the buffer is written out
+// ** with one write() per OUTPUT_BUFFER_SIZE
+// ** bytes.
+// **
+// ** See output.h for more information on each
+// ** individual function and the formats.
+
+#define OUTPUT_COUNT_WIDTH 10 // text counts are right-aligned in this many columns
+
+static OutputFormat currentFormat = FORMAT_TEXT; // format of new Outputs
+static const char* const formatNames[] = { "text", "tsv", "binary", NULL };
+
+// set the format of every Output opened from now on:
+void setOutputFormat(OutputFormat format) {
+  currentFormat = format;
+}
+
+// look up a format by name:
+int findOutputFormat(const char* name) {
+  for (int i = 0; formatNames[i] != NULL; i++) {
+    if (strcmp(formatNames[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+// start writing records to a descriptor:
+void openOutput(Output* output, int fd) {
+  fflush(stdout); // earlier printf() output goes first
+  output->fd = fd;
+  output->format = currentFormat;
+  output->buffer = malloc(OUTPUT_BUFFER_SIZE);
+  output->used = 0;
+  output->failed = 0;
+}
+
+// write out everything buffered so far:
+void flushOutput(Output* output) {
+  size_t written = 0;
+
+  while (written < output->used && !output->failed) {
+    ssize_t bytes = write(output->fd, output->buffer + written, output->used - written);
+    if (bytes < 0 && errno != EINTR) output->failed = 1;
+    if (bytes > 0) written += bytes;
+  }
+  output->used = 0;
+}
+
+// make room for length more bytes in the buffer
+static inline char* reserve(Output* output, size_t length) {
+  if (output->used + length > OUTPUT_BUFFER_SIZE) flushOutput(output);
+  return output->buffer + output->used;
+}
+
+// start a record with its count:
+void writeCount(Output* output, int count) {
+  char* out = reserve(output, 16);
+  unsigned int value = count;
+
+  if (output->format == FORMAT_BINARY) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+    output->used += 4;
+    return;
+  }
+
+  // digits from the last one back, into the end of a scratch field
+  char digits[16];
+  int length = 0;
+  do {
+    digits[sizeof(digits) - ++length] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+
+  if (output->format == FORMAT_TEXT) {
+    while (length < OUTPUT_COUNT_WIDTH) digits[sizeof(digits) - ++length] = ' ';
+  }
+  memcpy(out, digits + sizeof(digits) - length, length);
+  output->used += length;
+}
+
+// add the next word of a record:
+void writeWord(Output* output, const char* word, int length) {
+  char* out = reserve(output, length + 1);
+
+  switch (output->format) {
+    case FORMAT_TEXT: *out = ' '; break;
+    case FORMAT_TSV: *out = '\t'; break;
+    case FORMAT_BINARY: *out = length; break;
+  }
+  memcpy(out + 1, word, length);
+  output->used += length + 1;
+}
+
+// finish a record:
+void endRecord(Output* output) {
+  if (output->format == FORMAT_BINARY) return;
+  *reserve(output, 1) = '\n';
+  output->used++;
+}
+
+// write one pair record:
+void writePair(Output* output, Dictionary* dict, int count, unsigned int first, unsigned int second) {
+  writeCount(output, count);
+  writeWord(output, dict->words[first], dict->lengths[first]);
+  writeWord(output, dict->words[second], dict->lengths[second]);
+  endRecord(output);
+}
+
+// add text as it is:
+void writeText(Output* output, const char* text, int length) {
+  while (length > 0) {
+    int part = length < OUTPUT_BUFFER_SIZE ? length : OUTPUT_BUFFER_SIZE;
+    memcpy(reserve(output, part), text, part);
+    output->used += part;
+    text += part;
+    length -= part;
+  }
+}
+
+// write out the rest and free the buffer:
+int closeOutput(Output* output) {
+  flushOutput(output);
+  free(output->buffer);
+  output->buffer = NULL;
+  return output->failed ? -1 : 0;
+}
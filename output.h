@@ -0,0 +1,87 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include "dict.h"
+
+#ifndef OUTPUT_BUFFER_SIZE
+#define OUTPUT_BUFFER_SIZE (1 << 20) // bytes formatted before each write()
+#endif
+
+typedef enum _outputFormat {
+  FORMAT_TEXT, // "%10d word1 word2\n", as printf() printed it
+  FORMAT_TSV, // "count\tword1\tword2\n"
+  FORMAT_BINARY // length-prefixed records (see below)
+} OutputFormat;
+
+typedef struct _output {
+  int fd; // where the records are written
+  OutputFormat format; // how they are written
+  char* buffer; // OUTPUT_BUFFER_SIZE bytes of formatted records
+  size_t used; // # of bytes in buffer
+  int failed; // a write() failed; the rest of the output is dropped
+} Output;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  pick the format: setOutputFormat(OutputFormat)
+// **  look a format up by name: findOutputFormat(const char*)
+// **  start writing: openOutput(Output*, int)
+// **  write a pair: writePair(Output*, Dictionary*, int, unsigned, unsigned)
+// **  write any record: writeCount(Output*, int), then
+// **    writeWord(Output*, const char*, int) per word, then endRecord(Output*)
+// **  write plain text: writeText(Output*, const char*, int)
+// **  write out what is buffered: flushOutput(Output*)
+// **  finish: closeOutput(Output*)
+// **
+// ** An Output formats counted pairs (or n-grams) into a large buffer
+// ** by hand, without printf()'s format parsing or stdio's locking, and
+// ** hands the buffer to write() whenever it is full. Text output is
+// ** byte for byte what printf("%10d %s %s\n") printed.
+// **
+// ** FORMAT_BINARY writes each record as the count (4 bytes, little
+// ** endian) followed by each word as 1 byte of length and the word's
+// ** bytes (no NUL). There is no header and nothing between records;
+// ** a pair record has 2 words, an n-gram record n (see -n).
+
+// setOutputFormat() sets the format every Output opened after it uses
+// (FORMAT_TEXT by default).
+void setOutputFormat(OutputFormat);
+
+// findOutputFormat() returns the format named "text", "tsv" or
+// "binary", or -1 if the name is unknown.
+int findOutputFormat(const char*);
+
+// openOutput() starts writing records to a file descriptor in the
+// current format. Anything stdout has buffered is flushed first, so that
+// lines printed with printf() before it keep their place.
+void openOutput(Output*, int);
+
+// writePair() writes one "count word1 word2" record; the words are
+// given as ids of the Dictionary.
+void writePair(Output*, Dictionary*, int, unsigned int, unsigned int);
+
+// writeCount() starts a record with its count.
+void writeCount(Output*, int);
+
+// writeWord() adds the next word of a record, of the given length (it
+// need not be NUL-terminated).
+void writeWord(Output*, const char*, int);
+
+// endRecord() finishes a record.
+void endRecord(Output*);
+
+// writeText() adds the given number of bytes of text to the output as
+// they are, whatever the format (e.g. the header lines of server.h).
+void writeText(Output*, const char*, int);
+
+// flushOutput() writes everything buffered so far, e.g. at the end of
+// a response that a client is waiting for.
+void flushOutput(Output*);
+
+// closeOutput() writes whatever is still buffered and frees the buffer.
+// It returns 0, or -1 if any write() failed.
+int closeOutput(Output*);
+
+#endif
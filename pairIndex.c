@@ -0,0 +1,43 @@
+#include "pairIndex.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ************************************************
+// ************************************************
+// ** pairIndex.c builds the read-only view of a
+// ** counted HashTable that the query server
+// ** answers from: the arrayDump() of the table
+// ** for the top pairs, and a SuccessorIndex for
+// ** the pairs that follow a word.
+// **
+// ** See pairIndex.h for more information on each
+// ** individual function.
+
+// build the index of a counted HashTable:
+void buildPairIndex(PairIndex* index, HashTable* hashTable, int threads) {
+  index->hashTable = hashTable;
+  index->dict = hashTable->dict;
+  index->pairs = arrayDump(hashTable); // also ranks the dictionary
+  index->pairCount = hashTable->uniqueCount;
+  buildSuccessorIndex(&index->followers, hashTable, threads);
+}
+
+// look up the count of a pair of words:
+int indexCount(PairIndex* index, const char* first, const char* second) {
+  unsigned int firstId = findWord(index->dict, first, strlen(first));
+  unsigned int secondId = findWord(index->dict, second, strlen(second));
+
+  if (firstId == DICT_EMPTY || secondId == DICT_EMPTY) return 0;
+  return findCount(index->hashTable, PAIR_KEY(firstId, secondId));
+}
+
+// find the pairs that start with a word:
+const Successor* indexFollowers(PairIndex* index, const char* word, int* count) {
+  return findSuccessors(&index->followers, word, count);
+}
+
+// free the index (but not its HashTable):
+void freePairIndex(PairIndex* index) {
+  free(index->pairs);
+  freeSuccessorIndex(&index->followers);
+}
@@ -0,0 +1,50 @@
+#ifndef PAIRINDEX_H
+#define PAIRINDEX_H
+
+#include "hash.h"
+#include "successor.h"
+
+typedef struct _pairIndex {
+  HashTable* hashTable; // the counted pairs (looked up, never changed again)
+  Dictionary* dict; // hashTable->dict, ranked alphabetically
+  HashNode* pairs; // every pair in output order, keyed by word ranks (see arrayDump())
+  int pairCount; // # of pairs
+  SuccessorIndex followers; // the pairs grouped by first word (see successor.h)
+} PairIndex;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  build from a counted HashTable: buildPairIndex(PairIndex*, HashTable*, int)
+// **  count of one pair: indexCount(PairIndex*, const char*, const char*)
+// **  pairs starting with a word: indexFollowers(PairIndex*, const char*, int*)
+// **  free memory: freePairIndex(PairIndex*)
+// **
+// ** A PairIndex is a read-only view of a HashTable that is done
+// ** counting, for answering many queries (see server.h). The pairs
+// ** are kept in output order, so the top K are simply the first K,
+// ** and in a SuccessorIndex, so the pairs that start with a word are
+// ** one contiguous run. Nothing in it changes once it is
+// ** built, so any number of threads may query it at once without
+// ** locking.
+
+// buildPairIndex() builds the index of a HashTable, on at most the given
+// number of threads. The HashTable (and its Dictionary) must not be
+// changed or destroyed while the index is in use; freePairIndex() does
+// not destroy it.
+void buildPairIndex(PairIndex*, HashTable*, int);
+
+// indexCount() returns the count of the pair of the two given
+// NUL-terminated words (0 if either word or the pair was never seen).
+int indexCount(PairIndex*, const char*, const char*);
+
+// indexFollowers() returns the words that follow the given
+// NUL-terminated word, most frequent first (see findSuccessors()), and
+// stores how many there are through the int pointer (0 if the word was
+// never seen first in a pair).
+const Successor* indexFollowers(PairIndex*, const char*, int*);
+
+// freePairIndex() frees the arrays of the index.
+void freePairIndex(PairIndex*);
+
+#endif
@@ -0,0 +1,133 @@
+#include "radixSort.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// ************************************************
+// ************************************************
+// ** radixSort.c sorts 64-bit values by counting:
+// ** every pass histograms one RADIX_BITS digit,
+// ** turns the histogram into the first output
+// ** position of each digit and moves each value
+// ** to its digit's next position. The values
+// ** are split into one slice per thread; a
+// ** thread keeps its own histogram, and the
+// ** histograms are laid end to end (digit by
+// ** digit, thread by thread) so that the slices
+// ** are moved in order.
+// **
+// ** See radixSort.h for more information.
+
+#define RADIX_DIGITS (1 << RADIX_BITS)
+
+// what the threads of one radixSort() share
+typedef struct _radixShared {
+  unsigned long long* values; // the array to sort
+  unsigned long long* scratch; // as long as values
+  size_t count; // # of values
+  int bits; // # of low bits that may be set
+  int threadCount; // # of slices (and threads)
+  size_t (*positions)[RADIX_DIGITS]; // histogram, then next position, of each slice
+  int skip; // the current pass moves nothing (every digit is the same)
+  pthread_barrier_t barrier; // between the steps of each pass
+} RadixShared;
+
+// one thread's part of a radixSort()
+typedef struct _radixSlice {
+  RadixShared* shared;
+  int index; // which slice of the values is this thread's
+  unsigned long long* result; // where the sorted values ended up
+} RadixSlice;
+
+// wait for every thread of the sort (if there are others)
+static void radixWait(RadixShared* shared) {
+  if (shared->threadCount > 1) pthread_barrier_wait(&shared->barrier);
+}
+
+// turn the histograms of every slice into the position of the first
+// value of each digit of each slice, and note whether the pass can be
+// skipped
+static void radixPositions(RadixShared* shared) {
+  size_t next = 0;
+
+  shared->skip = 0;
+  for (int digit = 0; digit < RADIX_DIGITS; digit++) {
+    size_t digitCount = 0;
+    for (int t = 0; t < shared->threadCount; t++) {
+      size_t slots = shared->positions[t][digit];
+      shared->positions[t][digit] = next;
+      next += slots;
+      digitCount += slots;
+    }
+    if (digitCount == shared->count) shared->skip = 1; // the only digit used
+  }
+}
+
+// sort one slice: histogram it, then move it, in every pass
+static void* radixSortSlice(void* argument) {
+  RadixSlice* slice = argument;
+  RadixShared* shared = slice->shared;
+  size_t first = shared->count / shared->threadCount * slice->index;
+  size_t last = slice->index == shared->threadCount - 1
+                ? shared->count : first + shared->count / shared->threadCount;
+  unsigned long long* from = shared->values;
+  unsigned long long* to = shared->scratch;
+  size_t* positions = shared->positions[slice->index];
+
+  for (int shift = 0; shift < shared->bits; shift += RADIX_BITS) {
+    memset(positions, 0, sizeof(size_t) * RADIX_DIGITS);
+    for (size_t i = first; i < last; i++) {
+      positions[(from[i] >> shift) & (RADIX_DIGITS - 1)]++;
+    }
+    radixWait(shared);
+    if (slice->index == 0) radixPositions(shared);
+    radixWait(shared);
+    if (shared->skip) continue; // from is already in order of this digit
+
+    for (size_t i = first; i < last; i++) {
+      to[positions[(from[i] >> shift) & (RADIX_DIGITS - 1)]++] = from[i];
+    }
+    unsigned long long* swap = from;
+    from = to;
+    to = swap;
+    radixWait(shared); // every value moved before the next histogram
+  }
+  slice->result = from;
+  return NULL;
+}
+
+// sort 64-bit values in ascending order:
+unsigned long long* radixSort(unsigned long long* values, unsigned long long* scratch,
+                              size_t count, int bits, int threads) {
+  RadixShared shared;
+
+  // each thread gets at least RADIX_THREAD_MIN values
+  if ((size_t) threads > count / RADIX_THREAD_MIN) threads = count / RADIX_THREAD_MIN;
+  if (threads < 1) threads = 1;
+
+  shared.values = values;
+  shared.scratch = scratch;
+  shared.count = count;
+  shared.bits = bits;
+  shared.threadCount = threads;
+  shared.positions = malloc(sizeof(*shared.positions) * threads);
+  RadixSlice* slices = malloc(sizeof(RadixSlice) * threads);
+  pthread_t* workers = malloc(sizeof(pthread_t) * threads);
+  if (threads > 1) pthread_barrier_init(&shared.barrier, NULL, threads);
+
+  // slice 0 is sorted on the calling thread
+  for (int t = 0; t < threads; t++) {
+    slices[t].shared = &shared;
+    slices[t].index = t;
+    if (t > 0) pthread_create(&workers[t], NULL, radixSortSlice, &slices[t]);
+  }
+  radixSortSlice(&slices[0]);
+  for (int t = 1; t < threads; t++) pthread_join(workers[t], NULL);
+
+  unsigned long long* result = slices[0].result;
+  if (threads > 1) pthread_barrier_destroy(&shared.barrier);
+  free(workers);
+  free(slices);
+  free(shared.positions);
+  return result;
+}
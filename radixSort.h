@@ -0,0 +1,39 @@
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <stddef.h>
+
+#ifndef RADIX_BITS
+#define RADIX_BITS 11 // bits sorted per pass (2048 buckets, 16KB of counters)
+#endif
+
+#ifndef RADIX_THREAD_MIN
+#define RADIX_THREAD_MIN 65536 // fewest values worth handing to another thread
+#endif
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  sort 64-bit values: radixSort(unsigned long long*, unsigned long long*,
+// **                                size_t, int, int)
+// **
+// ** A least significant digit first radix sort of unsigned 64-bit
+// ** values. It makes one counting pass per RADIX_BITS of the values
+// ** that can differ, moving the values between the array and a scratch
+// ** array of the same length, so sorting n values costs O(n) per pass
+// ** instead of the O(n log n) comparisons of qsort(). A pass in which
+// ** every value has the same digit is skipped. With several threads,
+// ** each thread counts and moves its own slice of the values in every
+// ** pass (the slices' counts are combined in between), so the result
+// ** is the same stable order as with one thread.
+
+// radixSort() sorts count values into ascending order. The second
+// argument is scratch space for count values, and the fourth is the number
+// of low bits that may be set in any value (64 if unknown); the fewer
+// there are, the fewer passes are made. The last argument is the most
+// threads to sort on (fewer are used for small arrays). The function
+// returns the array that holds the sorted values, which is either the first
+// argument or the scratch space.
+unsigned long long* radixSort(unsigned long long*, unsigned long long*, size_t, int, int);
+
+#endif
@@ -0,0 +1,477 @@
+#include "readAhead.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if READ_AHEAD_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+// ************************************************
+// ************************************************
+// ** readAhead.c keeps a ring of block buffers
+// ** filled ahead of the caller. Planning a block
+// ** (deciding which file and which bytes it
+// ** holds, opening files as they come up) is the
+// ** same for both methods; the io_uring method
+// ** then submits the block's read and reaps the
+// ** completions while the caller waits, and the
+// ** thread method has each thread plan a block
+// ** and pread() it, taking turns on the lock.
+// **
+// ** See readAhead.h for more information on each
+// ** individual function.
+
+static ReadMethod method = READ_URING; // see setReadMethod()
+
+// set the method files are read with:
+void setReadMethod(ReadMethod readMethod) {
+  method = readMethod;
+}
+
+// look a read method up by name:
+int findReadMethod(const char* name) {
+  if (strcmp(name, "uring") == 0) return READ_URING;
+  if (strcmp(name, "threads") == 0) return READ_THREADS;
+  if (strcmp(name, "mmap") == 0) return READ_MAPPED;
+  return -1;
+}
+
+// the method files are read with:
+ReadMethod readMethod(void) {
+  return method;
+}
+
+// plan the next block into a free buffer: which file, and which bytes of
+// it, the block holds (opening the next file once the last one is fully
+// planned). Returns 0 once every file has been planned.
+static int planBlock(ReadAhead* ahead, ReadBlock* block) {
+  char* data = block->data;
+  struct stat st;
+
+  memset(block, 0, sizeof(ReadBlock));
+  block->data = data;
+  block->fd = -1;
+  while (ahead->planFile < 0) {
+    if (ahead->nextFile == ahead->pathCount) return 0;
+
+    // files that are not read ahead get a single block that is ready
+    // at once: one that could not be opened, one that is not a regular
+    // file (stat() first, as opening a FIFO would wait for a writer)
+    // and one that is empty
+    block->file = ahead->nextFile++;
+    block->last = 1;
+    block->ready = 1;
+    if (stat(ahead->paths[block->file], &st) != 0) {
+      block->error = errno;
+      return 1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+      block->direct = 1;
+      return 1;
+    }
+    int fd = open(ahead->paths[block->file], O_RDONLY);
+    if (fd < 0) {
+      block->error = errno;
+      return 1;
+    }
+    if (st.st_size == 0) {
+      close(fd);
+      return 1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    ahead->planFile = block->file;
+    ahead->planFd = fd;
+    ahead->planSize = st.st_size;
+    ahead->planOffset = 0;
+    block->ready = 0;
+  }
+
+  block->file = ahead->planFile;
+  block->fd = ahead->planFd;
+  block->offset = ahead->planOffset;
+  block->length = ahead->planSize - ahead->planOffset < READ_AHEAD_BLOCK
+                  ? ahead->planSize - ahead->planOffset : READ_AHEAD_BLOCK;
+  ahead->planOffset += block->length;
+  block->last = ahead->planOffset == ahead->planSize;
+  if (block->last) ahead->planFile = -1;
+  return 1;
+}
+
+// close every file that blocks not yet handed back still refer to
+static void closePlannedFiles(ReadAhead* ahead) {
+  for (long long n = ahead->consumed; n < ahead->planned; n++) {
+    ReadBlock* block = &ahead->blocks[n % READ_AHEAD_BLOCKS];
+    if (block->last && block->fd >= 0) close(block->fd);
+  }
+  if (ahead->planFile >= 0) close(ahead->planFd);
+}
+
+// ---------------------------------------------------------------
+// READ_THREADS: each thread plans the next block and reads it with
+// pread(), as long as the ring has a free buffer
+
+// read a planned block (a short read is retried, and read errors are
+// treated like the end of the file, as getWord.c treats them)
+static void readBlock(ReadBlock* block) {
+  while (block->size < block->length) {
+    ssize_t got = pread(block->fd, block->data + block->size, block->length - block->size,
+                        block->offset + block->size);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) break;
+    block->size += got;
+  }
+}
+
+// thread body: plan and read blocks until every file is planned
+static void* readBlocks(void* argument) {
+  ReadAhead* ahead = argument;
+
+  pthread_mutex_lock(&ahead->lock);
+  for (;;) {
+    while (!ahead->stopping && !ahead->planDone
+           && ahead->planned - ahead->consumed == READ_AHEAD_BLOCKS) {
+      pthread_cond_wait(&ahead->freeCond, &ahead->lock);
+    }
+    if (ahead->stopping || ahead->planDone) break;
+
+    ReadBlock* block = &ahead->blocks[ahead->planned % READ_AHEAD_BLOCKS];
+    if (!planBlock(ahead, block)) {
+      ahead->planDone = 1;
+      pthread_cond_broadcast(&ahead->freeCond); // the other threads are done too
+      pthread_cond_broadcast(&ahead->readyCond);
+      break;
+    }
+    ahead->planned++;
+    if (!block->ready) {
+      pthread_mutex_unlock(&ahead->lock);
+      readBlock(block);
+      pthread_mutex_lock(&ahead->lock);
+      block->ready = 1;
+    }
+    pthread_cond_broadcast(&ahead->readyCond);
+  }
+  pthread_mutex_unlock(&ahead->lock);
+  return NULL;
+}
+
+// ---------------------------------------------------------------
+// READ_URING: the calling thread plans blocks into every free buffer and
+// submits their reads, and reaps completions whenever it has to wait
+
+#if READ_AHEAD_URING
+// an io_uring and the parts of its mapped rings that are used
+typedef struct _uring {
+  int fd;
+  void* rings; // submission ring (and completion ring, if mapped together)
+  size_t ringBytes;
+  void* completionRing; // completion ring, if mapped separately
+  size_t completionBytes;
+  struct io_uring_sqe* entries; // submission queue entries
+  size_t entryBytes;
+  unsigned* submitTail;
+  unsigned* submitMask;
+  unsigned* submitArray;
+  unsigned* completeHead;
+  unsigned* completeTail;
+  unsigned* completeMask;
+  struct io_uring_cqe* completions;
+  int toSubmit; // entries queued since the last io_uring_enter()
+  int inFlight; // reads submitted and not completed
+  char* staleBuffers; // buffers abandonUring() left to the kernel, or NULL
+} Uring;
+
+// release the io_uring
+static void closeUring(Uring* uring) {
+  if (uring->rings != NULL) munmap(uring->rings, uring->ringBytes);
+  if (uring->completionRing != NULL) munmap(uring->completionRing, uring->completionBytes);
+  if (uring->entries != NULL) munmap(uring->entries, uring->entryBytes);
+  close(uring->fd);
+  free(uring);
+}
+
+// set up an io_uring with one entry per buffer, or return NULL if the
+// kernel cannot give us one that reads at an offset (IORING_OP_READ came
+// with the same release as IORING_FEAT_RW_CUR_POS)
+static Uring* openUring(void) {
+  struct io_uring_params params;
+  Uring* uring = calloc(1, sizeof(Uring));
+
+  memset(&params, 0, sizeof(params));
+  uring->fd = syscall(__NR_io_uring_setup, READ_AHEAD_BLOCKS, &params);
+  if (uring->fd < 0) {
+    free(uring);
+    return NULL;
+  }
+  if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+    closeUring(uring);
+    return NULL;
+  }
+
+  uring->ringBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t completionBytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) && completionBytes > uring->ringBytes) {
+    uring->ringBytes = completionBytes;
+  }
+  uring->rings = mmap(NULL, uring->ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      uring->fd, IORING_OFF_SQ_RING);
+  if (uring->rings == MAP_FAILED) uring->rings = NULL;
+  void* completionRing = uring->rings;
+  if (uring->rings != NULL && !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    uring->completionBytes = completionBytes;
+    uring->completionRing = mmap(NULL, completionBytes, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_CQ_RING);
+    if (uring->completionRing == MAP_FAILED) uring->completionRing = NULL;
+    completionRing = uring->completionRing;
+  }
+  uring->entryBytes = params.sq_entries * sizeof(struct io_uring_sqe);
+  uring->entries = mmap(NULL, uring->entryBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        uring->fd, IORING_OFF_SQES);
+  if (uring->entries == MAP_FAILED) uring->entries = NULL;
+  if (uring->rings == NULL || completionRing == NULL || uring->entries == NULL) {
+    closeUring(uring);
+    return NULL;
+  }
+
+  char* submit = uring->rings;
+  char* complete = completionRing;
+  uring->submitTail = (unsigned*) (submit + params.sq_off.tail);
+  uring->submitMask = (unsigned*) (submit + params.sq_off.ring_mask);
+  uring->submitArray = (unsigned*) (submit + params.sq_off.array);
+  uring->completeHead = (unsigned*) (complete + params.cq_off.head);
+  uring->completeTail = (unsigned*) (complete + params.cq_off.tail);
+  uring->completeMask = (unsigned*) (complete + params.cq_off.ring_mask);
+  uring->completions = (struct io_uring_cqe*) (complete + params.cq_off.cqes);
+  return uring;
+}
+
+// queue the read of the rest of a block (submitted by enterUring())
+static void queueRead(Uring* uring, ReadBlock* block, int slot) {
+  unsigned tail = *uring->submitTail; // only this thread moves the tail
+  unsigned index = tail & *uring->submitMask;
+  struct io_uring_sqe* entry = &uring->entries[index];
+
+  memset(entry, 0, sizeof(*entry));
+  entry->opcode = IORING_OP_READ;
+  entry->fd = block->fd;
+  entry->addr = (unsigned long) (block->data + block->size);
+  entry->len = block->length - block->size;
+  entry->off = block->offset + block->size;
+  entry->user_data = slot;
+  uring->submitArray[index] = index;
+  __atomic_store_n(uring->submitTail, tail + 1, __ATOMIC_RELEASE);
+  uring->toSubmit++;
+  uring->inFlight++;
+}
+
+// submit the queued reads and, if asked to, wait for a completion;
+// returns 0, or -1 (with errno set) if the io_uring failed
+static int enterUring(Uring* uring, int wait) {
+  while (uring->toSubmit > 0 || wait) {
+    long entered = syscall(__NR_io_uring_enter, uring->fd, uring->toSubmit, wait ? 1 : 0,
+                           wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (entered >= 0) {
+      uring->toSubmit -= entered;
+      if (uring->toSubmit == 0) return 0;
+      continue;
+    }
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return -1;
+  }
+  return 0;
+}
+
+// reap every completion: a block is ready once it is fully read, or its
+// read hit the end of the file or failed (treated like the end, as
+// readBlock() does); a short read is queued again for the rest, or once
+// the io_uring is given up (or reading stops), left for readBlock()
+static void reapUring(ReadAhead* ahead) {
+  Uring* uring = ahead->uring;
+  unsigned head = *uring->completeHead; // only this thread moves the head
+  unsigned tail = __atomic_load_n(uring->completeTail, __ATOMIC_ACQUIRE);
+
+  for (; head != tail; head++) {
+    struct io_uring_cqe* completion = &uring->completions[head & *uring->completeMask];
+    int slot = completion->user_data;
+    ReadBlock* block = &ahead->blocks[slot];
+    uring->inFlight--;
+    if (completion->res > 0) block->size += completion->res;
+    if (block->size < block->length
+        && (completion->res > 0 || completion->res == -EINTR || completion->res == -EAGAIN)) {
+      if (!ahead->stopping && ahead->method == READ_URING) queueRead(uring, block, slot);
+    } else {
+      block->ready = 1;
+    }
+  }
+  __atomic_store_n(uring->completeHead, head, __ATOMIC_RELEASE);
+}
+
+// stop using an io_uring that failed: the blocks planned so far, and
+// every later one, are read with pread() as nextBlock() asks for them
+// (as READ_THREADS does when no thread could be started). The reads in
+// flight are waited for first, so that none can land in a buffer after
+// it is planned again; one cut short is finished by readBlock(). If the
+// io_uring cannot even be waited on, its buffers are left to the kernel
+// (freed only if stopReadAhead() manages to wait for them) and the
+// blocks move to new ones with the bytes read so far.
+static void abandonUring(ReadAhead* ahead) {
+  Uring* uring = ahead->uring;
+
+  ahead->method = READ_THREADS;
+  while (uring->inFlight > 0 && enterUring(uring, 1) == 0) reapUring(ahead);
+  if (uring->inFlight > 0) {
+    uring->staleBuffers = ahead->buffers;
+    ahead->buffers = malloc((size_t) READ_AHEAD_BLOCKS * READ_AHEAD_BLOCK);
+    for (int i = 0; i < READ_AHEAD_BLOCKS; i++) {
+      char* data = ahead->buffers + (size_t) i * READ_AHEAD_BLOCK;
+      memcpy(data, ahead->blocks[i].data, ahead->blocks[i].size);
+      ahead->blocks[i].data = data;
+    }
+  }
+  pthread_mutex_init(&ahead->lock, NULL);
+  pthread_cond_init(&ahead->readyCond, NULL);
+  pthread_cond_init(&ahead->freeCond, NULL);
+}
+
+// plan blocks into every free buffer and submit their reads
+static void submitBlocks(ReadAhead* ahead) {
+  while (!ahead->planDone && ahead->planned - ahead->consumed < READ_AHEAD_BLOCKS) {
+    int slot = ahead->planned % READ_AHEAD_BLOCKS;
+    if (!planBlock(ahead, &ahead->blocks[slot])) {
+      ahead->planDone = 1;
+      break;
+    }
+    ahead->planned++;
+    if (!ahead->blocks[slot].ready) queueRead(ahead->uring, &ahead->blocks[slot], slot);
+  }
+  if (enterUring(ahead->uring, 0) != 0) abandonUring(ahead);
+}
+#endif
+
+// ---------------------------------------------------------------
+
+// start reading files:
+void startReadAhead(ReadAhead* ahead, char** paths, int pathCount) {
+  ahead->paths = paths;
+  ahead->pathCount = pathCount;
+  ahead->nextFile = 0;
+  ahead->planFile = -1;
+  ahead->planned = ahead->consumed = 0;
+  ahead->planDone = 0;
+  ahead->stopping = 0;
+  ahead->threadCount = 0;
+  ahead->uring = NULL;
+  ahead->buffers = malloc((size_t) READ_AHEAD_BLOCKS * READ_AHEAD_BLOCK);
+  for (int i = 0; i < READ_AHEAD_BLOCKS; i++) {
+    ahead->blocks[i].data = ahead->buffers + (size_t) i * READ_AHEAD_BLOCK;
+  }
+
+#if READ_AHEAD_URING
+  if (method == READ_URING && (ahead->uring = openUring()) != NULL) {
+    ahead->method = READ_URING;
+    submitBlocks(ahead);
+    return;
+  }
+#endif
+  ahead->method = READ_THREADS;
+  pthread_mutex_init(&ahead->lock, NULL);
+  pthread_cond_init(&ahead->readyCond, NULL);
+  pthread_cond_init(&ahead->freeCond, NULL);
+  for (int t = 0; t < READ_AHEAD_THREADS; t++) {
+    if (pthread_create(&ahead->threads[ahead->threadCount], NULL, readBlocks, ahead) == 0) {
+      ahead->threadCount++;
+    }
+  }
+}
+
+// wait for the next block:
+ReadBlock* nextBlock(ReadAhead* ahead) {
+  ReadBlock* block = &ahead->blocks[ahead->consumed % READ_AHEAD_BLOCKS];
+
+#if READ_AHEAD_URING
+  if (ahead->method == READ_URING) {
+    // every free buffer is always planned, so if none is, nothing is left
+    while (ahead->consumed < ahead->planned && !block->ready) {
+      if (enterUring(ahead->uring, 1) != 0) break;
+      reapUring(ahead);
+      if (enterUring(ahead->uring, 0) != 0) break; // reads queued again
+    }
+    if (ahead->consumed == ahead->planned || block->ready) {
+      return ahead->consumed < ahead->planned ? block : NULL;
+    }
+    abandonUring(ahead); // read the block below instead
+  }
+#endif
+
+  if (ahead->threadCount == 0) {
+    // no thread could be started: read each block when it is asked for
+    if (ahead->consumed == ahead->planned) {
+      if (!planBlock(ahead, block)) return NULL;
+      ahead->planned++;
+    }
+    if (!block->ready) readBlock(block);
+    block->ready = 1;
+    return block;
+  }
+  pthread_mutex_lock(&ahead->lock);
+  while (!(ahead->consumed < ahead->planned && block->ready)
+         && !(ahead->planDone && ahead->consumed == ahead->planned)) {
+    pthread_cond_wait(&ahead->readyCond, &ahead->lock);
+  }
+  if (ahead->consumed == ahead->planned) block = NULL;
+  pthread_mutex_unlock(&ahead->lock);
+  return block;
+}
+
+// hand a block's buffer back:
+void releaseBlock(ReadAhead* ahead, ReadBlock* block) {
+  if (block->last && block->fd >= 0) close(block->fd);
+  block->fd = -1;
+
+#if READ_AHEAD_URING
+  if (ahead->method == READ_URING) {
+    ahead->consumed++;
+    submitBlocks(ahead);
+    return;
+  }
+#endif
+  if (ahead->threadCount == 0) {
+    ahead->consumed++;
+    return;
+  }
+  pthread_mutex_lock(&ahead->lock);
+  ahead->consumed++;
+  pthread_cond_signal(&ahead->freeCond);
+  pthread_mutex_unlock(&ahead->lock);
+}
+
+// stop reading, and free everything:
+void stopReadAhead(ReadAhead* ahead) {
+#if READ_AHEAD_URING
+  if (ahead->uring != NULL) {
+    // the buffers may only be freed once the kernel is done with them
+    // (even after the io_uring was given up; see abandonUring())
+    ahead->stopping = 1;
+    while (ahead->uring->inFlight > 0 && enterUring(ahead->uring, 1) == 0) {
+      reapUring(ahead);
+    }
+    if (ahead->uring->inFlight == 0) free(ahead->uring->staleBuffers);
+    closeUring(ahead->uring);
+  }
+#endif
+  if (ahead->method == READ_THREADS) {
+    pthread_mutex_lock(&ahead->lock);
+    ahead->stopping = 1;
+    pthread_cond_broadcast(&ahead->freeCond);
+    pthread_mutex_unlock(&ahead->lock);
+    for (int t = 0; t < ahead->threadCount; t++) pthread_join(ahead->threads[t], NULL);
+    pthread_cond_destroy(&ahead->freeCond);
+    pthread_cond_destroy(&ahead->readyCond);
+    pthread_mutex_destroy(&ahead->lock);
+  }
+  closePlannedFiles(ahead);
+  free(ahead->buffers);
+}
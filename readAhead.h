@@ -0,0 +1,139 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#ifndef READ_AHEAD_BLOCK
+#define READ_AHEAD_BLOCK (256 << 10) // bytes asked for by each read
+#endif
+
+#ifndef READ_AHEAD_BLOCKS
+#define READ_AHEAD_BLOCKS 64 // blocks in the ring (READ_AHEAD_BLOCKS * READ_AHEAD_BLOCK bytes)
+#endif
+
+#ifndef READ_AHEAD_THREADS
+#define READ_AHEAD_THREADS 4 // pread() threads when io_uring cannot be used
+#endif
+
+// io_uring is used where the kernel headers have it (build with
+// -DREAD_AHEAD_URING=0 to leave it out)
+#ifndef READ_AHEAD_URING
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define READ_AHEAD_URING 1
+#endif
+#endif
+#endif
+#ifndef READ_AHEAD_URING
+#define READ_AHEAD_URING 0
+#endif
+
+typedef enum _readMethod {
+  READ_URING, // io_uring, falling back to READ_THREADS where unavailable
+  READ_THREADS, // a pool of READ_AHEAD_THREADS threads calling pread()
+  READ_MAPPED // no read-ahead: each file is memory-mapped as it is counted
+} ReadMethod;
+
+typedef struct _readBlock {
+  char* data; // READ_AHEAD_BLOCK bytes of buffer
+  int file; // index of the file the block belongs to
+  int fd; // the file's descriptor, -1 if it has none (error or direct)
+  long long offset; // where in the file the block starts
+  size_t length; // bytes asked for
+  size_t size; // bytes read so far (all of them once ready)
+  int last; // the last block of its file
+  int error; // errno if the file could not be opened (nothing is read)
+  int direct; // the file is not a regular file: the caller reads it itself
+  int ready; // read (or failed) and waiting to be handed out
+} ReadBlock;
+
+typedef struct _readAhead {
+  char** paths; // the files, in the order they are handed out
+  int pathCount; // # of files
+  int nextFile; // next file to open
+  int planFile; // file blocks are being planned for, -1 if none
+  int planFd; // its descriptor
+  long long planSize; // its size
+  long long planOffset; // where its next block starts
+  ReadBlock blocks[READ_AHEAD_BLOCKS]; // block number n is blocks[n % READ_AHEAD_BLOCKS]
+  long long planned; // # of blocks planned (handed to a reader)
+  long long consumed; // # of blocks the caller is done with
+  int planDone; // every file has been planned
+  ReadMethod method; // READ_URING or READ_THREADS (as actually used)
+  pthread_mutex_t lock; // guards everything above (READ_THREADS)
+  pthread_cond_t readyCond; // a block became ready
+  pthread_cond_t freeCond; // a block was released
+  pthread_t threads[READ_AHEAD_THREADS]; // (READ_THREADS)
+  int threadCount; // # of threads started (READ_THREADS)
+  int stopping; // the threads should exit, short reads are not retried
+  struct _uring* uring; // the io_uring and its rings (READ_URING, see readAhead.c)
+  char* buffers; // the blocks' buffers, in one allocation
+} ReadAhead;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  pick how files are read: setReadMethod(ReadMethod)
+// **  look a method up by name: findReadMethod(const char*)
+// **  the method files are read with: readMethod(void)
+// **  start reading files: startReadAhead(ReadAhead*, char**, int)
+// **  next block, in file order: nextBlock(ReadAhead*)
+// **  done with that block: releaseBlock(ReadAhead*, ReadBlock*)
+// **  stop (early or at the end): stopReadAhead(ReadAhead*)
+// **
+// ** A ReadAhead reads a list of files into a ring of
+// ** READ_AHEAD_BLOCKS buffers ahead of the code that counts them, so
+// ** the disk is busy while the CPU is tokenizing and the other way
+// ** around. The blocks are handed out in order (file by file, and in
+// ** order within each file) although they may be read out of order.
+// ** Memory is bounded by the ring: a block is only read into once the
+// ** caller has released the block that used its buffer before, so a
+// ** caller that falls behind simply stops the reading.
+// **
+// ** The reads are submitted to an io_uring, up to one per buffer, and
+// ** their completions are collected on the calling thread whenever it
+// ** waits for a block, so no threads are needed. Where io_uring is not
+// ** available (old kernels, seccomp filters, READ_AHEAD_URING=0),
+// ** READ_AHEAD_THREADS threads read the blocks with pread() instead.
+// ** If io_uring_enter() fails once reading has started, the io_uring
+// ** is given up: the reads in flight are waited for, and the remaining
+// ** blocks are read with pread() on the calling thread as they are
+// ** asked for.
+// ** Files that are not regular files (pipes, terminals, /dev/stdin)
+// ** cannot be read ahead; they get one "direct" block with no data, in
+// ** their place in the order, and the caller reads them itself.
+
+// setReadMethod() sets the method every ReadAhead started after it uses
+// (READ_URING by default). countFiles() (see ingest.h) does not read
+// ahead at all with READ_MAPPED.
+void setReadMethod(ReadMethod);
+
+// findReadMethod() returns the method named "uring", "threads" or "mmap",
+// or -1 for any other name.
+int findReadMethod(const char*);
+
+// readMethod() returns the method set with setReadMethod().
+ReadMethod readMethod(void);
+
+// startReadAhead() starts reading the given number of files. The paths
+// must stay valid until stopReadAhead().
+void startReadAhead(ReadAhead*, char**, int);
+
+// nextBlock() waits for the next block and returns it, or returns NULL
+// once every block of every file has been handed out. A block whose
+// error is set stands for a file that could not be opened; a direct one
+// for a file that has to be read by the caller. Only one block may be
+// held at a time: it must be released before the next is asked for.
+ReadBlock* nextBlock(ReadAhead*);
+
+// releaseBlock() hands a block's buffer back to be read into again (and
+// closes its file after the file's last block).
+void releaseBlock(ReadAhead*, ReadBlock*);
+
+// stopReadAhead() waits for the reads in progress, closes every file
+// still open and frees the buffers. It may be called before every block
+// has been handed out.
+void stopReadAhead(ReadAhead*);
+
+#endif
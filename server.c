@@ -0,0 +1,215 @@
+#include "server.h"
+#include "output.h"
+#include "getWord.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// ************************************************
+// ************************************************
+// ** server.c is the query server of --serve: an
+// ** accept loop on the main thread and one
+// ** detached thread per connection that reads
+// ** request lines, answers each from the shared
+// ** PairIndex and writes the answers back with
+// ** an Output, flushing whenever no further
+// ** request is already waiting in its buffer.
+// **
+// ** See server.h for the protocol.
+
+static volatile sig_atomic_t stopping = 0; // SIGINT or SIGTERM arrived
+
+// signal handler: let the accept loop finish
+static void stopServing(int signal) {
+  (void) signal;
+  stopping = 1;
+}
+
+// one client connection
+typedef struct _connection {
+  PairIndex* index; // shared by every connection
+  int fd; // the client's socket
+} Connection;
+
+// write the "OK n" line that starts an answer
+static void answerHeader(Output* output, int count) {
+  char header[32];
+  writeText(output, header, snprintf(header, sizeof(header), "OK %d\n", count));
+}
+
+// write the pair at a position of index->pairs (keyed by word ranks)
+static void answerPair(Output* output, PairIndex* index, int position) {
+  HashNode* pair = &index->pairs[position];
+  unsigned int* order = index->dict->order;
+  writePair(output, index->dict, pair->count, order[PAIR_FIRST(pair->key)], order[PAIR_SECOND(pair->key)]);
+}
+
+// read the optional "k" of a request; returns 0 if it is not a number
+static int readLimit(const char* text, int* limit) {
+  char* end;
+  long value;
+
+  if (text == NULL) return 1; // no limit given: keep the default
+  value = strtol(text, &end, 10);
+  if (*end != '\0' || value < 0) return 0;
+  if (value < *limit) *limit = value;
+  return 1;
+}
+
+// answer one request line
+static void answer(Output* output, PairIndex* index, char* line) {
+  char* save;
+  char* request = strtok_r(line, " \t\r", &save);
+  char* first = request ? strtok_r(NULL, " \t\r", &save) : NULL;
+  char* second = first ? strtok_r(NULL, " \t\r", &save) : NULL;
+  char firstWord[DICT_MAX_WORD_LEN], secondWord[DICT_MAX_WORD_LEN]; // as the files were tokenized
+  int limit;
+
+  if (request == NULL) {
+    writeText(output, "ERR empty request\n", 18);
+  } else if (strcmp(request, "TOP") == 0) {
+    limit = index->pairCount;
+    if (first == NULL || second != NULL || !readLimit(first, &limit)) {
+      writeText(output, "ERR usage: TOP k\n", 17);
+      return;
+    }
+    answerHeader(output, limit);
+    for (int i = 0; i < limit; i++) answerPair(output, index, i);
+  } else if (strcmp(request, "COUNT") == 0) {
+    if (second == NULL || strtok_r(NULL, " \t\r", &save) != NULL) {
+      writeText(output, "ERR usage: COUNT word1 word2\n", 29);
+      return;
+    }
+    if (normalizeWord(first, firstWord) > 0) first = firstWord;
+    if (normalizeWord(second, secondWord) > 0) second = secondWord;
+    answerHeader(output, 1);
+    writeCount(output, indexCount(index, first, second));
+    writeWord(output, first, strlen(first));
+    writeWord(output, second, strlen(second));
+    endRecord(output);
+  } else if (strcmp(request, "NEXT") == 0) {
+    if (first == NULL || strtok_r(NULL, " \t\r", &save) != NULL) {
+      writeText(output, "ERR usage: NEXT word [k]\n", 25);
+      return;
+    }
+    if (normalizeWord(first, firstWord) > 0) first = firstWord;
+    const Successor* followers = indexFollowers(index, first, &limit);
+    if (!readLimit(second, &limit)) {
+      writeText(output, "ERR usage: NEXT word [k]\n", 25);
+      return;
+    }
+    answerHeader(output, limit);
+    if (limit == 0) return;
+    unsigned int* order = index->dict->order;
+    unsigned int firstId = order[findRank(index->dict, first)];
+    for (int i = 0; i < limit; i++) {
+      writePair(output, index->dict, followers[i].count, firstId, order[followers[i].second]);
+    }
+  } else {
+    writeText(output, "ERR unknown request\n", 20);
+  }
+}
+
+// thread body: answer the requests of one connection until it closes
+static void* serveConnection(void* argument) {
+  Connection* connection = argument;
+  char buffer[SERVER_LINE_MAX];
+  size_t used = 0; // bytes of buffer holding unanswered requests
+  Output output;
+  ssize_t bytes;
+
+  openOutput(&output, connection->fd);
+  while (!output.failed
+         && (bytes = read(connection->fd, buffer + used, sizeof(buffer) - used)) != 0) {
+    if (bytes < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    used += bytes;
+
+    // answer every complete line, then send the answers at once
+    char* line = buffer;
+    char* newline;
+    while ((newline = memchr(line, '\n', buffer + used - line)) != NULL) {
+      *newline = '\0';
+      answer(&output, connection->index, line);
+      line = newline + 1;
+    }
+    flushOutput(&output);
+    used -= line - buffer;
+    memmove(buffer, line, used);
+    if (used == sizeof(buffer)) {
+      writeText(&output, "ERR request too long\n", 21);
+      break;
+    }
+  }
+  closeOutput(&output);
+  close(connection->fd);
+  free(connection);
+  return NULL;
+}
+
+// serve the index on a Unix socket:
+int servePairs(PairIndex* index, const char* path) {
+  struct sockaddr_un address;
+  struct sigaction action;
+  struct stat st;
+  pthread_attr_t detached;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+
+  // a socket left behind by an earlier server is replaced, anything
+  // else at the path is not
+  if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) return -1;
+  if (bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0
+      || listen(listener, SERVER_BACKLOG) != 0) {
+    int error = errno;
+    close(listener);
+    errno = error;
+    return -1;
+  }
+
+  // stop on SIGINT/SIGTERM (interrupting accept()), and let a client
+  // that hangs up early cost only its own connection
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stopServing;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  pthread_attr_init(&detached);
+  pthread_attr_setdetachstate(&detached, PTHREAD_CREATE_DETACHED);
+  while (!stopping) {
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) continue; // EINTR (stopping) or a connection that failed
+
+    Connection* connection = malloc(sizeof(Connection));
+    pthread_t thread;
+    connection->index = index;
+    connection->fd = fd;
+    if (pthread_create(&thread, &detached, serveConnection, connection) != 0) {
+      close(fd);
+      free(connection);
+    }
+  }
+  pthread_attr_destroy(&detached);
+
+  close(listener);
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "pairIndex.h"
+
+#ifndef SERVER_LINE_MAX
+#define SERVER_LINE_MAX 1024 // longest request line accepted
+#endif
+
+#define SERVER_BACKLOG 128 // connections waiting to be accepted
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  answer queries on a Unix socket: servePairs(PairIndex*, const char*)
+// **
+// ** Server mode (--serve PATH) counts its input once and then answers
+// ** queries about the pairs over a Unix domain socket until it gets
+// ** SIGINT or SIGTERM. Every connection is served by its own thread
+// ** straight from the PairIndex, which is never changed, so no locks
+// ** are taken. A client sends one request per line and may send more
+// ** before reading the answers:
+// **
+// **   TOP k            the k most frequent pairs
+// **   COUNT word1 word2  the count of one pair (0 if never seen)
+// **   NEXT word [k]    the (k) most frequent pairs starting with word
+// **
+// ** Each answer is a line "OK n" followed by n pairs in the output
+// ** format (see output.h; "%10d word1 word2" lines by default), or a
+// ** single line "ERR message". Words are matched exactly as they are
+// ** printed (lowercase, without punctuation).
+
+// servePairs() listens on the Unix socket at the given path (replacing
+// a stale socket left there) and answers queries from the PairIndex
+// until SIGINT or SIGTERM arrives, then removes the socket. The function
+// returns 0, or -1 (with errno set) if the socket cannot be set up.
+int servePairs(PairIndex*, const char*);
+
+#endif
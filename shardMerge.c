@@ -0,0 +1,365 @@
+#include "shardMerge.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+// ************************************************
+// ************************************************
+// ** shardMerge.c merges HashTables by hash prefix:
+// ** the pairs of all the tables are partitioned
+// ** into shards by one counting pass and one
+// ** scattering pass, each shard is sorted and its
+// ** duplicates added up, and each thread then
+// ** lays its shards' pairs into its own range of
+// ** the merged table's rows.
+// **
+// ** See shardMerge.h for more information on each
+// ** individual function.
+
+// shards this short are sorted by insertion
+#define SHARD_INSERTION_MAX 16
+
+// the rows of one table being merged
+typedef struct _mergeSource {
+  HashNode* rows;
+  int rowCount;
+  unsigned int* remap; // merged id of each of the table's word ids, NULL if unchanged
+} MergeSource;
+
+// what the threads of one mergeHashTables() share
+typedef struct _mergeShared {
+  MergeSource* sources; // the tables, the first one being merged into
+  int sourceCount;
+  long long sourceRows; // rows of every source together
+  HashTable** merged; // the tables to destroy once scattered
+  int mergedCount;
+  int threadCount; // # of slices (and threads)
+  int shardBits; // a pair's shard is the top shardBits bits of its hash
+  int shardCount;
+  long long* positions; // shardCount counters, then next positions, per slice
+  long long* shardStart; // shard s is nodes[shardStart[s] .. shardStart[s + 1])
+  int* uniqueCounts; // distinct pairs of each shard (at the front of it)
+  HashNode* nodes; // every pair, grouped by shard; key holds the pair's hash
+  HashNode* table; // the merged table's rows
+  int rowCount; // # of rows in table
+  int rowsAtLeast; // the table is never made smaller than this
+  int* overflowShard; // per thread: the shard of the first pair left over, -1 if none
+  int* overflowNode; // per thread: that pair's index in its shard
+  pthread_barrier_t barrier; // between the steps of the merge
+  pthread_mutex_t startLock; // guards started
+  pthread_cond_t startChanged;
+  int started; // set once threadCount is final and the barrier is ready
+} MergeShared;
+
+// one thread's part of a mergeHashTables()
+typedef struct _mergeSlice {
+  MergeShared* shared;
+  int index; // which slice of the rows, and which block of shards, is this thread's
+} MergeSlice;
+
+// wait for every thread of the merge (if there are others)
+static void mergeWait(MergeShared* shared) {
+  if (shared->threadCount > 1) pthread_barrier_wait(&shared->barrier);
+}
+
+// the hash of a pair of a source, re-keyed into the merged Dictionary
+static inline unsigned long long sourceHash(MergeSource* source, unsigned long long key) {
+  if (source->remap != NULL) key = PAIR_KEY(source->remap[PAIR_FIRST(key)], source->remap[PAIR_SECOND(key)]);
+  return hashKey(key);
+}
+
+// the first shard of a thread's block of shards
+static int firstShard(MergeShared* shared, int t) {
+  return (long long) shared->shardCount * t / shared->threadCount;
+}
+
+// the first row of the merged table that a shard's pairs may have as home
+static int shardRow(MergeShared* shared, int shard) {
+  if (shard == shared->shardCount) return shared->rowCount;
+  return HOME_ROW((unsigned long long) shard << (64 - shared->shardBits), shared->rowCount);
+}
+
+// count the pairs of this thread's slice of the rows by shard (scatter
+// = 0), or move them into their shards (scatter = 1)
+static void partitionSlice(MergeShared* shared, int slice, int scatter) {
+  long long first = shared->sourceRows * slice / shared->threadCount;
+  long long last = shared->sourceRows * (slice + 1) / shared->threadCount;
+  long long* positions = shared->positions + (size_t) slice * shared->shardCount;
+  int shift = 64 - shared->shardBits;
+  long long sourceFirst = 0; // row of all sources where the source starts
+
+  for (int i = 0; i < shared->sourceCount && sourceFirst < last; i++) {
+    MergeSource* source = &shared->sources[i];
+    long long start = first > sourceFirst ? first - sourceFirst : 0;
+    long long end = last - sourceFirst < source->rowCount ? last - sourceFirst : source->rowCount;
+    for (long long r = start; r < end; r++) {
+      if (source->rows[r].count <= 0) continue;
+      unsigned long long hash = sourceHash(source, source->rows[r].key);
+      if (scatter) {
+        HashNode* node = &shared->nodes[positions[hash >> shift]++];
+        node->key = hash;
+        node->count = source->rows[r].count;
+      } else {
+        positions[hash >> shift]++;
+      }
+    }
+    sourceFirst += source->rowCount;
+  }
+}
+
+// turn the counters of every slice into the position of each slice's
+// first pair in every shard, and fill in shardStart[]
+static void shardPositions(MergeShared* shared) {
+  long long next = 0;
+
+  for (int s = 0; s < shared->shardCount; s++) {
+    shared->shardStart[s] = next;
+    for (int t = 0; t < shared->threadCount; t++) {
+      long long* position = &shared->positions[(size_t) t * shared->shardCount + s];
+      long long pairs = *position;
+      *position = next;
+      next += pairs;
+    }
+  }
+  shared->shardStart[shared->shardCount] = next;
+}
+
+// sort a shard by hash: quicksort (median of three pivots, recursing
+// into the shorter side) down to short runs, which are finished by
+// insertion
+static void sortShard(HashNode* nodes, long long length) {
+  while (length > SHARD_INSERTION_MAX) {
+    HashNode* middle = nodes + length / 2;
+    HashNode* last = nodes + length - 1;
+    HashNode swap;
+    if (nodes->key > middle->key) swap = *nodes, *nodes = *middle, *middle = swap;
+    if (middle->key > last->key) swap = *middle, *middle = *last, *last = swap;
+    if (nodes->key > middle->key) swap = *nodes, *nodes = *middle, *middle = swap;
+
+    unsigned long long pivot = middle->key;
+    long long i = 0, j = length - 1;
+    for (;;) {
+      while (nodes[i].key < pivot) i++;
+      while (nodes[j].key > pivot) j--;
+      if (i >= j) break;
+      swap = nodes[i], nodes[i] = nodes[j], nodes[j] = swap;
+      i++;
+      j--;
+    }
+    // nodes[0 .. j] are no greater than the pivot, nodes[j + 1 ..] no less
+    if (j + 1 < length - j - 1) {
+      sortShard(nodes, j + 1);
+      nodes += j + 1;
+      length -= j + 1;
+    } else {
+      sortShard(nodes + j + 1, length - j - 1);
+      length = j + 1;
+    }
+  }
+  for (long long i = 1; i < length; i++) {
+    HashNode node = nodes[i];
+    long long j = i;
+    for (; j > 0 && nodes[j - 1].key > node.key; j--) nodes[j] = nodes[j - 1];
+    nodes[j] = node;
+  }
+}
+
+// sort a shard and add up the copies of each pair, leaving the distinct
+// pairs at its front; returns how many there are
+static int combineShard(HashNode* nodes, long long length) {
+  int unique = 0;
+
+  sortShard(nodes, length);
+  for (long long i = 0; i < length; i++) {
+    if (unique > 0 && nodes[unique - 1].key == nodes[i].key) nodes[unique - 1].count += nodes[i].count;
+    else nodes[unique++] = nodes[i];
+  }
+  return unique;
+}
+
+// size and allocate the merged table for every distinct pair
+static void allocateMerged(MergeShared* shared) {
+  long long unique = 0;
+
+  for (int s = 0; s < shared->shardCount; s++) unique += shared->uniqueCounts[s];
+  shared->rowCount = shared->rowsAtLeast;
+  if (unique > HASH_MAX_UNIQUE) tableFull();
+  while (unique > LOAD_FACTOR * shared->rowCount && shared->rowCount < HASH_MAX_ROWS) shared->rowCount *= 2;
+  shared->table = calloc(shared->rowCount, sizeof(HashNode)); // pages are zeroed as threads touch them
+}
+
+// lay the pairs of this thread's shards into its range of rows, in hash
+// order, and note where the pairs that run past its end start
+static void placeShards(MergeShared* shared, int t) {
+  int lastShard = firstShard(shared, t + 1);
+  int end = shardRow(shared, lastShard);
+  int next = shardRow(shared, firstShard(shared, t)); // first row not taken
+
+  shared->overflowShard[t] = -1;
+  for (int s = firstShard(shared, t); s < lastShard; s++) {
+    HashNode* nodes = shared->nodes + shared->shardStart[s];
+    for (int i = 0; i < shared->uniqueCounts[s]; i++) {
+      int row = HOME_ROW(nodes[i].key, shared->rowCount);
+      if (row < next) row = next; // home taken: the next free row, as a probe would find
+      if (row >= end) {
+        shared->overflowShard[t] = s;
+        shared->overflowNode[t] = i;
+        return;
+      }
+      shared->table[row].key = unhashKey(nodes[i].key);
+      shared->table[row].count = nodes[i].count;
+      next = row + 1;
+    }
+  }
+}
+
+// the steps of the merge (see shardMerge.h) on one thread
+static void* mergeSlice(void* argument) {
+  MergeSlice* slice = argument;
+  MergeShared* shared = slice->shared;
+  int t = slice->index;
+
+  for (int s = 0; s < shared->shardCount; s++) shared->positions[(size_t) t * shared->shardCount + s] = 0;
+  partitionSlice(shared, t, 0);
+  mergeWait(shared);
+  if (t == 0) shardPositions(shared);
+  mergeWait(shared);
+  partitionSlice(shared, t, 1);
+  mergeWait(shared); // every pair scattered before any table is freed
+
+  for (int i = t; i < shared->mergedCount; i += shared->threadCount) destroy(shared->merged[i]);
+  for (int s = firstShard(shared, t); s < firstShard(shared, t + 1); s++) {
+    long long start = shared->shardStart[s];
+    shared->uniqueCounts[s] = combineShard(shared->nodes + start, shared->shardStart[s + 1] - start);
+  }
+  mergeWait(shared);
+  if (t == 0) allocateMerged(shared);
+  mergeWait(shared);
+  placeShards(shared, t);
+  return NULL;
+}
+
+// a merge thread: wait until every thread that could be created is
+// known, then merge its slice
+static void* mergeWorker(void* argument) {
+  MergeShared* shared = ((MergeSlice*) argument)->shared;
+
+  pthread_mutex_lock(&shared->startLock);
+  while (!shared->started) pthread_cond_wait(&shared->startChanged, &shared->startLock);
+  pthread_mutex_unlock(&shared->startLock);
+  return mergeSlice(argument);
+}
+
+// merge many tables into one:
+void mergeHashTables(HashTable* into, HashTable** from, int fromCount, int threads) {
+  MergeShared shared;
+  long long usedRows = into->uniqueCount;
+
+  if (into->maxRows != 0) {
+    // a spilling table has to go through insert() to stay in its limit
+    for (int i = 0; i < fromCount; i++) {
+      mergeHashTable(into, from[i]);
+      destroy(from[i]);
+    }
+    return;
+  }
+
+  // the merged Dictionary, and the rows every thread slices
+  finishResize(into);
+  shared.sourceCount = fromCount + 1;
+  shared.sources = malloc(sizeof(MergeSource) * shared.sourceCount);
+  shared.sources[0].rows = into->table;
+  shared.sources[0].rowCount = into->rowCount;
+  shared.sources[0].remap = NULL;
+  shared.sourceRows = into->rowCount;
+  for (int i = 0; i < fromCount; i++) {
+    Dictionary* fromDict = from[i]->dict;
+    MergeSource* source = &shared.sources[i + 1];
+    finishResize(from[i]);
+    source->rows = from[i]->table;
+    source->rowCount = from[i]->rowCount;
+    source->remap = malloc(sizeof(unsigned int) * (fromDict->wordCount ? fromDict->wordCount : 1));
+    for (int w = 0; w < fromDict->wordCount; w++) {
+      source->remap[w] = internWord(into->dict, fromDict->words[w], fromDict->lengths[w]);
+    }
+    shared.sourceRows += from[i]->rowCount;
+    usedRows += from[i]->uniqueCount;
+    into->entryCount += from[i]->entryCount;
+  }
+
+  // each thread gets at least MERGE_THREAD_MIN rows, and there are about
+  // SHARD_NODES pairs per shard but at least one shard per thread
+  if (threads > shared.sourceRows / MERGE_THREAD_MIN) threads = shared.sourceRows / MERGE_THREAD_MIN;
+  if (threads > 1 << SHARD_BITS_MAX) threads = 1 << SHARD_BITS_MAX;
+  if (threads < 1) threads = 1;
+  shared.shardBits = 1;
+  while (shared.shardBits < SHARD_BITS_MAX
+         && ((1LL << shared.shardBits) * SHARD_NODES < usedRows || (1 << shared.shardBits) < threads)) {
+    shared.shardBits++;
+  }
+  shared.shardCount = 1 << shared.shardBits;
+  shared.merged = from;
+  shared.mergedCount = fromCount;
+  shared.rowsAtLeast = into->rowCount;
+  shared.positions = malloc(sizeof(long long) * threads * shared.shardCount);
+  shared.shardStart = malloc(sizeof(long long) * (shared.shardCount + 1));
+  shared.uniqueCounts = malloc(sizeof(int) * shared.shardCount);
+  shared.nodes = malloc(sizeof(HashNode) * (usedRows ? usedRows : 1));
+  shared.overflowShard = malloc(sizeof(int) * threads);
+  shared.overflowNode = malloc(sizeof(int) * threads);
+  MergeSlice* slices = malloc(sizeof(MergeSlice) * threads);
+  pthread_t* workers = malloc(sizeof(pthread_t) * threads);
+
+  // slice 0 is merged on the calling thread; if a thread cannot be
+  // created the merge goes on with the threads created before it, which
+  // wait until the slices are cut for that many
+  pthread_mutex_init(&shared.startLock, NULL);
+  pthread_cond_init(&shared.startChanged, NULL);
+  shared.started = 0;
+  for (int t = 0; t < threads; t++) {
+    slices[t].shared = &shared;
+    slices[t].index = t;
+    if (t > 0 && pthread_create(&workers[t], NULL, mergeWorker, &slices[t]) != 0) threads = t;
+  }
+  shared.threadCount = threads;
+  if (threads > 1) pthread_barrier_init(&shared.barrier, NULL, threads);
+  pthread_mutex_lock(&shared.startLock);
+  shared.started = 1;
+  pthread_cond_broadcast(&shared.startChanged);
+  pthread_mutex_unlock(&shared.startLock);
+  mergeSlice(&slices[0]);
+  for (int t = 1; t < threads; t++) pthread_join(workers[t], NULL);
+
+  // insert the pairs that ran past the end of a thread's rows; they
+  // probe on into the next thread's rows (keys are distinct by now)
+  for (int t = 0; t < threads; t++) {
+    if (shared.overflowShard[t] < 0) continue;
+    int node = shared.overflowNode[t];
+    for (int s = shared.overflowShard[t]; s < firstShard(&shared, t + 1); s++, node = 0) {
+      HashNode* nodes = shared.nodes + shared.shardStart[s];
+      for (; node < shared.uniqueCounts[s]; node++) {
+        nodes[node].key = unhashKey(nodes[node].key);
+        expansionInsert(shared.table, shared.rowCount, &nodes[node]);
+      }
+    }
+  }
+
+  free(into->table);
+  into->table = shared.table;
+  into->rowCount = shared.rowCount;
+  into->uniqueCount = 0;
+  for (int s = 0; s < shared.shardCount; s++) into->uniqueCount += shared.uniqueCounts[s];
+
+  if (threads > 1) pthread_barrier_destroy(&shared.barrier);
+  pthread_cond_destroy(&shared.startChanged);
+  pthread_mutex_destroy(&shared.startLock);
+  for (int i = 1; i < shared.sourceCount; i++) free(shared.sources[i].remap);
+  free(workers);
+  free(slices);
+  free(shared.overflowNode);
+  free(shared.overflowShard);
+  free(shared.nodes);
+  free(shared.uniqueCounts);
+  free(shared.shardStart);
+  free(shared.positions);
+  free(shared.sources);
+}
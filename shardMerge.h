@@ -0,0 +1,61 @@
+#ifndef SHARDMERGE_H
+#define SHARDMERGE_H
+
+#include "hash.h"
+
+#ifndef SHARD_NODES
+#define SHARD_NODES 4096 // pairs per shard aimed for (so that a shard is sorted in cache)
+#endif
+
+#ifndef SHARD_BITS_MAX
+#define SHARD_BITS_MAX 12 // at most 2^12 shards (the fan-out of the partitioning pass)
+#endif
+
+#ifndef MERGE_THREAD_MIN
+#define MERGE_THREAD_MIN 65536 // fewest table rows worth handing to another thread
+#endif
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  merge many tables into one: mergeHashTables(HashTable*, HashTable**, int, int)
+// **
+// ** Merging tables counted on separate threads with mergeHashTable()
+// ** re-inserts every pair, one at a time, into one growing table. The
+// ** merge here instead splits the pairs into shards by the top bits
+// ** of their hashKey(). Since a pair's home row is the top bits of its
+// ** hash (see HOME_ROW()), each shard owns a contiguous range of the
+// ** rows of the merged table whatever its size, so every thread can
+// ** fill its own range of the table with no locks:
+// **
+// **   1. The Dictionaries are merged: each table's words are interned
+// **      into the first table's Dictionary (on the calling thread;
+// **      there are far fewer words than pairs).
+// **   2. Every thread takes an equal slice of the rows of all the
+// **      tables, counts its pairs per shard and, once the counts are
+// **      laid out end to end, scatters them (re-keyed by the merged
+// **      Dictionary, and hashed) into one array grouped by shard.
+// **   3. Every thread sorts each of its shards by hash, which brings
+// **      the copies of a pair together, and adds them up.
+// **   4. The merged table is sized for the total number of distinct
+// **      pairs, and every thread writes its shards' pairs into its
+// **      own range of rows in hash order. A pair whose home row is
+// **      taken by the pairs before it goes in the next free row, as
+// **      linear probing would have placed it, so the writes sweep the
+// **      range once from start to end.
+// **
+// ** Only the few pairs that would run past the end of a thread's
+// ** range are left over; the calling thread inserts them at the end.
+// ** Every step but the first does the same amount of work on each
+// ** thread, so the merge scales with the number of cores.
+
+// mergeHashTables() adds every pair counted in the given number (the
+// third argument) of HashTables to the first HashTable, as calling
+// mergeHashTable() on each would, on at most the given number of
+// threads (fewer for small tables, or if a thread cannot be created).
+// The merged HashTables are destroyed.
+// A HashTable with a row limit (see spill.h) is merged into with
+// mergeHashTable() instead.
+void mergeHashTables(HashTable*, HashTable**, int, int);
+
+#endif
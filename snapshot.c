@@ -0,0 +1,213 @@
+#include "snapshot.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ************************************************
+// ************************************************
+// ** snapshot.c saves the pairs of a HashTable
+// ** to a binary file and merges saved files back
+// ** into a HashTable. Loading maps the file and
+// ** reads it in place, so a snapshot costs one
+// ** pass over its bytes instead of re-tokenizing
+// ** the text it was counted from.
+// **
+// ** See snapshot.h for the file layout and more
+// ** information on each individual function.
+
+#define PADDED(bytes) (((bytes) + 7) & ~7ULL) // sections start 8-byte aligned
+
+// write bytes, returning 0 if they could not all be written
+static int writeBytes(FILE* file, const void* data, size_t size) {
+  return fwrite(data, 1, size, file) == size;
+}
+
+// write the zero bytes that pad a section of size bytes
+static int writePadding(FILE* file, unsigned long long size) {
+  static const char zeros[8];
+  return writeBytes(file, zeros, PADDED(size) - size);
+}
+
+// save every pair of a HashTable and the words they use:
+int saveSnapshot(HashTable* hashTable, const char* path) {
+  Dictionary* dict = hashTable->dict;
+  SnapshotHeader header;
+  SnapshotPair pair;
+  FILE* file = fopen(path, "wb");
+  int ok = 1;
+
+  if (file == NULL) return -1;
+  StatTimer timer = startTimer(PHASE_SAVE);
+  finishResize(hashTable);
+
+  // number the words that occur in a pair in id order; words left
+  // without pairs (e.g. by subtractCount()) are not saved
+  unsigned int* savedId = malloc(sizeof(unsigned int) * (dict->wordCount ? dict->wordCount : 1));
+  memset(savedId, 0xFF, sizeof(unsigned int) * dict->wordCount); // DICT_EMPTY
+  for (int r = 0; r < hashTable->rowCount; r++) {
+    if (hashTable->table[r].count == 0) continue;
+    savedId[PAIR_FIRST(hashTable->table[r].key)] = 0;
+    savedId[PAIR_SECOND(hashTable->table[r].key)] = 0;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.byteOrder = SNAPSHOT_BYTE_ORDER;
+  for (int i = 0; i < dict->wordCount; i++) {
+    if (savedId[i] == DICT_EMPTY) continue;
+    savedId[i] = header.wordCount++;
+    header.textBytes += dict->lengths[i];
+  }
+  header.pairCount = hashTable->uniqueCount;
+  header.entryCount = hashTable->entryCount;
+
+  // header, then the dictionary section: lengths and text
+  ok = ok && writeBytes(file, &header, sizeof(header));
+  for (int i = 0; ok && i < dict->wordCount; i++) {
+    if (savedId[i] != DICT_EMPTY) ok = writeBytes(file, &dict->lengths[i], 1);
+  }
+  ok = ok && writePadding(file, header.wordCount);
+  for (int i = 0; ok && i < dict->wordCount; i++) {
+    if (savedId[i] != DICT_EMPTY) ok = writeBytes(file, dict->words[i], dict->lengths[i]);
+  }
+  ok = ok && writePadding(file, header.textBytes);
+
+  // the pair records, in row order
+  for (int r = 0; ok && r < hashTable->rowCount; r++) {
+    if (hashTable->table[r].count == 0) continue;
+    pair.first = savedId[PAIR_FIRST(hashTable->table[r].key)];
+    pair.second = savedId[PAIR_SECOND(hashTable->table[r].key)];
+    pair.count = hashTable->table[r].count;
+    ok = writeBytes(file, &pair, sizeof(pair));
+  }
+
+  free(savedId);
+  if (fclose(file) != 0) ok = 0;
+  stopTimer(timer);
+  return ok ? 0 : -1;
+}
+
+// check that a mapped file of size bytes holds a complete snapshot
+// whose layout matches its header
+static int validSnapshot(const SnapshotHeader* header, size_t size) {
+  if (size < sizeof(SnapshotHeader)) return 0;
+  if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) return 0;
+  if (header->version != SNAPSHOT_VERSION || header->byteOrder != SNAPSHOT_BYTE_ORDER) return 0;
+  if (header->wordCount > INT_MAX || header->pairCount > INT_MAX) return 0;
+  if (header->textBytes > (unsigned long long) header->wordCount * UCHAR_MAX) return 0;
+  return sizeof(SnapshotHeader) + PADDED(header->wordCount) + PADDED(header->textBytes)
+         + header->pairCount * sizeof(SnapshotPair) == size;
+}
+
+// check that every word length and pair record of a snapshot is
+// usable before anything is added to the HashTable: each word is 1 to
+// SNAPSHOT_MAX_WORD_LEN bytes and lies within the text section
+static int validRecords(const SnapshotHeader* header, const unsigned char* lengths,
+                        const SnapshotPair* pairs) {
+  unsigned long long offset = 0; // where the next word starts in the text
+
+  for (unsigned int i = 0; i < header->wordCount; i++) {
+    int length = lengths[i];
+    if (length == 0 || length > SNAPSHOT_MAX_WORD_LEN) return 0;
+    if (length > header->textBytes - offset) return 0; // runs past the text
+    offset += length;
+  }
+  if (offset != header->textBytes) return 0;
+  for (unsigned long long i = 0; i < header->pairCount; i++) {
+    if (pairs[i].first >= header->wordCount || pairs[i].second >= header->wordCount
+        || pairs[i].count == 0 || pairs[i].count > INT_MAX) return 0;
+  }
+  return 1;
+}
+
+// add (or with subtract set, take back out) the pairs of a snapshot
+// file to a HashTable
+static int applySnapshot(HashTable* hashTable, const char* path, int subtract) {
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  void* map;
+
+  if (fd < 0) return -1;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+  if (st.st_size < (off_t) sizeof(SnapshotHeader)) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return -1;
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+  // the sections are only located once the header's sizes are known to
+  // add up to the file's
+  const SnapshotHeader* header = map;
+  const unsigned char* lengths = (const unsigned char*) (header + 1);
+  const char* text = NULL;
+  const SnapshotPair* pairs = NULL;
+  if (validSnapshot(header, st.st_size)) {
+    text = (const char*) lengths + PADDED(header->wordCount);
+    pairs = (const SnapshotPair*) (text + PADDED(header->textBytes));
+  }
+  if (pairs == NULL || !validRecords(header, lengths, pairs)) {
+    munmap(map, st.st_size);
+    errno = EINVAL;
+    return -1;
+  }
+
+  StatTimer timer = startTimer(PHASE_LOAD);
+  unsigned int* remap = malloc(sizeof(unsigned int) * (header->wordCount ? header->wordCount : 1));
+  unsigned long long offset = 0;
+
+  // translate every saved word id into an id of the table's Dictionary
+  for (unsigned int i = 0; i < header->wordCount; i++) {
+    remap[i] = internWord(hashTable->dict, text + offset, lengths[i]);
+    offset += lengths[i];
+  }
+
+  if (subtract) {
+    for (unsigned long long i = 0; i < header->pairCount; i++) {
+      subtractCount(hashTable, PAIR_KEY(remap[pairs[i].first], remap[pairs[i].second]), pairs[i].count);
+    }
+  } else {
+    // grow the table for every pair that might be new up front, rather
+    // than expanding it over and over while the records are inserted; a
+    // table with a row limit (see spill.h) is grown no further than
+    // insert() would, and spills once that is full
+    while (hashTable->uniqueCount + header->pairCount > LOAD_FACTOR * hashTable->rowCount
+           && hashTable->rowCount < HASH_MAX_ROWS
+           && (hashTable->maxRows == 0 || hashTable->rowCount <= hashTable->maxRows / 2)) {
+      expand(hashTable);
+    }
+    for (unsigned long long i = 0; i < header->pairCount; i++) {
+      insertCount(hashTable, PAIR_KEY(remap[pairs[i].first], remap[pairs[i].second]), pairs[i].count);
+    }
+  }
+
+  addStat(&runStats.bytesRead, st.st_size);
+  free(remap);
+  munmap(map, st.st_size);
+  stopTimer(timer);
+  return 0;
+}
+
+// add the pairs of a snapshot file to a HashTable:
+int loadSnapshot(HashTable* hashTable, const char* path) {
+  return applySnapshot(hashTable, path, 0);
+}
+
+// take the pairs of a snapshot file back out of a HashTable:
+int unloadSnapshot(HashTable* hashTable, const char* path) {
+  return applySnapshot(hashTable, path, 1);
+}
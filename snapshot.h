@@ -0,0 +1,79 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "hash.h"
+
+#define SNAPSHOT_MAGIC "WPAIRS\r\n" // first 8 bytes of every snapshot file
+#define SNAPSHOT_VERSION 1 // bumped whenever the layout below changes
+#define SNAPSHOT_BYTE_ORDER 0x01020304u // written natively, checked on load
+#define SNAPSHOT_MAX_WORD_LEN 255 // longest word a snapshot may hold (as getWord.h makes them)
+
+typedef struct _snapshotHeader {
+  char magic[8]; // SNAPSHOT_MAGIC
+  unsigned int version; // SNAPSHOT_VERSION
+  unsigned int byteOrder; // SNAPSHOT_BYTE_ORDER as written by the saving host
+  unsigned int wordCount; // # of words in the dictionary section
+  unsigned int reserved; // 0
+  unsigned long long textBytes; // # of bytes of word text
+  unsigned long long pairCount; // # of pair records (unique pairs)
+  unsigned long long entryCount; // total # of pairs counted (sum of counts)
+} SnapshotHeader;
+
+typedef struct _snapshotPair {
+  unsigned int first; // id (index in the dictionary section) of the first word
+  unsigned int second; // id of the second word
+  unsigned int count; // # of occurances of the pair
+} SnapshotPair;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  write a HashTable to a file: saveSnapshot(HashTable*, const char*)
+// **  add a saved file to a HashTable: loadSnapshot(HashTable*, const char*)
+// **  take it back out again: unloadSnapshot(HashTable*, const char*)
+// **
+// ** A snapshot stores the counted pairs of a HashTable so that they
+// ** can be combined with new input later without re-reading the text
+// ** they came from. The file is laid out as:
+// **
+// **   SnapshotHeader
+// **   wordCount word lengths (one byte each), padded to 8 bytes
+// **   textBytes of word text (no separators), padded to 8 bytes
+// **   pairCount SnapshotPairs
+// **
+// ** The word ids of the pairs are the positions of words in the
+// ** dictionary section. Numbers are stored in the byte order of the
+// ** host that saved the file; a snapshot from a host of the other
+// ** byte order is rejected rather than misread.
+
+// saveSnapshot() writes every pair counted in the HashTable, and the
+// words those pairs are made of, to the file named by the second
+// argument, replacing it. Words are renumbered in id order. The function
+// returns 0 on success and -1 (with errno set) if the file cannot be
+// written.
+int saveSnapshot(HashTable*, const char*);
+
+// loadSnapshot() memory-maps the snapshot named by the second argument
+// and adds its pairs to the HashTable, as mergeHashTable() would: each
+// word is interned into the table's Dictionary once and the pair
+// records are inserted with translated ids. The whole file is checked
+// before anything is added, the table is grown for all of the records up
+// front (but no further than its row limit, if it has one; the records
+// that do not fit are spilled as insert() would spill them, see spill.h),
+// and the only allocation made is the id translation array, never one
+// per pair. A snapshot is invalid if its sizes do not add up to the
+// file's, if a word is empty, longer than SNAPSHOT_MAX_WORD_LEN or runs
+// past the text section, or if a pair refers to a word it does not
+// have. The function returns 0 on success and -1 if the file cannot be
+// opened or mapped (errno set) or is not a valid snapshot (errno set to
+// EINVAL); the HashTable is unchanged in that case.
+int loadSnapshot(HashTable*, const char*);
+
+// unloadSnapshot() is the reverse of loadSnapshot(): the counts of the
+// snapshot's pairs are subtracted from the HashTable with subtractCount(),
+// and pairs whose counts reach 0 are deleted. It is used to take back the
+// contribution of an input that has changed since it was saved. Returns
+// 0 or -1 exactly as loadSnapshot() does.
+int unloadSnapshot(HashTable*, const char*);
+
+#endif
@@ -0,0 +1,361 @@
+#include "spill.h"
+#include "topK.h"
+#include "stats.h"
+#include "output.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+// ************************************************
+// ************************************************
+// ** spill.c lets a HashTable count exactly more
+// ** pairs than fit in memory by writing sorted
+// ** runs to temporary files and merging them back
+// ** when the pairs are printed.
+// **
+// ** See spill.h for more information on each
+// ** individual function and the run format.
+
+// a run being read back during a merge
+typedef struct _runReader {
+  FILE* file; // buffered reader of the run
+  int order; // RUN_BY_KEY or RUN_BY_COUNT
+  long long remaining; // # of records not read yet
+  HashNode node; // the record read last
+} RunReader;
+
+// a k-way merge of runs of the same order
+typedef struct _runMerge {
+  RunReader* readers; // one per run
+  RunReader** heap; // readers that still have a record, first one at the root
+  int size; // # of readers in the heap
+  int count; // # of readers
+  int (*before)(const HashNode*, const HashNode*); // does one record come first?
+} RunMerge;
+
+// write a variable-length number (7 bits per byte, low bits first)
+static void writeNumber(FILE* file, unsigned long long value) {
+  while (value >= 0x80) {
+    putc_unlocked((value & 0x7F) | 0x80, file);
+    value >>= 7;
+  }
+  putc_unlocked(value, file);
+}
+
+// read a number written by writeNumber(); returns 0 at the end of the file
+static int readNumber(FILE* file, unsigned long long* value) {
+  int shift = 0, byte;
+
+  *value = 0;
+  do {
+    if ((byte = getc_unlocked(file)) == EOF) return 0;
+    *value |= (unsigned long long) (byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return 1;
+}
+
+// the orders runs are sorted in
+static int keyBefore(const HashNode* a, const HashNode* b) {
+  return a->key < b->key;
+}
+static int countBefore(const HashNode* a, const HashNode* b) {
+  return compare(a, b) < 0;
+}
+static int compareKeys(const void* n1, const void* n2) {
+  unsigned long long a = ((const HashNode*) n1)->key, b = ((const HashNode*) n2)->key;
+  return (a > b) - (a < b);
+}
+
+// write sorted nodes to a new run; returns 0, or -1 (errno set)
+static int writeRun(SpillState* state, HashNode* nodes, int count, int order) {
+  StatTimer timer = startTimer(PHASE_SPILL);
+  char* path = malloc(strlen(state->directory) + 32);
+  unsigned long long previousKey = 0;
+  unsigned int previousCount = INT_MAX;
+  FILE* file;
+  int fd, ok;
+
+  sprintf(path, "%s/wordpairs-run-XXXXXX", state->directory);
+  fd = mkstemp(path);
+  if (fd >= 0) unlink(path); // deleted once closed
+  free(path);
+  if (fd < 0) return -1;
+  if ((file = fdopen(dup(fd), "w")) == NULL) {
+    close(fd);
+    return -1;
+  }
+  setvbuf(file, NULL, _IOFBF, SPILL_BUFFER_SIZE);
+
+  // each record is the difference from the one before it: keys go up;
+  // in output order counts go down, and keys go up among equal counts
+  for (int i = 0; i < count; i++) {
+    if (order == RUN_BY_KEY) {
+      writeNumber(file, nodes[i].key - previousKey);
+      writeNumber(file, nodes[i].count);
+    } else {
+      writeNumber(file, previousCount - nodes[i].count);
+      writeNumber(file, (unsigned int) nodes[i].count == previousCount ? nodes[i].key - previousKey : nodes[i].key);
+      previousCount = nodes[i].count;
+    }
+    previousKey = nodes[i].key;
+  }
+  ok = !ferror(file);
+  if (fclose(file) != 0) ok = 0;
+  if (!ok) {
+    close(fd);
+    return -1;
+  }
+
+  if (state->runCount == state->runCapacity) {
+    state->runCapacity = state->runCapacity ? state->runCapacity * 2 : 16;
+    state->runs = realloc(state->runs, sizeof(SpillRun) * state->runCapacity);
+  }
+  state->runs[state->runCount].fd = fd;
+  state->runs[state->runCount].order = order;
+  state->runs[state->runCount++].records = count;
+  addStat(&runStats.spillRuns, 1);
+  addStat(&runStats.spillBytes, lseek(fd, 0, SEEK_END));
+  stopTimer(timer);
+  return 0;
+}
+
+// move the used rows of a table to its front; returns how many there are
+static int compactRows(HashTable* hashTable) {
+  int used = 0;
+  finishResize(hashTable);
+  for (int r = 0; r < hashTable->rowCount; r++) {
+    if (hashTable->table[r].count != 0) hashTable->table[used++] = hashTable->table[r];
+  }
+  return used;
+}
+
+// the overflow function of a spilling HashTable: write its pairs to a
+// run and empty it
+static void spillTable(HashTable* hashTable) {
+  SpillState* state = hashTable->overflowContext;
+  int used = compactRows(hashTable);
+
+  qsort(hashTable->table, used, sizeof(HashNode), compareKeys);
+  if (writeRun(state, hashTable->table, used, RUN_BY_KEY) != 0) {
+    // no room on disk: give up the limit and go on counting in memory
+    HashNode* nodes = hashTable->table;
+    state->failed = 1;
+    hashTable->maxRows = 0;
+    if (hashTable->rowCount < HASH_MAX_ROWS) hashTable->rowCount *= 2;
+    hashTable->table = calloc(hashTable->rowCount, sizeof(HashNode));
+    for (int i = 0; i < used; i++) expansionInsert(hashTable->table, hashTable->rowCount, &nodes[i]);
+    free(nodes);
+    return;
+  }
+  memset(hashTable->table, 0, sizeof(HashNode) * hashTable->rowCount);
+  hashTable->uniqueCount = 0;
+}
+
+// limit a HashTable to a memory budget, spilling runs past it:
+void startSpilling(HashTable* hashTable, SpillState* state, long long memoryBytes, const char* directory) {
+  int maxRows = INITIAL_HASH_SIZE;
+  while (maxRows <= INT_MAX / 2 && (long long) sizeof(HashNode) * maxRows * 2 <= memoryBytes) {
+    maxRows *= 2;
+  }
+
+  memset(state, 0, sizeof(SpillState));
+  state->directory = directory;
+  state->memoryBytes = memoryBytes;
+  hashTable->maxRows = maxRows;
+  hashTable->overflow = spillTable;
+  hashTable->overflowContext = state;
+}
+
+// read the next record of a run into reader->node; returns 0 at its end
+static int nextRecord(RunReader* reader) {
+  unsigned long long first, second;
+
+  if (reader->remaining == 0 || !readNumber(reader->file, &first) || !readNumber(reader->file, &second)) {
+    return 0;
+  }
+  reader->remaining--;
+  if (reader->order == RUN_BY_KEY) {
+    reader->node.key += first;
+    reader->node.count = second;
+  } else {
+    reader->node.key = first == 0 ? reader->node.key + second : second;
+    reader->node.count -= first;
+  }
+  return 1;
+}
+
+// move heap[i] away from the root while a child comes before it
+static void siftMerge(RunMerge* merge, int i) {
+  RunReader* reader = merge->heap[i];
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= merge->size) break;
+    if (child + 1 < merge->size && merge->before(&merge->heap[child + 1]->node, &merge->heap[child]->node)) {
+      child++;
+    }
+    if (!merge->before(&merge->heap[child]->node, &reader->node)) break;
+    merge->heap[i] = merge->heap[child];
+    i = child;
+  }
+  merge->heap[i] = reader;
+}
+
+// start merging every run of the given order
+static int openMerge(RunMerge* merge, SpillState* state, int order) {
+  size_t bufferSize;
+  int i;
+
+  merge->readers = malloc(sizeof(RunReader) * (state->runCount ? state->runCount : 1));
+  merge->heap = malloc(sizeof(RunReader*) * (state->runCount ? state->runCount : 1));
+  merge->before = order == RUN_BY_KEY ? keyBefore : countBefore;
+  merge->count = merge->size = 0;
+  for (i = 0; i < state->runCount; i++) {
+    if (state->runs[i].order == order) merge->count++;
+  }
+
+  // share half of the budget between the read buffers
+  bufferSize = state->memoryBytes / 2 / (merge->count ? merge->count : 1);
+  if (bufferSize < SPILL_MIN_READ_BUFFER) bufferSize = SPILL_MIN_READ_BUFFER;
+  if (bufferSize > SPILL_BUFFER_SIZE) bufferSize = SPILL_BUFFER_SIZE;
+
+  merge->count = 0;
+  for (i = 0; i < state->runCount; i++) {
+    if (state->runs[i].order != order) continue;
+    RunReader* reader = &merge->readers[merge->count];
+    lseek(state->runs[i].fd, 0, SEEK_SET);
+    if ((reader->file = fdopen(dup(state->runs[i].fd), "r")) == NULL) return -1;
+    setvbuf(reader->file, NULL, _IOFBF, bufferSize);
+    reader->order = order;
+    reader->remaining = state->runs[i].records;
+    reader->node.key = 0;
+    reader->node.count = INT_MAX;
+    merge->count++;
+    if (nextRecord(reader)) merge->heap[merge->size++] = reader;
+  }
+  for (i = merge->size / 2 - 1; i >= 0; i--) siftMerge(merge, i);
+  return 0;
+}
+
+// take the next record of a merge (with the counts of equal keys added
+// up when merging by key); returns 0 once every run is used up
+static int nextMerged(RunMerge* merge, HashNode* node) {
+  if (merge->size == 0) return 0;
+  *node = merge->heap[0]->node;
+  for (;;) {
+    // advance the reader the record came from
+    if (!nextRecord(merge->heap[0])) merge->heap[0] = merge->heap[--merge->size];
+    if (merge->size > 0) siftMerge(merge, 0);
+    if (merge->before != keyBefore || merge->size == 0 || merge->heap[0]->node.key != node->key) break;
+    node->count += merge->heap[0]->node.count;
+  }
+  return 1;
+}
+
+// close the readers of a merge
+static void closeMerge(RunMerge* merge) {
+  for (int i = 0; i < merge->count; i++) fclose(merge->readers[i].file);
+  free(merge->readers);
+  free(merge->heap);
+}
+
+// print one pair re-keyed by word rank
+static void printRanked(Output* output, Dictionary* dict, HashNode* node) {
+  writePair(output, dict, node->count, dict->order[PAIR_FIRST(node->key)],
+            dict->order[PAIR_SECOND(node->key)]);
+}
+
+// print every pair of the runs and the table:
+int printSpilled(HashTable* hashTable, SpillState* state, int displayCount) {
+  Dictionary* dict = hashTable->dict;
+  HashNode* buffer = hashTable->table; // the table's rows sort pairs for output
+  int bufferSize = hashTable->rowCount, buffered = 0;
+  RunMerge merge;
+  HashNode node;
+
+  if (state->runCount == 0) {
+    printSortedHashTable(hashTable, displayCount);
+    return 0;
+  }
+  if (displayCount == 0) return 0;
+
+  // the rest of the table becomes the last run by key
+  int used = compactRows(hashTable);
+  qsort(hashTable->table, used, sizeof(HashNode), compareKeys);
+  if (writeRun(state, hashTable->table, used, RUN_BY_KEY) != 0) return -1;
+  memset(hashTable->table, 0, sizeof(HashNode) * hashTable->rowCount);
+  hashTable->uniqueCount = 0;
+
+  sortDictionary(dict);
+  if (openMerge(&merge, state, RUN_BY_KEY) != 0) {
+    closeMerge(&merge);
+    return -1;
+  }
+
+  // only the top pairs are wanted: keep the best of them in a TopK
+  if (displayCount > 0) {
+    TopK top;
+    initTopK(&top, displayCount, dict);
+    while (nextMerged(&merge, &node)) updateTopK(&top, node.key, node.count);
+    closeMerge(&merge);
+    StatTimer timer = startTimer(PHASE_OUTPUT);
+    printTopK(&top, -1);
+    stopTimer(timer);
+    freeTopK(&top);
+    return 0;
+  }
+
+  // every pair is wanted: sort them into output order one buffer at a
+  // time, spilling each sorted buffer as a run by count
+  StatTimer timer = startTimer(PHASE_SORT);
+  while (nextMerged(&merge, &node)) {
+    buffer[buffered].key = PAIR_KEY(dict->rank[PAIR_FIRST(node.key)], dict->rank[PAIR_SECOND(node.key)]);
+    buffer[buffered++].count = node.count;
+    if (buffered == bufferSize) {
+      qsort(buffer, buffered, sizeof(HashNode), compare);
+      if (writeRun(state, buffer, buffered, RUN_BY_COUNT) != 0) {
+        closeMerge(&merge);
+        return -1;
+      }
+      buffered = 0;
+    }
+  }
+  closeMerge(&merge);
+  qsort(buffer, buffered, sizeof(HashNode), compare);
+  stopTimer(timer);
+
+  timer = startTimer(PHASE_OUTPUT);
+  int countRuns = 0;
+  for (int i = 0; i < state->runCount; i++) countRuns += state->runs[i].order == RUN_BY_COUNT;
+  if (countRuns != 0) {
+    if (writeRun(state, buffer, buffered, RUN_BY_COUNT) != 0) return -1;
+    if (openMerge(&merge, state, RUN_BY_COUNT) != 0) {
+      closeMerge(&merge);
+      return -1;
+    }
+  }
+  Output output;
+  openOutput(&output, 1);
+  if (countRuns == 0) {
+    for (int i = 0; i < buffered; i++) printRanked(&output, dict, &buffer[i]);
+  } else {
+    while (nextMerged(&merge, &node)) printRanked(&output, dict, &node);
+    closeMerge(&merge);
+  }
+  closeOutput(&output);
+  memset(buffer, 0, sizeof(HashNode) * bufferSize);
+  stopTimer(timer);
+  return 0;
+}
+
+// delete the runs and lift the row limit:
+void stopSpilling(HashTable* hashTable, SpillState* state) {
+  for (int i = 0; i < state->runCount; i++) close(state->runs[i].fd);
+  free(state->runs);
+  state->runs = NULL;
+  state->runCount = state->runCapacity = 0;
+  hashTable->maxRows = 0;
+  hashTable->overflow = NULL;
+  hashTable->overflowContext = NULL;
+}
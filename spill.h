@@ -0,0 +1,76 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdio.h>
+#include "hash.h"
+
+#ifndef SPILL_BUFFER_SIZE
+#define SPILL_BUFFER_SIZE (1 << 20) // stdio buffer of a run being written
+#endif
+
+#ifndef SPILL_MIN_READ_BUFFER
+#define SPILL_MIN_READ_BUFFER (64 << 10) // smallest read buffer of a run being merged
+#endif
+
+#define RUN_BY_KEY 0 // run sorted by pair key (as spilled by the table)
+#define RUN_BY_COUNT 1 // run sorted into output order (see compare())
+
+typedef struct _spillRun {
+  int fd; // unlinked temporary file holding the run
+  int order; // RUN_BY_KEY or RUN_BY_COUNT
+  long long records; // # of (key, count) records in the run
+} SpillRun;
+
+typedef struct _spillState {
+  const char* directory; // where run files are created
+  long long memoryBytes; // memory budget for pairs
+  SpillRun* runs; // runs written so far
+  int runCount; // # of runs
+  int runCapacity; // allocated length of runs[]
+  int failed; // a run could not be written; counting went on in memory
+} SpillState;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  bound a HashTable: startSpilling(HashTable*, SpillState*,
+// **                                   long long, const char*)
+// **  print every pair: printSpilled(HashTable*, SpillState*, int)
+// **  remove the runs: stopSpilling(HashTable*, SpillState*)
+// **
+// ** Spilling keeps exact counts of more distinct pairs than fit in
+// ** memory. The HashTable may only grow to the memory budget; when it
+// ** is full, its pairs are sorted by key and written to a temporary run
+// ** file, and the table is emptied and refilled. The Dictionary is
+// ** kept, so a key means the same pair in every run.
+// **
+// ** Printing merges the runs and what is left in the table with a
+// ** k-way merge that adds up the counts of equal keys. Each pair then
+// ** goes through a TopK when only the top pairs are printed, or is
+// ** sorted into output order with the same sort-spill-merge scheme
+// ** (using the table's rows as the sort buffer) when every pair is
+// ** printed, so the pairs are never all in memory at once.
+// **
+// ** Runs are written and read sequentially through large buffers.
+// ** Records are compressed like sorted keys are prefix-compressed: a
+// ** record holds the difference from the previous key (and count) as
+// ** a variable-length integer, which is a byte or two for most pairs.
+
+// startSpilling() limits the HashTable's rows to about the given number
+// of bytes (at least INITIAL_HASH_SIZE rows) and makes it spill sorted
+// runs into the named directory instead of growing past that. Run files
+// are unlinked as soon as they are created, so none are left behind.
+void startSpilling(HashTable*, SpillState*, long long, const char*);
+
+// printSpilled() prints the given number of pairs (-1 prints all) of
+// every run and the table in the same "count word1 word2" format and
+// order as printSortedHashTable(). The table is left empty. The function
+// returns 0 on success and -1 (with errno set) if a temporary file
+// cannot be written.
+int printSpilled(HashTable*, SpillState*, int);
+
+// stopSpilling() closes (and so deletes) every run and lifts the
+// HashTable's row limit.
+void stopSpilling(HashTable*, SpillState*);
+
+#endif
@@ -0,0 +1,142 @@
+#include "stats.h"
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// ************************************************
+// ************************************************
+// ** stats.c keeps the counters behind --stats.
+// ** Phases are timed with clock_gettime() at
+// ** their boundaries only; the table health
+// ** figures are derived from the HashTable when
+// ** the report is printed.
+// **
+// ** See stats.h for more information on each
+// ** individual function.
+
+RunStats runStats;
+
+static const char* phaseNames[STAT_PHASES] = { "count", "merge", "expand", "sort", "output", "load", "save", "spill" };
+
+// read a clock in nanoseconds
+static long long readClock(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// expand() runs on the thread that owns the table, every other phase
+// on the main thread while any worker threads are running
+static clockid_t cpuClock(StatPhase phase) {
+  return phase == PHASE_EXPAND ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID;
+}
+
+// start timing a phase:
+StatTimer startTimer(StatPhase phase) {
+  StatTimer timer;
+  timer.phase = phase;
+  timer.wallStart = readClock(CLOCK_MONOTONIC);
+  timer.cpuStart = readClock(cpuClock(phase));
+  return timer;
+}
+
+// charge the time since startTimer() to the phase:
+void stopTimer(StatTimer timer) {
+  PhaseTime* phase = &runStats.phases[timer.phase];
+  addStat(&phase->wallNanos, readClock(CLOCK_MONOTONIC) - timer.wallStart);
+  addStat(&phase->cpuNanos, readClock(cpuClock(timer.phase)) - timer.cpuStart);
+  addStat(&phase->calls, 1);
+}
+
+// add to a counter shared by every thread:
+void addStat(long long* counter, long long value) {
+  __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+// bucket of a probe length (see STATS_PROBE_BUCKETS)
+static int probeBucket(unsigned long long probes) {
+  unsigned long long limit = 8; // upper end of bucket 4
+  int bucket = 4;
+
+  if (probes <= 4) return probes - 1;
+  while (probes > limit && bucket < STATS_PROBE_BUCKETS - 1) {
+    limit <<= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static const char* bucketNames[STATS_PROBE_BUCKETS] = { "1", "2", "3", "4", "5-8", "9-16", "17-32", "33+" };
+
+// print the report of the run:
+void printStats(FILE* out, HashTable* hashTable, int json) {
+  long long histogram[STATS_PROBE_BUCKETS] = { 0 };
+  unsigned long long mask;
+  unsigned long long probes, totalProbes = 0, longestProbe = 0;
+  struct rusage usage;
+  double seconds;
+  int i;
+
+  // a key found at its home row takes 1 probe, each row it was
+  // displaced by takes one more
+  finishResize(hashTable);
+  mask = hashTable->rowCount - 1;
+  for (unsigned long long r = 0; r < (unsigned long long) hashTable->rowCount; r++) {
+    if (hashTable->table[r].count == 0) continue;
+    probes = ((r - HOME_ROW(hashKey(hashTable->table[r].key), hashTable->rowCount)) & mask) + 1;
+    histogram[probeBucket(probes)]++;
+    totalProbes += probes;
+    if (probes > longestProbe) longestProbe = probes;
+  }
+  getrusage(RUSAGE_SELF, &usage);
+
+  double meanProbe = hashTable->uniqueCount ? (double) totalProbes / hashTable->uniqueCount : 0;
+  PhaseTime* expand = &runStats.phases[PHASE_EXPAND];
+
+  if (json) {
+    fprintf(out, "{\"phases\":{");
+    for (i = 0; i < STAT_PHASES; i++) {
+      fprintf(out, "%s\"%s\":{\"wall_seconds\":%.6f,\"cpu_seconds\":%.6f,\"calls\":%lld}",
+              i ? "," : "", phaseNames[i], runStats.phases[i].wallNanos / 1e9,
+              runStats.phases[i].cpuNanos / 1e9, runStats.phases[i].calls);
+    }
+    fprintf(out, "},\"files\":%lld,\"cached_files\":%lld,\"bytes_read\":%lld,\"words\":%lld,\"pairs\":%lld,\"unique_pairs\":%d,"
+            "\"distinct_words\":%d,\"resizes\":%lld,\"resize_rows_moved\":%lld,\"rows\":%d,"
+            "\"spill_runs\":%lld,\"spill_bytes\":%lld,\"stolen_tasks\":%lld,\"load_factor\":%.4f,\"mean_probe\":%.3f,\"max_probe\":%llu,\"probe_histogram\":{",
+            runStats.fileCount, runStats.cachedFiles, runStats.bytesRead, runStats.wordsRead, hashTable->entryCount,
+            hashTable->uniqueCount, hashTable->dict->wordCount, expand->calls, runStats.rowsMoved,
+            hashTable->rowCount, runStats.spillRuns, runStats.spillBytes, runStats.stolenTasks,
+            calcLoadFactor(hashTable), meanProbe, longestProbe);
+    for (i = 0; i < STATS_PROBE_BUCKETS; i++) {
+      fprintf(out, "%s\"%s\":%lld", i ? "," : "", bucketNames[i], histogram[i]);
+    }
+    fprintf(out, "},\"peak_rss_kb\":%ld}\n", usage.ru_maxrss);
+    return;
+  }
+
+  fprintf(out, "phase        wall (s)     cpu (s)   calls\n");
+  for (i = 0; i < STAT_PHASES; i++) {
+    fprintf(out, "%-8s %12.6f %11.6f %7lld%s\n", phaseNames[i], runStats.phases[i].wallNanos / 1e9,
+            runStats.phases[i].cpuNanos / 1e9, runStats.phases[i].calls,
+            i == PHASE_MERGE ? "   (within count)" : i == PHASE_EXPAND ? "   (within count/merge/load)" : "");
+  }
+  seconds = runStats.phases[PHASE_COUNT].wallNanos / 1e9;
+  fprintf(out, "files %lld (%lld more from cache), bytes read %lld (%.1f MB/s counted), words %lld, pairs %lld\n",
+          runStats.fileCount, runStats.cachedFiles, runStats.bytesRead, seconds > 0 ? runStats.bytesRead / seconds / 1e6 : 0.0,
+          runStats.wordsRead, hashTable->entryCount);
+  if (runStats.stolenTasks != 0) {
+    fprintf(out, "stolen tasks %lld (files or parts of files moved between -j workers)\n", runStats.stolenTasks);
+  }
+  fprintf(out, "unique pairs %d, distinct words %d\n", hashTable->uniqueCount, hashTable->dict->wordCount);
+  fprintf(out, "resizes %lld (%lld rows moved, %.6f s), rows %d, load factor %.4f\n",
+          expand->calls, runStats.rowsMoved, expand->wallNanos / 1e9, hashTable->rowCount,
+          calcLoadFactor(hashTable));
+  if (runStats.spillRuns != 0) {
+    fprintf(out, "spilled %lld runs (%lld bytes)\n", runStats.spillRuns, runStats.spillBytes);
+  }
+  fprintf(out, "probe length: mean %.3f, max %llu\n", meanProbe, longestProbe);
+  for (i = 0; i < STATS_PROBE_BUCKETS; i++) {
+    fprintf(out, "  %-6s %12lld\n", bucketNames[i], histogram[i]);
+  }
+  fprintf(out, "peak memory %ld KB\n", usage.ru_maxrss);
+}
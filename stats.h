@@ -0,0 +1,82 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "hash.h"
+
+#define STATS_PROBE_BUCKETS 8 // probe lengths 1, 2, 3, 4, 5-8, 9-16, 17-32, 33+
+
+typedef enum _statPhase {
+  PHASE_COUNT, // reading, tokenizing, interning and inserting (one fused pass)
+  PHASE_MERGE, // combining per-thread tables (-j), part of the count phase
+  PHASE_EXPAND, // expand() calls, part of the count, merge and load phases
+  PHASE_SORT, // arrayDump()/topDump()/buildSuccessorIndex()
+  PHASE_OUTPUT, // printing the sorted pairs
+  PHASE_LOAD, // merging snapshots (--load)
+  PHASE_SAVE, // writing a snapshot (--save)
+  PHASE_SPILL, // writing sorted runs to disk (--mem without --approx)
+  STAT_PHASES // # of phases
+} StatPhase;
+
+typedef struct _phaseTime {
+  long long wallNanos; // wall clock time spent in the phase
+  long long cpuNanos; // CPU time (all threads of the process; the expanding
+                      // thread only for PHASE_EXPAND)
+  long long calls; // # of times the phase was entered
+} PhaseTime;
+
+typedef struct _runStats {
+  PhaseTime phases[STAT_PHASES];
+  long long bytesRead; // input bytes read/mapped
+  long long wordsRead; // words found in the input
+  long long rowsMoved; // HashNodes copied by expand()
+  long long fileCount; // files counted
+  long long cachedFiles; // files whose counts were reused from a cache (--cache)
+  long long spillRuns; // runs written to disk (see spill.h)
+  long long spillBytes; // bytes in those runs
+  long long stolenTasks; // files (or parts) a -j worker stole from another's deque
+} RunStats;
+
+typedef struct _statTimer {
+  StatPhase phase; // phase the time is charged to
+  long long wallStart; // wall clock reading when the timer started
+  long long cpuStart; // CPU clock reading when the timer started
+} StatTimer;
+
+// process-wide counters, updated by hash.c and ingest.c
+extern RunStats runStats;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  time a phase: startTimer(StatPhase) ... stopTimer(StatTimer)
+// **  add to a counter: addStat(long long*, long long)
+// **  report on a run: printStats(FILE*, HashTable*, int)
+// **
+// ** The counters are always kept: each timer costs a few clock
+// ** reads per phase (and per expand()), never per word or pair,
+// ** so leaving them on costs nothing measurable. Counters are
+// ** updated atomically because -j threads expand their tables
+// ** concurrently. The probe-length histogram and load factor are
+// ** only computed, with one scan of the table, when printStats()
+// ** is called.
+
+// startTimer() reads the clocks at the start of a phase and returns
+// the readings; pass them to stopTimer() when the phase ends.
+StatTimer startTimer(StatPhase);
+
+// stopTimer() charges the wall and CPU time since startTimer() to the
+// timer's phase.
+void stopTimer(StatTimer);
+
+// addStat() atomically adds a value to one of runStats' counters.
+void addStat(long long*, long long);
+
+// printStats() writes the report of the run to the given stream: time
+// per phase, resizes, bytes/words/pairs counted, the HashTable's load
+// factor and probe-length histogram, and the peak resident memory of
+// the process. The third argument selects the format: 0 prints aligned
+// text, 1 prints a single JSON object.
+void printStats(FILE*, HashTable*, int);
+
+#endif
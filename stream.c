@@ -0,0 +1,210 @@
+#include "stream.h"
+#include "hash.h"
+#include "topK.h"
+#include "getWord.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+// ************************************************
+// ************************************************
+// ** stream.c is the streaming mode of wordpairs:
+// ** a running count over a live input with
+// ** periodic top K snapshots and an optional
+// ** sliding window. See stream.h for details.
+
+#define CLOCK_CHECK_MASK 1023 // look at the clock every 1024 pairs
+
+// seconds on the monotonic clock
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// a window slice: a HashTable that counts pairs keyed by the ids of the
+// stream's Dictionary, which it shares instead of having its own
+static HashTable* createSlice(Dictionary* dict) {
+  HashTable* slice = initHashTable();
+  destroyDictionary(slice->dict);
+  slice->dict = dict;
+  return slice;
+}
+
+// free a slice, leaving the shared Dictionary alone
+static void destroySlice(HashTable* slice) {
+  free(slice->oldTable);
+  free(slice->table);
+  free(slice);
+}
+
+// the id in the new Dictionary of a word of the old one, interning it
+// the first time it is asked for
+static unsigned int remapWord(Dictionary* into, Dictionary* from, unsigned int* remap, unsigned int id) {
+  if (remap[id] == DICT_EMPTY) remap[id] = internWord(into, from->words[id], from->lengths[id]);
+  return remap[id];
+}
+
+// add every pair of a table to another, re-keyed into its Dictionary
+static void rekeyPairs(HashTable* into, HashTable* from, Dictionary* fromDict, unsigned int* remap) {
+  finishResize(from);
+  for (int r = 0; r < from->rowCount; r++) {
+    HashNode* node = &from->table[r];
+    if (node->count > 0) {
+      insertCount(into, PAIR_KEY(remapWord(into->dict, fromDict, remap, PAIR_FIRST(node->key)),
+                                 remapWord(into->dict, fromDict, remap, PAIR_SECOND(node->key))),
+                  node->count);
+    }
+  }
+}
+
+// replace the table by one whose Dictionary only holds the words of the
+// pairs still in the window (and the word the next pair starts with),
+// re-keying the slices and rebuilding the TopK to match
+static HashTable* compactWords(HashTable* hashTable, HashTable** slices, unsigned int* previousWord,
+                               int havePrevious, TopK* top) {
+  Dictionary* oldDict = hashTable->dict;
+  unsigned int* remap = malloc(sizeof(unsigned int) * (oldDict->wordCount ? oldDict->wordCount : 1));
+  HashTable* compacted = sizedHashTable(hashTable->uniqueCount);
+
+  for (int i = 0; i < oldDict->wordCount; i++) remap[i] = DICT_EMPTY;
+  if (havePrevious) *previousWord = remapWord(compacted->dict, oldDict, remap, *previousWord);
+  rekeyPairs(compacted, hashTable, oldDict, remap);
+  for (int i = 0; i < STREAM_WINDOW_SLICES; i++) {
+    HashTable* slice = createSlice(compacted->dict);
+    rekeyPairs(slice, slices[i], oldDict, remap);
+    destroySlice(slices[i]);
+    slices[i] = slice;
+  }
+  free(remap);
+  destroy(hashTable);
+
+  int topCount = top->capacity;
+  freeTopK(top);
+  initTopK(top, topCount, compacted->dict);
+  fillTopK(top, compacted);
+  return compacted;
+}
+
+// count a stream and print snapshots:
+int streamPairs(const char* path, StreamOptions* options) {
+  WordReader reader; // tokenizer over the stream
+  const char* word; // current word, a slice into the reader
+  int wordLength; // length of current word (or WORD_TIMEOUT)
+  unsigned int previousWord = 0; // id of the first word of the next pair
+  int havePrevious = 0; // previousWord is set
+  long long pairCount = 0; // pairs counted so far
+  long long pairsAtSnapshot = 0; // pairCount at the last snapshot
+  int snapshotCount = 0;
+  HashTable* slices[STREAM_WINDOW_SLICES] = { NULL }; // window slices (ring)
+  int currentSlice = 0; // slice new pairs are counted into
+  double sliceSeconds = options->windowSeconds / STREAM_WINDOW_SLICES;
+  int compactAt = STREAM_COMPACT_WORDS; // compact the Dictionary once it has this many words
+  TopK top;
+
+  if (path != NULL) {
+    if (openWordReader(&reader, path) != 0) return -1;
+  } else if (openWordReaderFd(&reader, 0) != 0) {
+    return -1;
+  }
+  reader.timeout = STREAM_POLL_MS;
+
+  HashTable* hashTable = options->expectUnique > 0 ? sizedHashTable(options->expectUnique) : initHashTable();
+  // with a window, counts go down, and the pairs kept beyond the top
+  // count are what spares rebuilding the TopK every slice
+  int keep = options->topCount;
+  if (options->windowSeconds > 0 && keep <= INT_MAX / STREAM_TOP_SLACK) keep *= STREAM_TOP_SLACK;
+  initTopK(&top, keep, hashTable->dict);
+  if (options->windowSeconds > 0) {
+    for (int i = 0; i < STREAM_WINDOW_SLICES; i++) slices[i] = createSlice(hashTable->dict);
+  }
+
+  double start = now();
+  double nextSnapshot = start + options->intervalSeconds;
+  double nextSlice = start + sliceSeconds;
+
+  for (;;) {
+    wordLength = getNextWordSlice(&reader, &word);
+    if (wordLength == 0) break; // end of input
+
+    if (wordLength > 0) {
+      unsigned int currentWord = internWord(hashTable->dict, word, wordLength);
+      if (havePrevious) {
+        unsigned long long key = PAIR_KEY(previousWord, currentWord);
+        updateTopK(&top, key, insert(hashTable, key));
+        if (slices[0] != NULL) insert(slices[currentSlice], key);
+        pairCount++;
+      }
+      previousWord = currentWord;
+      havePrevious = 1;
+
+      // only look at the clock every so often while input is pouring
+      // in, but always once the input that has arrived is used up
+      if ((options->intervalPairs == 0 || pairCount - pairsAtSnapshot < options->intervalPairs)
+          && (pairCount & CLOCK_CHECK_MASK) != 0 && reader.pos < reader.size) {
+        continue;
+      }
+    }
+
+    // a pair interval was reached, 1024 pairs went by, or input paused
+    double time = now();
+    if (slices[0] != NULL && time >= nextSlice) {
+      // expire every slice that has fallen out of the window (after a
+      // long pause that is all of them, however many slices went by)
+      for (int step = 0; time >= nextSlice; step++) {
+        if (step == STREAM_WINDOW_SLICES) {
+          nextSlice = time + sliceSeconds;
+          break;
+        }
+        currentSlice = (currentSlice + 1) % STREAM_WINDOW_SLICES;
+        HashTable* expired = slices[currentSlice];
+        finishResize(expired);
+        for (int r = 0; r < expired->rowCount; r++) {
+          if (expired->table[r].count != 0) {
+            unsigned long long key = expired->table[r].key;
+            lowerTopK(&top, key, subtractCount(hashTable, key, expired->table[r].count));
+          }
+        }
+        memset(expired->table, 0, sizeof(HashNode) * expired->rowCount); // reuse it
+        expired->entryCount = 0;
+        expired->uniqueCount = 0;
+        nextSlice += sliceSeconds;
+      }
+      if (hashTable->dict->wordCount >= compactAt) {
+        // most of the words may only be in pairs that have expired
+        hashTable = compactWords(hashTable, slices, &previousWord, havePrevious, &top);
+        compactAt = 2 * hashTable->dict->wordCount > STREAM_COMPACT_WORDS ?
+          2 * hashTable->dict->wordCount : STREAM_COMPACT_WORDS;
+      } else if (!exactTopK(&top, options->topCount)) {
+        fillTopK(&top, hashTable); // a pair outside the TopK may have overtaken one in it
+      }
+    }
+    if ((options->intervalPairs > 0 && pairCount - pairsAtSnapshot >= options->intervalPairs)
+        || (options->intervalSeconds > 0 && time >= nextSnapshot)) {
+      printf("# snapshot %d: %lld pairs, %d unique, %.3f seconds\n",
+             ++snapshotCount, hashTable->entryCount, hashTable->uniqueCount, time - start);
+      printTopK(&top, options->topCount);
+      fflush(stdout);
+      pairsAtSnapshot = pairCount;
+      while (options->intervalSeconds > 0 && nextSnapshot <= time) {
+        nextSnapshot += options->intervalSeconds;
+      }
+    }
+  }
+
+  // final snapshot at end of input
+  printf("# snapshot %d: %lld pairs, %d unique, %.3f seconds\n",
+         ++snapshotCount, hashTable->entryCount, hashTable->uniqueCount, now() - start);
+  printTopK(&top, options->topCount);
+  fflush(stdout);
+
+  closeWordReader(&reader);
+  freeTopK(&top);
+  for (int i = 0; i < STREAM_WINDOW_SLICES; i++) {
+    if (slices[i] != NULL) destroySlice(slices[i]);
+  }
+  destroy(hashTable);
+  return 0;
+}
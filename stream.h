@@ -0,0 +1,72 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#ifndef STREAM_DEFAULT_TOP
+#define STREAM_DEFAULT_TOP 10 // pairs per snapshot when no -count is given
+#endif
+
+#ifndef STREAM_DEFAULT_INTERVAL
+#define STREAM_DEFAULT_INTERVAL 10.0 // seconds between snapshots by default
+#endif
+
+#ifndef STREAM_WINDOW_SLICES
+#define STREAM_WINDOW_SLICES 10 // a sliding window expires in this many steps
+#endif
+
+#ifndef STREAM_COMPACT_WORDS
+#define STREAM_COMPACT_WORDS 65536 // fewest words a window's Dictionary is compacted at
+#endif
+
+#ifndef STREAM_TOP_SLACK
+#define STREAM_TOP_SLACK 2 // a window's TopK keeps this many times K pairs
+#endif
+
+#define STREAM_POLL_MS 100 // how long to wait for input before checking the clock
+
+typedef struct _streamOptions {
+  int topCount; // K, the # of pairs in each snapshot
+  double intervalSeconds; // snapshot every this many seconds (0 = never)
+  long long intervalPairs; // snapshot every this many pairs (0 = never)
+  double windowSeconds; // only count pairs this recent (0 = count all)
+  int expectUnique; // size the table for this many unique pairs (0 = grow as needed)
+} StreamOptions;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  count a live stream: streamPairs(const char*, StreamOptions*)
+// **
+// ** Streaming mode reads words from stdin or a FIFO as they arrive
+// ** and keeps a running pair count. Every intervalSeconds and/or
+// ** intervalPairs it prints a snapshot of the current top K pairs:
+// **
+// **   # snapshot N: P pairs, U unique, T seconds
+// **   followed by K "count word1 word2" lines
+// **
+// ** The top K is kept up to date with a TopK (see topK.h), so taking
+// ** a snapshot never scans or sorts the table.
+// **
+// ** With a window, the pairs of each 1/STREAM_WINDOW_SLICES of the
+// ** window are also counted into a table of their own. When a slice
+// ** falls out of the window its counts are subtracted, and each pair
+// ** subtracted is reported to the TopK, so expiring a slice costs time
+// ** in proportion to the slice, not to the whole table. The TopK keeps
+// ** STREAM_TOP_SLACK times K pairs and is only rebuilt from the table
+// ** when fewer than K of them still sort before the best pair it has
+// ** seen outside (see exactTopK() in topK.h), as then a pair whose
+// ** lower count it never saw may have overtaken one of the K. The slices
+// ** are emptied and reused, and key their pairs by the ids of the
+// ** stream's one Dictionary. Words whose pairs have all expired stay
+// ** in the Dictionary until it reaches STREAM_COMPACT_WORDS words, or
+// ** twice as many as it had after it was last compacted; it is then
+// ** rebuilt with only the words of the pairs still in the window (and
+// ** the table and slices re-keyed). A long run thus takes memory in
+// ** proportion to the window's vocabulary, not to every word it saw.
+
+// streamPairs() counts the stream named by the first argument (stdin
+// if it is NULL) until end of input, printing snapshots as described
+// above and a final one at the end. It returns 0, or -1 (with errno
+// set) if the stream cannot be opened.
+int streamPairs(const char*, StreamOptions*);
+
+#endif
@@ -0,0 +1,251 @@
+#include "successor.h"
+#include "output.h"
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <pthread.h>
+
+// ************************************************
+// ************************************************
+// ** successor.c builds the CSR index of which
+// ** words follow which: the used rows of the
+// ** HashTable are split into one slice per
+// ** thread, each thread counts the pairs of its
+// ** slice by first word, the counts of every
+// ** slice are laid end to end (word by word,
+// ** slice by slice) to give each slice its own
+// ** positions in every row, and each thread then
+// ** places its pairs and sorts its share of the
+// ** rows.
+// **
+// ** See successor.h for more information on each
+// ** individual function.
+
+// rows (and parts of rows) this short are sorted by insertion
+#define SUCCESSOR_INSERTION_MAX 16
+
+// what the threads of one buildSuccessorIndex() share
+typedef struct _successorShared {
+  HashTable* hashTable; // the counted pairs
+  SuccessorIndex* index; // being built
+  int threadCount; // # of slices (and threads)
+  int* positions; // wordCount counters, then next positions, per slice
+  pthread_barrier_t barrier; // between the steps of the build
+} SuccessorShared;
+
+// one thread's part of a buildSuccessorIndex()
+typedef struct _successorSlice {
+  SuccessorShared* shared;
+  int index; // which slice of the table is this thread's
+} SuccessorSlice;
+
+// wait for every thread of the build (if there are others)
+static void successorWait(SuccessorShared* shared) {
+  if (shared->threadCount > 1) pthread_barrier_wait(&shared->barrier);
+}
+
+// the order successors are printed in as one 64-bit number: highest
+// count first, then alphabetically
+static inline unsigned long long sortKey(const Successor* successor) {
+  return (unsigned long long) (unsigned int) (INT_MAX - successor->count) << 32 | successor->second;
+}
+
+// does successor s1 sort after s2?
+static inline int sortsAfter(const Successor* s1, const Successor* s2) {
+  return sortKey(s1) > sortKey(s2);
+}
+
+// sort one row into output order: quicksort (median of three pivots,
+// recursing into the shorter side) down to short runs, which are
+// finished by insertion; the comparisons are inlined, which qsort()'s
+// callback cannot be
+static void sortRow(Successor* row, int length) {
+  while (length > SUCCESSOR_INSERTION_MAX) {
+    Successor* middle = row + length / 2;
+    Successor* last = row + length - 1;
+    Successor swap;
+    if (sortsAfter(row, middle)) swap = *row, *row = *middle, *middle = swap;
+    if (sortsAfter(middle, last)) swap = *middle, *middle = *last, *last = swap;
+    if (sortsAfter(row, middle)) swap = *row, *row = *middle, *middle = swap;
+
+    Successor pivot = *middle;
+    int i = 0, j = length - 1;
+    for (;;) {
+      while (sortsAfter(&pivot, &row[i])) i++;
+      while (sortsAfter(&row[j], &pivot)) j--;
+      if (i >= j) break;
+      swap = row[i], row[i] = row[j], row[j] = swap;
+      i++;
+      j--;
+    }
+    // row[0 .. j] sort no later than the pivot, row[j + 1 ..] no earlier
+    if (j + 1 < length - j - 1) {
+      sortRow(row, j + 1);
+      row += j + 1;
+      length -= j + 1;
+    } else {
+      sortRow(row + j + 1, length - j - 1);
+      length = j + 1;
+    }
+  }
+  for (int i = 1; i < length; i++) {
+    Successor successor = row[i];
+    int j = i;
+    for (; j > 0 && sortsAfter(&row[j - 1], &successor); j--) row[j] = row[j - 1];
+    row[j] = successor;
+  }
+}
+
+// turn the counters of every slice into the position of each slice's
+// first pair in every row, and fill in rowStart[]
+static void successorPositions(SuccessorShared* shared) {
+  SuccessorIndex* index = shared->index;
+  int next = 0;
+
+  for (int r = 0; r < index->wordCount; r++) {
+    index->rowStart[r] = next;
+    for (int t = 0; t < shared->threadCount; t++) {
+      int* position = &shared->positions[(size_t) t * index->wordCount + r];
+      int pairs = *position;
+      *position = next;
+      next += pairs;
+    }
+  }
+  index->rowStart[index->wordCount] = next;
+}
+
+// the first row of a thread's share of the rows to sort: the first row
+// that starts at or after the thread's share of the pairs
+static int firstSortRow(SuccessorIndex* index, int threadCount, int t) {
+  int target = (long long) index->pairCount * t / threadCount;
+  int low = 0, high = index->wordCount; // the row is in [low, high]
+
+  if (t == threadCount) return index->wordCount;
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    if (index->rowStart[middle] < target) low = middle + 1;
+    else high = middle;
+  }
+  return low;
+}
+
+// build one slice: count its pairs by first word, place them, then sort
+// this thread's share of the rows
+static void* buildSlice(void* argument) {
+  SuccessorSlice* slice = argument;
+  SuccessorShared* shared = slice->shared;
+  SuccessorIndex* index = shared->index;
+  HashNode* table = shared->hashTable->table;
+  unsigned int* rank = index->dict->rank;
+  int rowCount = shared->hashTable->rowCount;
+  int first = (long long) rowCount * slice->index / shared->threadCount;
+  int last = (long long) rowCount * (slice->index + 1) / shared->threadCount;
+  int* positions = shared->positions + (size_t) slice->index * index->wordCount;
+
+  memset(positions, 0, sizeof(int) * index->wordCount);
+  for (int r = first; r < last; r++) {
+    if (table[r].count != 0) positions[rank[PAIR_FIRST(table[r].key)]]++;
+  }
+  successorWait(shared);
+  if (slice->index == 0) successorPositions(shared);
+  successorWait(shared);
+
+  for (int r = first; r < last; r++) {
+    if (table[r].count != 0) {
+      Successor* successor = &index->successors[positions[rank[PAIR_FIRST(table[r].key)]]++];
+      successor->second = rank[PAIR_SECOND(table[r].key)];
+      successor->count = table[r].count;
+    }
+  }
+  successorWait(shared); // every pair placed before any row is sorted
+
+  int lastRow = firstSortRow(index, shared->threadCount, slice->index + 1);
+  for (int w = firstSortRow(index, shared->threadCount, slice->index); w < lastRow; w++) {
+    sortRow(index->successors + index->rowStart[w], index->rowStart[w + 1] - index->rowStart[w]);
+  }
+  return NULL;
+}
+
+// build the index of a counted HashTable:
+void buildSuccessorIndex(SuccessorIndex* index, HashTable* hashTable, int threads) {
+  SuccessorShared shared;
+
+  finishResize(hashTable);
+  sortDictionary(hashTable->dict);
+  index->dict = hashTable->dict;
+  index->wordCount = hashTable->dict->wordCount;
+  index->pairCount = hashTable->uniqueCount;
+  index->rowStart = malloc(sizeof(int) * (index->wordCount + 1));
+  index->successors = malloc(sizeof(Successor) * (index->pairCount ? index->pairCount : 1));
+
+  // each thread gets at least SUCCESSOR_THREAD_MIN rows, and no more
+  // counters than the table has pairs are spent on the slices
+  if (threads > hashTable->rowCount / SUCCESSOR_THREAD_MIN) threads = hashTable->rowCount / SUCCESSOR_THREAD_MIN;
+  if (index->wordCount > 0 && threads > index->pairCount / index->wordCount) {
+    threads = index->pairCount / index->wordCount;
+  }
+  if (threads < 1) threads = 1;
+
+  shared.hashTable = hashTable;
+  shared.index = index;
+  shared.threadCount = threads;
+  shared.positions = malloc(sizeof(int) * threads * (index->wordCount ? index->wordCount : 1));
+  SuccessorSlice* slices = malloc(sizeof(SuccessorSlice) * threads);
+  pthread_t* workers = malloc(sizeof(pthread_t) * threads);
+  if (threads > 1) pthread_barrier_init(&shared.barrier, NULL, threads);
+
+  // slice 0 is built on the calling thread
+  for (int t = 0; t < threads; t++) {
+    slices[t].shared = &shared;
+    slices[t].index = t;
+    if (t > 0) pthread_create(&workers[t], NULL, buildSlice, &slices[t]);
+  }
+  buildSlice(&slices[0]);
+  for (int t = 1; t < threads; t++) pthread_join(workers[t], NULL);
+
+  if (threads > 1) pthread_barrier_destroy(&shared.barrier);
+  free(workers);
+  free(slices);
+  free(shared.positions);
+}
+
+// find the row of a word:
+const Successor* findSuccessors(SuccessorIndex* index, const char* word, int* count) {
+  unsigned int rank = findRank(index->dict, word);
+
+  if (rank == DICT_EMPTY) {
+    *count = 0;
+    return NULL;
+  }
+  *count = index->rowStart[rank + 1] - index->rowStart[rank];
+  return index->successors + index->rowStart[rank];
+}
+
+// print the pairs that start with a word:
+int printSuccessors(SuccessorIndex* index, const char* word, int displayCount) {
+  int count;
+  const Successor* row = findSuccessors(index, word, &count);
+  unsigned int* order = index->dict->order;
+  Output pairs;
+
+  if (displayCount == -1 || displayCount > count) displayCount = count;
+  if (displayCount == 0) return 0;
+  unsigned int firstId = order[findRank(index->dict, word)];
+  openOutput(&pairs, 1);
+  for (int i = 0; i < displayCount; i++) {
+    writePair(&pairs, index->dict, row[i].count, firstId, order[row[i].second]);
+  }
+  closeOutput(&pairs);
+  return displayCount;
+}
+
+// memory used by the index:
+size_t successorBytes(SuccessorIndex* index) {
+  return sizeof(int) * (index->wordCount + 1) + sizeof(Successor) * index->pairCount;
+}
+
+// free the arrays of the index:
+void freeSuccessorIndex(SuccessorIndex* index) {
+  free(index->rowStart);
+  free(index->successors);
+}
@@ -0,0 +1,78 @@
+#ifndef SUCCESSOR_H
+#define SUCCESSOR_H
+
+#include <stddef.h>
+#include "hash.h"
+
+#ifndef SUCCESSOR_THREAD_MIN
+#define SUCCESSOR_THREAD_MIN 65536 // fewest table rows worth handing to another thread
+#endif
+
+#define FOLLOW_DEFAULT_COUNT 10 // followers printed by --follow without -k
+
+typedef struct _successor {
+  unsigned int second; // alphabetical rank of the word that follows
+  int count; // # of occurances of the pair
+} Successor;
+
+typedef struct _successorIndex {
+  Dictionary* dict; // words of the counted table, ranked alphabetically
+  int wordCount; // # of rows (words, by rank)
+  int pairCount; // # of successors in all rows
+  int* rowStart; // successors of the word of rank r: successors[rowStart[r] .. rowStart[r + 1])
+  Successor* successors; // every row, each most frequent first
+} SuccessorIndex;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  build from a counted HashTable: buildSuccessorIndex(SuccessorIndex*, HashTable*, int)
+// **  the words that follow a word: findSuccessors(SuccessorIndex*, const char*, int*)
+// **  print the words that follow a word: printSuccessors(SuccessorIndex*, const char*, int)
+// **  memory used by the index: successorBytes(SuccessorIndex*)
+// **  free memory: freeSuccessorIndex(SuccessorIndex*)
+// **
+// ** A SuccessorIndex answers "which words follow X, and how often"
+// ** once counting is done. It is laid out as a compressed sparse row
+// ** (CSR) matrix: one row per first word, in alphabetical order, each
+// ** row a contiguous run of (second word, count) entries sorted the
+// ** way the pairs are printed (highest count first, then
+// ** alphabetically). The word X is found by binary search over the
+// ** Dictionary's alphabetical order (see findRank()), its row by two
+// ** array reads, and its top K followers are the row's first K
+// ** entries, so a query costs O(log words + K).
+// **
+// ** Each pair costs 8 bytes (and each word 4), against the 16 bytes
+// ** per table row (at most LOAD_FACTOR of which are used) that the
+// ** HashTable spends. The index is built with a counting sort of the
+// ** pairs by first word: every thread counts and then places the
+// ** pairs of its own share of the table's rows, and then sorts its own
+// ** share of the rows. Nothing in it changes once it is built, so any
+// ** number of threads may query it at once.
+
+// buildSuccessorIndex() builds the index of the pairs in a HashTable on
+// at most the given number of threads (fewer for small tables). The
+// HashTable is only read; its Dictionary is ranked (see sortDictionary())
+// and must outlive the index.
+void buildSuccessorIndex(SuccessorIndex*, HashTable*, int);
+
+// findSuccessors() returns the row of the given NUL-terminated word,
+// most frequent follower first, and stores its length through the int
+// pointer (0, with a NULL row, if the word never starts a pair).
+const Successor* findSuccessors(SuccessorIndex*, const char*, int*);
+
+// printSuccessors() prints the given number of pairs (-1 prints all of
+// them) that start with the given word, in the same "count word1 word2"
+// format (see output.h) and order as printSortedHashTable(). It returns
+// the number of pairs printed.
+int printSuccessors(SuccessorIndex*, const char*, int);
+
+// successorBytes() returns the number of bytes the arrays of the index
+// take up (not counting its Dictionary).
+size_t successorBytes(SuccessorIndex*);
+
+// freeSuccessorIndex() frees the arrays of the index (but not its
+// Dictionary).
+void freeSuccessorIndex(SuccessorIndex*);
+
+#endif
@@ -0,0 +1,233 @@
+#include "topK.h"
+#include "output.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// ************************************************
+// ************************************************
+// ** topK.c keeps the K best pairs of a growing
+// ** HashTable up to date one insert at a time.
+// ** The heap is ordered so that its root is the
+// ** worst of the K pairs; a small open addressing
+// ** index maps each key in the heap to its heap
+// ** position so that a pair already in the heap
+// ** can be found and moved when its count grows.
+// **
+// ** See topK.h for more information on each
+// ** individual function.
+
+// does pair a sort after pair b (lower count, or same count and
+// alphabetically later)?
+static int sortsAfter(TopK* top, const HashNode* a, const HashNode* b) {
+  if (a->count != b->count) return a->count < b->count;
+  if (a->key == b->key) return 0;
+  int order = strcmp(dictionaryWord(top->dict, PAIR_FIRST(a->key)),
+                     dictionaryWord(top->dict, PAIR_FIRST(b->key)));
+  if (order == 0) {
+    order = strcmp(dictionaryWord(top->dict, PAIR_SECOND(a->key)),
+                   dictionaryWord(top->dict, PAIR_SECOND(b->key)));
+  }
+  return order > 0;
+}
+
+// index slot of a key (or of the empty slot where it would go)
+static int findSlot(TopK* top, unsigned long long key) {
+  int mask = top->slotCount - 1;
+  int slot = hashKey(key) & mask;
+  while (top->slotPositions[slot] != -1 && top->slotKeys[slot] != key) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+// record that key now lives at heap[position]
+static void indexKey(TopK* top, unsigned long long key, int position) {
+  int slot = findSlot(top, key);
+  top->slotKeys[slot] = key;
+  top->slotPositions[slot] = position;
+}
+
+// remove a key from the index (backward-shift deletion, as in hash.c)
+static void unindexKey(TopK* top, unsigned long long key) {
+  int mask = top->slotCount - 1;
+  int hole = findSlot(top, key);
+  int slot = hole;
+
+  for (;;) {
+    slot = (slot + 1) & mask;
+    if (top->slotPositions[slot] == -1) break;
+    int home = hashKey(top->slotKeys[slot]) & mask;
+    if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+      top->slotKeys[hole] = top->slotKeys[slot];
+      top->slotPositions[hole] = top->slotPositions[slot];
+      hole = slot;
+    }
+  }
+  top->slotPositions[hole] = -1;
+}
+
+// move heap[i] towards the root while it sorts after its parent
+static void siftUp(TopK* top, int i) {
+  HashNode node = top->heap[i];
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!sortsAfter(top, &node, &top->heap[parent])) break;
+    top->heap[i] = top->heap[parent];
+    indexKey(top, top->heap[i].key, i);
+    i = parent;
+  }
+  top->heap[i] = node;
+  indexKey(top, node.key, i);
+}
+
+// move heap[i] away from the root while a child sorts after it
+static void siftDown(TopK* top, int i) {
+  HashNode node = top->heap[i];
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= top->size) break;
+    if (child + 1 < top->size && sortsAfter(top, &top->heap[child + 1], &top->heap[child])) {
+      child++;
+    }
+    if (!sortsAfter(top, &top->heap[child], &node)) break;
+    top->heap[i] = top->heap[child];
+    indexKey(top, top->heap[i].key, i);
+    i = child;
+  }
+  top->heap[i] = node;
+  indexKey(top, node.key, i);
+}
+
+// note a pair that is outside the heap: the bound on every pair
+// outside becomes whichever of the two sorts first
+static void noteOutside(TopK* top, const HashNode* node) {
+  if (top->outside.count == 0 || sortsAfter(top, &top->outside, node)) top->outside = *node;
+}
+
+// set up an empty TopK:
+void initTopK(TopK* top, int capacity, Dictionary* dict) {
+  if (capacity < 1) capacity = 1;
+  top->capacity = capacity;
+  top->size = 0;
+  top->heap = malloc(sizeof(HashNode) * capacity);
+  top->slotCount = 16;
+  while (top->slotCount < 2 * capacity) top->slotCount <<= 1;
+  top->slotKeys = malloc(sizeof(unsigned long long) * top->slotCount);
+  top->slotPositions = malloc(sizeof(int) * top->slotCount);
+  for (int i = 0; i < top->slotCount; i++) top->slotPositions[i] = -1;
+  top->dict = dict;
+  top->outside.count = 0;
+}
+
+// follow a pair whose count went up:
+void updateTopK(TopK* top, unsigned long long key, int count) {
+  HashNode node;
+  node.key = key;
+  node.count = count;
+
+  int slot = findSlot(top, key);
+  if (top->slotPositions[slot] != -1) {
+    // already one of the K: it can only move away from the root
+    int position = top->slotPositions[slot];
+    top->heap[position].count = count;
+    siftDown(top, position);
+  } else if (top->size < top->capacity) {
+    top->heap[top->size++] = node;
+    siftUp(top, top->size - 1);
+  } else if (sortsAfter(top, &top->heap[0], &node)) {
+    // overtakes the worst of the K, which leaves the heap
+    unindexKey(top, top->heap[0].key);
+    noteOutside(top, &top->heap[0]);
+    top->heap[0] = node;
+    siftDown(top, 0);
+  } else {
+    noteOutside(top, &node);
+  }
+}
+
+// follow a pair whose count went down:
+void lowerTopK(TopK* top, unsigned long long key, int count) {
+  int slot = findSlot(top, key);
+  if (top->slotPositions[slot] == -1) return; // outside, and only further behind now
+
+  int position = top->slotPositions[slot];
+  if (count > 0) {
+    // still one of the K as far as the heap knows: it can only move
+    // towards the root
+    top->heap[position].count = count;
+    siftUp(top, position);
+    return;
+  }
+
+  // deleted: the last pair of the heap takes its place
+  unindexKey(top, key);
+  if (position < --top->size) {
+    top->heap[position] = top->heap[top->size];
+    if (position > 0 && sortsAfter(top, &top->heap[position], &top->heap[(position - 1) / 2])) {
+      siftUp(top, position);
+    } else {
+      siftDown(top, position);
+    }
+  }
+}
+
+// are the first count pairs of the heap surely the top count pairs?
+int exactTopK(TopK* top, int count) {
+  int ahead = 0; // pairs of the heap that sort before every pair outside
+
+  if (top->outside.count == 0) return 1; // every pair is in the heap
+  for (int i = 0; i < top->size && ahead < count; i++) {
+    if (sortsAfter(top, &top->outside, &top->heap[i])) ahead++;
+  }
+  return ahead >= count;
+}
+
+// rebuild from every pair of a table:
+void fillTopK(TopK* top, HashTable* hashTable) {
+  for (int i = 0; i < top->slotCount; i++) top->slotPositions[i] = -1;
+  top->size = 0;
+  top->outside.count = 0;
+  finishResize(hashTable);
+  for (int r = 0; r < hashTable->rowCount; r++) {
+    if (hashTable->table[r].count != 0) {
+      updateTopK(top, hashTable->table[r].key, hashTable->table[r].count);
+    }
+  }
+}
+
+// print the current top K (or the first count of them) in output order:
+void printTopK(TopK* top, int count) {
+  TopK sorted = *top; // pop a copy of the heap: worst first, filled from the back
+  HashNode* output = malloc(sizeof(HashNode) * (top->size ? top->size : 1));
+
+  sorted.heap = malloc(sizeof(HashNode) * (top->size ? top->size : 1));
+  memcpy(sorted.heap, top->heap, sizeof(HashNode) * top->size);
+  sorted.slotKeys = malloc(sizeof(unsigned long long) * top->slotCount);
+  sorted.slotPositions = malloc(sizeof(int) * top->slotCount);
+  memcpy(sorted.slotKeys, top->slotKeys, sizeof(unsigned long long) * top->slotCount);
+  memcpy(sorted.slotPositions, top->slotPositions, sizeof(int) * top->slotCount);
+
+  while (sorted.size > 0) {
+    output[sorted.size - 1] = sorted.heap[0];
+    sorted.heap[0] = sorted.heap[--sorted.size];
+    if (sorted.size > 0) siftDown(&sorted, 0);
+  }
+  if (count == -1 || count > top->size) count = top->size;
+  Output pairs;
+  openOutput(&pairs, 1);
+  for (int i = 0; i < count; i++) {
+    writePair(&pairs, top->dict, output[i].count, PAIR_FIRST(output[i].key), PAIR_SECOND(output[i].key));
+  }
+  closeOutput(&pairs);
+
+  free(output);
+  freeTopK(&sorted);
+}
+
+// free a TopK:
+void freeTopK(TopK* top) {
+  free(top->heap);
+  free(top->slotKeys);
+  free(top->slotPositions);
+}
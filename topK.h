@@ -0,0 +1,76 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include "hash.h"
+
+typedef struct _topK {
+  HashNode* heap; // the best pairs so far; heap[0] is the one that sorts last
+  int size; // # of pairs in the heap
+  int capacity; // K, the # of pairs kept
+  unsigned long long* slotKeys; // open addressing index: key of each slot
+  int* slotPositions; // heap position of the key in each slot, -1 if unused
+  int slotCount; // # of index slots (a power of two, at least 2K)
+  Dictionary* dict; // words the keys refer to (for breaking ties)
+  HashNode outside; // every pair outside the heap sorts after this one (count 0: no pair is outside)
+} TopK;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  set up: initTopK(TopK*, int, Dictionary*)
+// **  report a pair's new count: updateTopK(TopK*, unsigned long long, int)
+// **  report a lower count: lowerTopK(TopK*, unsigned long long, int)
+// **  check that the heap still has the top pairs: exactTopK(TopK*, int)
+// **  rebuild from a whole table: fillTopK(TopK*, HashTable*)
+// **  print the current top K: printTopK(TopK*, int)
+// **  free memory: freeTopK(TopK*)
+// **
+// ** A TopK follows the K pairs that sort first (highest count, then
+// ** alphabetically, exactly as printSortedHashTable() orders them) while
+// ** counts only go up. Every pair outside the heap sorts after the heap's
+// ** root, so a pair can only enter when its count passes the root's,
+// ** and then it simply takes the root's place. Each update costs
+// ** O(log K) and printing costs O(K log K), however large the table is.
+// **
+// ** Counts that go down are followed too, but only as far as the heap
+// ** can tell: a pair in the heap is moved towards the root (or taken
+// ** out at 0), and the TopK remembers the pair that sorts first of
+// ** every pair it has seen leave, or stay out of, the heap. The pairs of
+// ** the heap that still sort before that one are surely the best; once
+// ** there are fewer of them than are printed, only a scan of the table
+// ** (fillTopK()) can tell which pairs are the top K. Keeping more pairs
+// ** than are printed leaves room for counts to go down between scans.
+
+// initTopK() sets up an empty TopK that keeps the given number of pairs
+// (at least 1), breaking ties with the words of the given Dictionary.
+void initTopK(TopK*, int, Dictionary*);
+
+// updateTopK() is called after every insert() with the pair's key and
+// its new count (as returned by insert()).
+void updateTopK(TopK*, unsigned long long, int);
+
+// lowerTopK() is called after a pair's count has gone down (e.g. with
+// the count subtractCount() returns; 0 if the pair was deleted). Lower
+// counts never bring a pair into the heap.
+void lowerTopK(TopK*, unsigned long long, int);
+
+// exactTopK() returns 1 if the given number of pairs that sort first in
+// the heap are surely the pairs that sort first in the table, and 0 if
+// counts have gone down so far that a pair outside the heap may have
+// overtaken one of them (or taken the place of one deleted), in which
+// case fillTopK() has to rebuild it before they are printed.
+int exactTopK(TopK*, int);
+
+// fillTopK() forgets every pair and offers every pair of the HashTable
+// instead, which makes the TopK exact again.
+void fillTopK(TopK*, HashTable*);
+
+// printTopK() prints the given number of pairs that sort first (-1 prints
+// all of them) in output order, in the same "count word1 word2" format as
+// printSortedHashTable().
+void printTopK(TopK*, int);
+
+// freeTopK() frees the heap and index of a TopK.
+void freeTopK(TopK*);
+
+#endif
@@ -0,0 +1,123 @@
+#include <string.h>
+#include "wordHash.h"
+#include "crc64.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define HAVE_SSE42_CRC
+#endif
+
+static unsigned long long crc64Hash(const char* key, size_t length) {
+	return crc64n(key, length);
+}
+
+static unsigned long long crc64s8Hash(const char* key, size_t length) {
+	return crc64s8(key, length);
+}
+
+/* MurmurHash3 64-bit finalizer (also used by hashKey())     */
+
+static inline unsigned long long finalMix(unsigned long long h) {
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* Reads eight bytes at a time; the tail is copied into a    */
+/* zeroed word so nothing past the key (which may be the end */
+/* of a mapped file) is ever touched.                        */
+
+static unsigned long long mixHash(const char* key, size_t length) {
+	unsigned long long h = 0x9E3779B97F4A7C15ULL ^ (length * 0xC2B2AE3D27D4EB4FULL);
+	unsigned long long word;
+
+	while (length >= 8) {
+		memcpy(&word, key, 8);
+		h = (h ^ word) * 0x9FB21C651E98DF25ULL;
+		h ^= h >> 29;
+		key += 8;
+		length -= 8;
+	}
+	if (length > 0) {
+		word = 0;
+		memcpy(&word, key, length);
+		h = (h ^ word) * 0x9FB21C651E98DF25ULL;
+		h ^= h >> 29;
+	}
+	return finalMix(h);
+}
+
+#ifdef HAVE_SSE42_CRC
+
+/* The 32-bit CRC is multiplied by an odd constant to spread */
+/* it over 64 bits; the low 32 bits stay a permutation of    */
+/* the CRC, so no distinct CRCs collide in the Dictionary.   */
+
+static __attribute__((target("sse4.2")))
+unsigned long long crc32cHash(const char* key, size_t length) {
+	unsigned long long crc = 0xFFFFFFFF;
+	unsigned long long word;
+
+	while (length >= 8) {
+		memcpy(&word, key, 8);
+		crc = _mm_crc32_u64(crc, word);
+		key += 8;
+		length -= 8;
+	}
+	while (length-- > 0)
+		crc = _mm_crc32_u8((unsigned) crc, (unsigned char) *key++);
+	return (crc ^ 0xFFFFFFFF) * 0x9E3779B97F4A7C15ULL;
+}
+
+#endif
+
+static const WordHash wordHashes[] = {
+	{ "crc64", crc64Hash },
+	{ "crc64s8", crc64s8Hash },
+#ifdef HAVE_SSE42_CRC
+	{ "crc32c", crc32cHash },
+#endif
+	{ "mix", mixHash },
+};
+
+#define WORD_HASH_COUNT (sizeof(wordHashes) / sizeof(wordHashes[0]))
+
+static const WordHash* currentHash = NULL;
+
+const WordHash* findWordHash(const char* name) {
+	for (size_t i = 0; i < WORD_HASH_COUNT; i++) {
+		if (strcmp(wordHashes[i].name, name) != 0) continue;
+#ifdef HAVE_SSE42_CRC
+		if (wordHashes[i].hash == crc32cHash) {
+			__builtin_cpu_init();
+			if (!__builtin_cpu_supports("sse4.2")) return NULL;
+		}
+#endif
+		return &wordHashes[i];
+	}
+	return NULL;
+}
+
+const WordHash* wordHash(void) {
+	if (currentHash == NULL) {
+		currentHash = findWordHash(WORD_HASH);
+		if (currentHash == NULL) currentHash = findWordHash("mix");	/* no SSE4.2 */
+	}
+	return currentHash;
+}
+
+void setWordHash(const WordHash* hash) {
+	currentHash = hash;
+}
+
+const char* const* wordHashNames(void) {
+	static const char* names[WORD_HASH_COUNT + 1];
+
+	for (size_t i = 0; i < WORD_HASH_COUNT; i++)
+		names[i] = wordHashes[i].name;
+	names[WORD_HASH_COUNT] = NULL;
+	return names;
+}
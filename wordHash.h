@@ -0,0 +1,46 @@
+#ifndef WORDHASH_H
+#define WORDHASH_H
+
+#include <stddef.h>
+
+#ifndef WORD_HASH
+#define WORD_HASH "crc32c"	/* default hash, e.g. cc -DWORD_HASH=\"mix\" */
+#endif
+
+/* A WordHash is one of the interchangeable hash functions   */
+/* the Dictionary can use for words.  Every function takes   */
+/* the length of the key, so slices from the WordReader are  */
+/* hashed without being NUL-terminated or walked twice.      */
+/* Hash values only pick a starting slot: the Dictionary     */
+/* always confirms a match by comparing the words.           */
+
+typedef struct _wordHash {
+	const char* name;
+	unsigned long long (*hash)(const char* key, size_t length);
+} WordHash;
+
+/* The available functions:                                  */
+/*   crc64     the original byte-at-a-time CRC-64 (crc64n)   */
+/*   crc64s8   the same CRC-64, slicing-by-8 (crc64s8)       */
+/*   crc32c    CRC-32C with the SSE4.2 crc32 instruction     */
+/*   mix       8 bytes per multiply/xor-shift step, then the */
+/*             MurmurHash3 finalizer                         */
+/* findWordHash() returns NULL if the name is unknown or the */
+/* CPU lacks the instruction it needs.                       */
+
+const WordHash* findWordHash(const char* name);
+
+/* The function new words are hashed with: WORD_HASH unless  */
+/* setWordHash() picked another one.  It must not change     */
+/* while a Dictionary holds words.                           */
+
+const WordHash* wordHash(void);
+
+void setWordHash(const WordHash* hash);
+
+/* Returns the names of all functions built in, followed by */
+/* NULL (for usage messages and benchmarks).                 */
+
+const char* const* wordHashNames(void);
+
+#endif
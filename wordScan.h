@@ -0,0 +1,55 @@
+#ifndef WORDSCAN_H
+#define WORDSCAN_H
+
+#include <stddef.h>
+
+/* Character classes used by the WordReader.  They are the   */
+/* "C" locale answers of isalpha/isalnum/isspace/islower so  */
+/* that no locale lookup happens per byte.                   */
+
+#define CH_ALPHA	0x01	/* A-Z a-z                          */
+#define CH_ALNUM	0x02	/* A-Z a-z 0-9                      */
+#define CH_SPACE	0x04	/* ' ' \t \n \v \f \r               */
+#define CH_CLEAN	0x08	/* a-z 0-9 (already normalized)     */
+
+extern const unsigned char wordCharClass[256];
+
+#define IS_CLASS(ch, cls)	(wordCharClass[(unsigned char) (ch)] & (cls))
+#define TO_LOWER(ch)		((ch) >= 'A' && (ch) <= 'Z' ? (ch) + ('a' - 'A') : (ch))
+
+/* A WordScanner is a set of kernels that classify a run of  */
+/* bytes at a time.  The scalar kernels look every byte up   */
+/* in wordCharClass; the SSE2 and AVX2 kernels classify 16   */
+/* or 32 bytes per step with the same rules.  Each search    */
+/* kernel returns the index of the first byte in data[pos,   */
+/* size) with the property, or size if there is none.        */
+
+typedef struct _wordScanner {
+	const char* name;
+	size_t (*skipToAlpha)(const char* data, size_t pos, size_t size);
+	size_t (*skipClean)(const char* data, size_t pos, size_t size);
+	size_t (*findSpace)(const char* data, size_t pos, size_t size);
+
+	/* copies the alphanumerics of data[0, n) to out in lower */
+	/* case, dropping everything else; returns # copied       */
+	int (*normalize)(char* out, const char* data, size_t n);
+} WordScanner;
+
+/* The kernels used by getNextWordSlice(): those given to   */
+/* setWordScanner(), or else SSE2 where the CPU has it and   */
+/* the scalar ones elsewhere, picked (once, thread-safely)   */
+/* the first time they are needed.                           */
+
+const WordScanner* wordScanner(void);
+
+/* Looks up a kernel set by name ("scalar", "sse2", "avx2"). */
+/* NULL is returned if it is unknown or the CPU lacks it.    */
+
+const WordScanner* findWordScanner(const char* name);
+
+/* Makes getNextWordSlice() use the given kernels.  It must  */
+/* be called before any thread starts reading words.         */
+
+void setWordScanner(const WordScanner* scanner);
+
+#endif
@@ -0,0 +1,136 @@
+#include "workQueue.h"
+#include <stdlib.h>
+
+// ************************************************
+// ************************************************
+// ** workQueue.c keeps one deque of tasks per
+// ** worker, each behind its own mutex, and a
+// ** count of the tasks not finished yet so that
+// ** idle workers know whether to wait for more
+// ** or to stop.
+// **
+// ** See workQueue.h for more information on each
+// ** individual function.
+
+#define DEQUE_INITIAL_CAPACITY 64
+
+// set up the deques of the workers:
+void initWorkQueue(WorkQueue* queue, int workers) {
+  queue->deques = malloc(sizeof(TaskDeque) * workers);
+  queue->workerCount = workers;
+  queue->pending = 0;
+  queue->waiting = 0;
+  queue->stolen = 0;
+  for (int w = 0; w < workers; w++) {
+    TaskDeque* deque = &queue->deques[w];
+    deque->tasks = NULL;
+    deque->top = 0;
+    deque->bottom = 0;
+    deque->capacity = 0;
+    pthread_mutex_init(&deque->lock, NULL);
+  }
+  pthread_mutex_init(&queue->idleLock, NULL);
+  pthread_cond_init(&queue->idleCond, NULL);
+}
+
+// add a task to the bottom of a worker's deque:
+void pushTask(WorkQueue* queue, int worker, unsigned long long task) {
+  TaskDeque* deque = &queue->deques[worker];
+
+  __atomic_fetch_add(&queue->pending, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_lock(&deque->lock);
+  if (deque->top == deque->bottom) {
+    deque->top = 0; // empty: start again at the front of the array
+    deque->bottom = 0;
+  }
+  if (deque->bottom == deque->capacity) {
+    deque->capacity = deque->capacity ? deque->capacity * 2 : DEQUE_INITIAL_CAPACITY;
+    deque->tasks = realloc(deque->tasks, sizeof(unsigned long long) * deque->capacity);
+  }
+  deque->tasks[deque->bottom++] = task;
+  pthread_mutex_unlock(&deque->lock);
+
+  // a worker that found every deque empty re-checks them under
+  // idleLock before it waits, so it either sees this task or is woken
+  pthread_mutex_lock(&queue->idleLock);
+  if (queue->waiting > 0) pthread_cond_broadcast(&queue->idleCond);
+  pthread_mutex_unlock(&queue->idleLock);
+}
+
+// take the newest task of a worker's own deque; returns 0 if it is empty
+static int popTask(TaskDeque* deque, unsigned long long* task) {
+  int found = 0;
+
+  pthread_mutex_lock(&deque->lock);
+  if (deque->bottom > deque->top) {
+    *task = deque->tasks[--deque->bottom];
+    found = 1;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+// take the oldest task of another worker's deque; returns 0 if it is empty
+static int stealTask(TaskDeque* deque, unsigned long long* task) {
+  int found = 0;
+
+  pthread_mutex_lock(&deque->lock);
+  if (deque->bottom > deque->top) {
+    *task = deque->tasks[deque->top++];
+    found = 1;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+// look for a task in a worker's deque, then in every other one
+static int findTask(WorkQueue* queue, int worker, unsigned long long* task) {
+  if (popTask(&queue->deques[worker], task)) return 1;
+  for (int i = 1; i < queue->workerCount; i++) {
+    // start with the next worker so that thieves spread over the victims
+    if (stealTask(&queue->deques[(worker + i) % queue->workerCount], task)) {
+      __atomic_fetch_add(&queue->stolen, 1, __ATOMIC_RELAXED);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// the next task for a worker:
+int takeTask(WorkQueue* queue, int worker, unsigned long long* task) {
+  if (findTask(queue, worker, task)) return 1;
+
+  // nothing to take: stop if every task is done, otherwise wait for a
+  // running task to push more (or for the last one to finish)
+  pthread_mutex_lock(&queue->idleLock);
+  queue->waiting++;
+  int found = findTask(queue, worker, task);
+  while (!found && __atomic_load_n(&queue->pending, __ATOMIC_SEQ_CST) > 0) {
+    pthread_cond_wait(&queue->idleCond, &queue->idleLock);
+    found = findTask(queue, worker, task);
+  }
+  queue->waiting--;
+  pthread_mutex_unlock(&queue->idleLock);
+  return found;
+}
+
+// done with a task:
+void finishTask(WorkQueue* queue) {
+  if (__atomic_sub_fetch(&queue->pending, 1, __ATOMIC_SEQ_CST) == 0) {
+    // the last task: wake every waiting worker so that it can stop
+    pthread_mutex_lock(&queue->idleLock);
+    pthread_cond_broadcast(&queue->idleCond);
+    pthread_mutex_unlock(&queue->idleLock);
+  }
+}
+
+// free the deques:
+void freeWorkQueue(WorkQueue* queue) {
+  for (int w = 0; w < queue->workerCount; w++) {
+    free(queue->deques[w].tasks);
+    pthread_mutex_destroy(&queue->deques[w].lock);
+  }
+  free(queue->deques);
+  pthread_mutex_destroy(&queue->idleLock);
+  pthread_cond_destroy(&queue->idleCond);
+}
@@ -0,0 +1,71 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <pthread.h>
+
+typedef struct _taskDeque {
+  unsigned long long* tasks; // tasks[top .. bottom) are waiting, oldest first
+  int top; // next task a thief takes
+  int bottom; // one past the next task the owner takes
+  int capacity; // # of tasks the array has room for
+  pthread_mutex_t lock; // guards the deque
+} TaskDeque;
+
+typedef struct _workQueue {
+  TaskDeque* deques; // one per worker
+  int workerCount; // # of deques
+  long long pending; // tasks pushed and not finished yet
+  int waiting; // # of workers waiting for a task
+  long long stolen; // # of tasks taken from another worker's deque
+  pthread_mutex_t idleLock; // guards waiting (and the wakeups)
+  pthread_cond_t idleCond; // a task was pushed, or the last one finished
+} WorkQueue;
+
+// ***************************************************************
+// ***************************************************************
+// ** INTERFACE:
+// **  set up the deques of N workers: initWorkQueue(WorkQueue*, int)
+// **  add a task to a worker's deque: pushTask(WorkQueue*, int, unsigned long long)
+// **  the next task for a worker: takeTask(WorkQueue*, int, unsigned long long*)
+// **  done with a task: finishTask(WorkQueue*)
+// **  free memory: freeWorkQueue(WorkQueue*)
+// **
+// ** A WorkQueue spreads tasks (64-bit numbers, whose meaning is up
+// ** to the caller) over worker threads by work stealing. Every
+// ** worker owns a deque: it takes its own tasks from the bottom,
+// ** newest first, and only when its deque is empty does it steal the
+// ** oldest task from the top of another worker's deque. Workers that
+// ** are dealt a few long tasks therefore end up running fewer of them,
+// ** without any up-front estimate of how long a task takes, and each
+// ** worker mostly touches only its own deque. A task may push more
+// ** tasks (such as the parts of a file that turns out to be large)
+// ** while it runs.
+// **
+// ** Each deque has its own mutex. A task here is a whole file or a
+// ** part of one, microseconds of work at the very least, so an
+// ** uncontended lock per task costs nothing measurable and keeps the
+// ** deque simple; a lock-free deque would only pay off for much
+// ** smaller tasks.
+
+// initWorkQueue() sets up empty deques for the given number of workers.
+void initWorkQueue(WorkQueue*, int);
+
+// pushTask() adds a task to the bottom of a worker's deque (the second
+// argument) and wakes any worker waiting for one.
+void pushTask(WorkQueue*, int, unsigned long long);
+
+// takeTask() stores the next task for a worker (the second argument)
+// through the pointer and returns 1: the newest task of its own deque
+// or, failing that, the oldest task of another worker's deque. While
+// tasks that might push more are still running it waits; it returns 0
+// once every task pushed has been finished.
+int takeTask(WorkQueue*, int, unsigned long long*);
+
+// finishTask() marks a task returned by takeTask() as done. Tasks it
+// pushed while it ran must be pushed before it is finished.
+void finishTask(WorkQueue*);
+
+// freeWorkQueue() frees the deques.
+void freeWorkQueue(WorkQueue*);
+
+#endif